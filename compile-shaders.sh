@@ -7,4 +7,6 @@ then
     mkdir -p build/assets/shaders
 fi
 glslangValidator -V src/graphics/shaders/shader.vert -o build/assets/shaders/vert.spv
-glslangValidator -V src/graphics/shaders/shader.frag -o build/assets/shaders/frag.spv
\ No newline at end of file
+glslangValidator -V -DPACKED_VERTICES src/graphics/shaders/shader.vert -o build/assets/shaders/vert-packed.spv
+glslangValidator -V src/graphics/shaders/shader.frag -o build/assets/shaders/frag.spv
+glslangValidator -V src/graphics/shaders/cull.comp -o build/assets/shaders/cull.spv
\ No newline at end of file
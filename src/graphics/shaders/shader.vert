@@ -5,17 +5,33 @@ layout(binding = 0) uniform UniformBufferObject {
     mat4 model;
     mat4 view;
     mat4 projection;
+    vec4 positionScale;
+    vec4 positionOffset;
+    vec4 texCoordTransform;
 } ubo;
 
+#ifdef PACKED_VERTICES
+// PackedVertex: 16 bit unorms relative to the mesh bounds, no color
+layout(location = 0) in vec4 inPosition;
+layout(location = 2) in vec2 inTexCoord;
+#else
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec2 inTexCoord;
+#endif
 
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
 
 void main() {
-    gl_Position = ubo.projection * ubo.view * ubo.model * vec4(inPosition, 1.0);
+#ifdef PACKED_VERTICES
+    vec3 position = ubo.positionOffset.xyz + inPosition.xyz * ubo.positionScale.xyz;
+    fragColor = vec3(1.0);
+    fragTexCoord = ubo.texCoordTransform.zw + inTexCoord * ubo.texCoordTransform.xy;
+#else
+    vec3 position = inPosition;
     fragColor = inColor;
     fragTexCoord = inTexCoord;
+#endif
+    gl_Position = ubo.projection * ubo.view * ubo.model * vec4(position, 1.0);
 }
@@ -5,35 +5,63 @@
 #include "buffer.hpp"
 #include "command.hpp"
 
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
 namespace Obtain::Graphics::Vulkan {
 	Buffer::Buffer(Device *device, vk::DeviceSize size, const vk::BufferUsageFlags &usageFlags,
-	               const vk::MemoryPropertyFlags &propertyFlags)
-		: device(device), size(size)
+	               const vk::MemoryPropertyFlags &propertyFlags, MemoryCategory category, bool persistentlyMapped)
+		: device(device), size(size), usageFlags(usageFlags), persistentlyMapped(persistentlyMapped)
 	{
 		buffer = device->createBuffer(size, usageFlags);
+		memory = device->allocateBufferMemory(buffer, propertyFlags, category, persistentlyMapped);
 
-		auto memoryRequirements = device->getBufferMemoryRequirements(buffer);
-		auto memoryType = device->findMemoryType(memoryRequirements.memoryTypeBits,
-		                                         propertyFlags);
-
-		memory = device->allocateMemory(memoryRequirements.size,
-		                                memoryType);
-
+		// Offsets handed out by Buffer are within buffer, the allocation offset is applied by binding
 		offset = 0u;
-
-		device->bindBufferMemory(buffer, memory, offset);
 	}
 
 	std::unique_ptr<Buffer> Buffer::unique(Device *device, vk::DeviceSize size, const vk::BufferUsageFlags &usageFlags,
-	                                       const vk::MemoryPropertyFlags &propertyFlags)
+	                                       const vk::MemoryPropertyFlags &propertyFlags, MemoryCategory category,
+	                                       bool persistentlyMapped)
 	{
 		return std::make_unique<Buffer>(Buffer(device, size, usageFlags,
-		                                       propertyFlags));
+		                                       propertyFlags, category, persistentlyMapped));
+	}
+
+	void Buffer::load(vk::DeviceSize internalOffset, const void *source, vk::DeviceSize size)
+	{
+		if (!persistentlyMapped) {
+			// One driver round trip per load, the way every load went before blocks stayed mapped
+			auto *mappedData = static_cast<char *>(memory.map());
+			memcpy(mappedData + offset + internalOffset, source, static_cast<size_t>(size));
+			memory.flush(offset + internalOffset, size);
+			memory.unmap();
+			return;
+		}
+
+		auto *mappedData = static_cast<char *>(memory.getMappedData());
+		if (mappedData == nullptr) {
+			throw std::runtime_error("loading into a buffer that is not host visible!");
+		}
+		memcpy(mappedData + offset + internalOffset, source, static_cast<size_t>(size));
+		memory.flush(offset + internalOffset, size);
+	}
+
+	void *Buffer::getMappedData()
+	{
+		auto *mappedData = static_cast<char *>(memory.getMappedData());
+		return mappedData != nullptr ? mappedData + offset : nullptr;
+	}
+
+	void Buffer::flush(vk::DeviceSize internalOffset, vk::DeviceSize rangeSize)
+	{
+		memory.flush(offset + internalOffset, rangeSize);
 	}
 
-	void Buffer::load(vk::DeviceSize internalOffset, void *source, vk::DeviceSize size)
+	void Buffer::invalidate(vk::DeviceSize internalOffset, vk::DeviceSize rangeSize)
 	{
-		device->setMemory(memory, offset + internalOffset, size, source);
+		memory.invalidate(offset + internalOffset, rangeSize);
 	}
 
 	vk::UniqueBuffer &Buffer::getBuffer()
@@ -41,7 +69,7 @@ namespace Obtain::Graphics::Vulkan {
 		return buffer;
 	}
 
-	vk::UniqueDeviceMemory &Buffer::getDeviceMemory()
+	MemoryAllocation &Buffer::getMemory()
 	{
 		return memory;
 	}
@@ -56,6 +84,27 @@ namespace Obtain::Graphics::Vulkan {
 		return offset;
 	}
 
+	const vk::BufferUsageFlags &Buffer::getUsage()
+	{
+		return usageFlags;
+	}
+
+	void Buffer::exchange(vk::UniqueBuffer &otherBuffer, MemoryAllocation &otherMemory)
+	{
+		std::swap(buffer, otherBuffer);
+		std::swap(memory, otherMemory);
+	}
+
+	void Buffer::setMovable(bool isMovable)
+	{
+		movable = isMovable;
+	}
+
+	bool Buffer::isMovable()
+	{
+		return movable;
+	}
+
 	void Buffer::copyToImage(vk::UniqueCommandPool &commandPool, const vk::Queue &graphicsQueue, vk::UniqueImage &image,
 	                         const vk::BufferImageCopy &region, const vk::ImageSubresourceLayers &subresource)
 	{
@@ -12,22 +12,43 @@
 namespace Obtain::Graphics::Vulkan {
 	class Buffer {
 	public:
+		// Host visible buffers are mapped from creation to destruction unless persistentlyMapped is false
 		Buffer(Device *device, vk::DeviceSize size, const vk::BufferUsageFlags &usageFlags,
-		       const vk::MemoryPropertyFlags &propertyFlags);
+		       const vk::MemoryPropertyFlags &propertyFlags, MemoryCategory category, bool persistentlyMapped = true);
 
 		static std::unique_ptr<Buffer> unique(Device *device, vk::DeviceSize size, const vk::BufferUsageFlags &usageFlags,
-		const vk::MemoryPropertyFlags &propertyFlags);
+		const vk::MemoryPropertyFlags &propertyFlags, MemoryCategory category, bool persistentlyMapped = true);
 
-		void load(vk::DeviceSize internalOffset, void *source, size_t size);
+		// Copies into the mapped memory and flushes it, host visible buffers only. Buffers that are not
+		// persistently mapped are mapped and unmapped around the copy.
+		void load(vk::DeviceSize internalOffset, const void *source, size_t size);
+
+		// Stays valid from creation to destruction, nullptr unless the buffer is persistently mapped
+		void *getMappedData();
+
+		// Needed around direct writes and reads through getMappedData unless the memory is host coherent
+		void flush(vk::DeviceSize internalOffset = 0u, vk::DeviceSize rangeSize = VK_WHOLE_SIZE);
+		void invalidate(vk::DeviceSize internalOffset = 0u, vk::DeviceSize rangeSize = VK_WHOLE_SIZE);
 
 		vk::UniqueBuffer &getBuffer();
 
-		vk::UniqueDeviceMemory &getDeviceMemory();
+		MemoryAllocation &getMemory();
 
 		vk::DeviceSize getSize();
 
 		vk::DeviceSize getOffset();
 
+		const vk::BufferUsageFlags &getUsage();
+
+		// Switches to otherBuffer bound to otherMemory, which get the current buffer and memory in return.
+		// Contents are not copied, and whatever refers to the vk::Buffer has to be pointed at the new one.
+		void exchange(vk::UniqueBuffer &otherBuffer, MemoryAllocation &otherMemory);
+
+		// Set while the buffer is registered with the defragmenter, which may copy it at any time, so
+		// writing to it would be lost
+		void setMovable(bool isMovable);
+		bool isMovable();
+
 		void copyToImage(vk::UniqueCommandPool &commandPool, const vk::Queue &graphicsQueue, vk::UniqueImage &image,
 		                 const vk::BufferImageCopy &region, const vk::ImageSubresourceLayers &subresource);
 
@@ -35,9 +56,12 @@ namespace Obtain::Graphics::Vulkan {
 
 	private:
 		vk::DeviceSize size;
+		MemoryAllocation memory; // declared first so buffer is destroyed before its memory is released
 		vk::UniqueBuffer buffer;
-		vk::UniqueDeviceMemory memory;
 		vk::DeviceSize offset;
+		vk::BufferUsageFlags usageFlags;
+		bool movable = false;
+		bool persistentlyMapped;
 
 		Device *device;
 	};
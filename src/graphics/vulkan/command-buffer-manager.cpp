@@ -0,0 +1,76 @@
+#include "command-buffer-manager.hpp"
+
+namespace Obtain::Graphics::Vulkan {
+	/******************************************
+	 ***************** public *****************
+	 ******************************************/
+
+	CommandBufferManager::CommandBufferManager(Device *device, uint32_t frameCount, uint32_t threadCount)
+		: device(device), timeline(device->getGraphicsTimeline()), frames(frameCount), current(0u),
+		  allocationCount(0u)
+	{
+		for (Frame &frame : frames) {
+			frame.pool = device->createCommandPool(vk::CommandPoolCreateFlagBits::eTransient);
+			frame.usedPrimaries = 0u;
+			frame.submission = 0u;
+		}
+		for (uint32_t thread = 0; thread < threadCount; thread++) {
+			threadPools.push_back(device->createCommandPool(vk::CommandPoolCreateFlagBits::eResetCommandBuffer));
+		}
+	}
+
+	CommandBufferManager::~CommandBufferManager()
+	{
+		for (Frame &frame : frames) {
+			timeline.wait(frame.submission);
+		}
+	}
+
+	std::unique_ptr<CommandBufferManager> CommandBufferManager::unique(Device *device, uint32_t frameCount,
+	                                                                   uint32_t threadCount)
+	{
+		return std::make_unique<CommandBufferManager>(device, frameCount, threadCount);
+	}
+
+	void CommandBufferManager::nextFrame()
+	{
+		frames[current].submission = timeline.getSubmitted();
+		current = (current + 1) % frames.size();
+
+		Frame &frame = frames[current];
+		timeline.wait(frame.submission);
+		if (frame.usedPrimaries > 0u) {
+			device->resetCommandPool(frame.pool);
+			frame.usedPrimaries = 0u;
+		}
+	}
+
+	vk::CommandBuffer CommandBufferManager::getPrimary()
+	{
+		Frame &frame = frames[current];
+		if (frame.usedPrimaries == frame.primaries.size()) {
+			frame.primaries.push_back(std::move(device->allocateCommandBuffers(frame.pool,
+			                                                                   vk::CommandBufferLevel::ePrimary,
+			                                                                   1u)[0]));
+			allocationCount++;
+		}
+		return *frame.primaries[frame.usedPrimaries++];
+	}
+
+	vk::UniqueCommandBuffer CommandBufferManager::allocateSecondary(uint32_t thread)
+	{
+		allocationCount++;
+		return std::move(device->allocateCommandBuffers(threadPools.at(thread), vk::CommandBufferLevel::eSecondary,
+		                                                1u)[0]);
+	}
+
+	uint32_t CommandBufferManager::getThreadCount()
+	{
+		return static_cast<uint32_t>(threadPools.size());
+	}
+
+	uint32_t CommandBufferManager::getAllocationCount()
+	{
+		return allocationCount;
+	}
+}
@@ -0,0 +1,64 @@
+#ifndef OBTAIN_GRAPHICS_VULKAN_COMMAND_BUFFER_MANAGER_HPP
+#define OBTAIN_GRAPHICS_VULKAN_COMMAND_BUFFER_MANAGER_HPP
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "device.hpp"
+
+namespace Obtain::Graphics::Vulkan {
+	/*
+	 * All graphics command buffers of the renderer. Primaries recorded anew every frame come from a
+	 * transient pool per frame and are never freed: once the graphics timeline passes everything
+	 * submitted in that frame, its pool is reset wholesale and the same buffers are handed out again, so
+	 * recording allocates nothing in steady state. Secondaries that are kept and executed over many
+	 * frames come from a pool per recording thread whose buffers are reset one by one. A thread only
+	 * uses the pool of its own index, which is what keeps the pools free of locking.
+	 */
+	class CommandBufferManager {
+	public:
+		CommandBufferManager(Device *device, uint32_t frameCount, uint32_t threadCount);
+
+		// Waits for the frames still in flight
+		~CommandBufferManager();
+
+		static std::unique_ptr<CommandBufferManager> unique(Device *device, uint32_t frameCount,
+		                                                    uint32_t threadCount);
+
+		// Ends the current frame with what was submitted to the graphics timeline so far, then waits
+		// until the oldest frame's submissions complete and resets its pool for the next frame
+		void nextFrame();
+
+		// A primary of the current frame, reset and not begun yet; valid until the frame's pool is reset.
+		// Only for the thread calling nextFrame.
+		vk::CommandBuffer getPrimary();
+
+		// A secondary from thread's pool that is reset by beginning it again. Allocated and recorded on
+		// thread only, freed while no thread records and before the manager is destroyed.
+		vk::UniqueCommandBuffer allocateSecondary(uint32_t thread);
+
+		uint32_t getThreadCount();
+
+		// Command buffers allocated since creation, stays flat once every frame has enough
+		uint32_t getAllocationCount();
+
+	private:
+		struct Frame {
+			vk::UniqueCommandPool pool; // declared first so the buffers are freed before it's destroyed
+			std::vector<vk::UniqueCommandBuffer> primaries;
+			size_t usedPrimaries;
+			uint64_t submission; // graphics timeline value after which the frame's buffers are unused
+		};
+
+		Device *device;
+		GpuTimeline &timeline;
+		std::vector<Frame> frames;
+		std::vector<vk::UniqueCommandPool> threadPools;
+		size_t current;
+		std::atomic<uint32_t> allocationCount;
+	};
+}
+
+#endif // OBTAIN_GRAPHICS_VULKAN_COMMAND_BUFFER_MANAGER_HPP
@@ -19,16 +19,7 @@ namespace Obtain::Graphics::Vulkan {
 
 		allocatedCommandBuffers[0]->end();
 
-		vk::UniqueFence fence = device->createFence();
-
-		vk::SubmitInfo submitInfo(
-			0u,
-			nullptr,
-			nullptr,
-			1u,
-			&allocatedCommandBuffers[0].get()
-		);
-		graphicsQueue.submit(1, &submitInfo, *fence);
-		device->waitForFence(fence);
+		GpuTimeline &timeline = device->getTimeline(graphicsQueue);
+		timeline.wait(timeline.submit(*allocatedCommandBuffers[0]));
 	}
 }
@@ -0,0 +1,101 @@
+//
+// Created by agent on 10/17/26.
+//
+
+#ifndef OBTAIN_GRAPHICS_VULKAN_COOKED_MODEL_HPP
+#define OBTAIN_GRAPHICS_VULKAN_COOKED_MODEL_HPP
+
+#include <cstdint>
+
+namespace Obtain::Graphics::Vulkan {
+	// Range of the full detail index buffer that came from a single OBJ shape
+	struct ModelShape {
+		uint32_t firstIndex;
+		uint32_t indexCount;
+	};
+
+	// Range of the index buffer drawn with one drawIndexed call; indices are relative to vertexOffset
+	// so that 16 bit indices can address meshes with more than 65536 vertices
+	struct ModelPartition {
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		uint32_t vertexOffset;
+	};
+
+	/*
+	 * Small cluster of triangles culled as a whole on the GPU. The sphere bounds the vertices and the
+	 * normal cone bounds the triangle normals: the meshlet faces away from a camera at position p if
+	 * dot(center - p, coneAxis) >= coneCutoff * length(center - p) + radius. coneCutoff is 1 if the
+	 * normals spread too far for the cone to ever cull. Laid out like the std430 struct the culling
+	 * shader reads.
+	 */
+	struct ModelMeshlet {
+		float center[3];
+		float radius;
+		float coneAxis[3];
+		float coneCutoff;
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		uint32_t vertexOffset;
+		uint32_t partition;
+	};
+
+	/*
+	 * One level of detail: its own range of the index buffer, drawn as partitions and meshlets of its
+	 * own. Level 0 is the full detail mesh, every further level is simplified from it and shares its
+	 * vertices. error is how far, in model space, the level may deviate from the full detail surface.
+	 */
+	struct ModelLod {
+		float error;
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		uint32_t firstPartition;
+		uint32_t partitionCount;
+		uint32_t firstMeshlet;
+		uint32_t meshletCount;
+	};
+
+	struct ModelBounds {
+		float min[3];
+		float max[3];
+	};
+
+	/*
+	 * Layout of a cooked (.obm) model file:
+	 *   CookedModelHeader
+	 *   ModelShape[shapeCount]         at shapeOffset
+	 *   ModelLod[lodCount]             at lodOffset
+	 *   ModelPartition[partitionCount] at partitionOffset
+	 *   ModelMeshlet[meshletCount]     at meshletOffset
+	 *   Vertex[vertexCount]            at vertexOffset
+	 *   uint16_t/uint32_t[indexCount]  at indexOffset, indexSize bytes each
+	 * Every section starts on a CookedModelAlignment boundary and is stored in host byte order,
+	 * so the loader can map the file and hand the blobs to the GPU upload untouched. Indices are
+	 * stored already optimized for the vertex cache and overdraw, vertices in order of first use.
+	 */
+	struct CookedModelHeader {
+		char magic[4];
+		uint32_t version;
+		uint32_t vertexStride;
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint32_t indexSize;
+		uint32_t shapeCount;
+		uint32_t partitionCount;
+		uint32_t meshletCount;
+		uint32_t lodCount;
+		ModelBounds bounds;
+		uint64_t shapeOffset;
+		uint64_t lodOffset;
+		uint64_t partitionOffset;
+		uint64_t meshletOffset;
+		uint64_t vertexOffset;
+		uint64_t indexOffset;
+	};
+
+	const char CookedModelMagic[4] = {'O', 'B', 'M', '\0'};
+	const uint32_t CookedModelVersion = 6u;
+	const uint64_t CookedModelAlignment = 16u;
+}
+
+#endif // OBTAIN_GRAPHICS_VULKAN_COOKED_MODEL_HPP
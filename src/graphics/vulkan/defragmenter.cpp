@@ -0,0 +1,194 @@
+#include "defragmenter.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace Obtain::Graphics::Vulkan {
+	/******************************************
+	 ***************** public *****************
+	 ******************************************/
+
+	Defragmenter::Defragmenter(Device *device, CommandBufferManager &commandBuffers)
+		: device(device), commandBuffers(commandBuffers), timeline(device->getGraphicsTimeline()), copySubmission(0u),
+		  movedBytes(0u), moveCount(0u)
+	{}
+
+	Defragmenter::~Defragmenter()
+	{
+		timeline.wait(copySubmission);
+	}
+
+	std::unique_ptr<Defragmenter> Defragmenter::unique(Device *device, CommandBufferManager &commandBuffers)
+	{
+		return std::make_unique<Defragmenter>(device, commandBuffers);
+	}
+
+	void Defragmenter::add(std::unique_ptr<Buffer> &buffer)
+	{
+		vk::BufferUsageFlags transfer = vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst;
+		if ((buffer->getUsage() & transfer) != transfer) {
+			throw std::runtime_error("buffers can only be moved with transfer source and destination usage!");
+		}
+		buffers.push_back(buffer.get());
+		buffer->setMovable(true);
+	}
+
+	void Defragmenter::remove(std::unique_ptr<Buffer> &buffer)
+	{
+		if (move && move->buffer == buffer.get()) {
+			timeline.wait(copySubmission);
+			move.reset();
+		}
+		buffers.erase(std::remove(buffers.begin(), buffers.end(), buffer.get()), buffers.end());
+		buffer->setMovable(false);
+	}
+
+	void Defragmenter::add(GeometryPool &pool)
+	{
+		add(pool.getVertexBuffer());
+		add(pool.getIndexBuffer());
+		pools.push_back(&pool);
+	}
+
+	void Defragmenter::remove(GeometryPool &pool)
+	{
+		if (rangeMove && rangeMove->pool == &pool) {
+			timeline.wait(copySubmission);
+			pool.endMove(false);
+			rangeMove.reset();
+		}
+		pools.erase(std::remove(pools.begin(), pools.end(), &pool), pools.end());
+		remove(pool.getVertexBuffer());
+		remove(pool.getIndexBuffer());
+	}
+
+	bool Defragmenter::step(vk::DeviceSize byteBudget)
+	{
+		if (!timeline.isComplete(copySubmission)) {
+			return false;
+		}
+
+		bool switched = false;
+		if (move && move->copied == move->buffer->getSize()) {
+			move->buffer->exchange(move->target, move->memory);
+			movedBytes += move->copied;
+			moveCount++;
+			retired.push_back({std::move(move->memory), std::move(move->target)});
+			move.reset();
+			switched = true;
+		}
+		if (rangeMove && rangeMove->copied == rangeMove->range.size) {
+			if (rangeMove->pool->endMove()) {
+				movedBytes += rangeMove->copied;
+				moveCount++;
+				switched = true;
+			}
+			rangeMove.reset();
+		}
+
+		// Buffers leaving sparse blocks free the most memory, ranges within pools go once there are none
+		if (!move && !rangeMove) {
+			move = findMove();
+			if (!move) {
+				rangeMove = findRangeMove();
+			}
+			if (!move && !rangeMove) {
+				return switched;
+			}
+		}
+
+		if (move) {
+			vk::DeviceSize chunk = std::min(byteBudget, move->buffer->getSize() - move->copied);
+			copy(*(move->buffer->getBuffer()), *(move->target),
+			     vk::BufferCopy(move->buffer->getOffset() + move->copied, move->copied, chunk));
+			move->copied += chunk;
+		} else {
+			// Source and target are disjoint ranges of the same buffer, as a copy within one buffer requires
+			const GeometryPool::RangeMove &range = rangeMove->range;
+			vk::DeviceSize chunk = std::min(byteBudget, range.size - rangeMove->copied);
+			vk::Buffer buffer = *(range.buffer->getBuffer());
+			copy(buffer, buffer, vk::BufferCopy(range.buffer->getOffset() + range.source + rangeMove->copied,
+			                                    range.buffer->getOffset() + range.target + rangeMove->copied,
+			                                    chunk));
+			rangeMove->copied += chunk;
+		}
+		return switched;
+	}
+
+	void Defragmenter::releaseRetired()
+	{
+		retired.clear();
+		for (GeometryPool *pool : pools) {
+			pool->releaseRetired();
+		}
+	}
+
+	vk::DeviceSize Defragmenter::getMovedBytes()
+	{
+		return movedBytes;
+	}
+
+	uint32_t Defragmenter::getMoveCount()
+	{
+		return moveCount;
+	}
+
+	/******************************************
+	 ***************** private *****************
+	 ******************************************/
+
+	std::unique_ptr<Defragmenter::Move> Defragmenter::findMove()
+	{
+		std::vector<std::pair<float, Buffer *>> candidates;
+		for (Buffer *buffer : buffers) {
+			float usage = device->getMemoryBlockUsage(buffer->getMemory());
+			if (usage < MaxSourceUsage) {
+				candidates.emplace_back(usage, buffer);
+			}
+		}
+
+		// Sparsest blocks first, emptying them frees the most memory for the least copying
+		std::sort(candidates.begin(), candidates.end());
+		for (auto &candidate : candidates) {
+			Buffer *buffer = candidate.second;
+			MemoryAllocation memory = device->allocateCompactedBufferMemory(buffer->getBuffer(), buffer->getMemory());
+			if (memory.getMemory()) {
+				auto target = device->createBuffer(buffer->getSize(), buffer->getUsage());
+				device->bindBufferMemory(target, memory);
+				return std::unique_ptr<Move>(new Move{buffer, std::move(memory), std::move(target), 0u});
+			}
+		}
+		return nullptr;
+	}
+
+	std::unique_ptr<Defragmenter::RangeMove> Defragmenter::findRangeMove()
+	{
+		for (GeometryPool *pool : pools) {
+			GeometryPool::RangeMove range;
+			if (pool->beginMove(range)) {
+				return std::unique_ptr<RangeMove>(new RangeMove{pool, range, 0u});
+			}
+		}
+		return nullptr;
+	}
+
+	void Defragmenter::copy(vk::Buffer source, vk::Buffer target, const vk::BufferCopy &region)
+	{
+		vk::CommandBuffer commandBuffer = commandBuffers.getPrimary();
+		commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit, nullptr));
+		commandBuffer.copyBuffer(source, target, 1u, &region);
+
+		// The new buffer or range is first read by submissions recorded after the switch
+		vk::MemoryBarrier barrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eMemoryRead);
+		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+		                              vk::PipelineStageFlagBits::eAllCommands,
+		                              vk::DependencyFlags(),
+		                              1, &barrier,
+		                              0, nullptr,
+		                              0, nullptr);
+		commandBuffer.end();
+
+		copySubmission = timeline.submit(commandBuffer);
+	}
+}
@@ -0,0 +1,99 @@
+#ifndef OBTAIN_GRAPHICS_VULKAN_DEFRAGMENTER_HPP
+#define OBTAIN_GRAPHICS_VULKAN_DEFRAGMENTER_HPP
+
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "device.hpp"
+#include "buffer.hpp"
+#include "geometry-pool.hpp"
+#include "command-buffer-manager.hpp"
+
+namespace Obtain::Graphics::Vulkan {
+	/*
+	 * Moves buffers out of sparsely used memory blocks into fuller blocks of the same memory type, so
+	 * the holes left behind by freed resources come together and emptied blocks go back to the driver.
+	 * One buffer is moved at a time, copied on the GPU in chunks of at most the byte budget given to
+	 * each step, so a move is spread over as many frames as it takes. The buffer switches to its new
+	 * memory only once the last chunk is copied; its old vk::Buffer and memory are retired then and stay
+	 * valid until releaseRetired, for command buffers and descriptors still referring to them.
+	 * Registered buffers are only read from while they are registered, they are marked movable for
+	 * writers to check.
+	 *
+	 * Geometry pools are compacted the same way while no buffer is moving: mesh ranges are copied down
+	 * into free ranges of their own buffer, and the mesh switches to the new range after the last chunk.
+	 */
+	class Defragmenter {
+	public:
+		// Blocks used less than this are emptied into fuller ones
+		static constexpr float MaxSourceUsage = 0.5f;
+
+		// Copies are recorded into commandBuffers' primaries and run on the graphics queue
+		Defragmenter(Device *device, CommandBufferManager &commandBuffers);
+
+		~Defragmenter();
+
+		static std::unique_ptr<Defragmenter> unique(Device *device, CommandBufferManager &commandBuffers);
+
+		// buffer needs transfer source and destination usage and stays registered, and movable, until removed
+		void add(std::unique_ptr<Buffer> &buffer);
+
+		void remove(std::unique_ptr<Buffer> &buffer);
+
+		// Registers pool's buffers, and its meshes to be moved within them, until removed
+		void add(GeometryPool &pool);
+
+		void remove(GeometryPool &pool);
+
+		// Copies at most byteBudget bytes, without waiting for earlier copies. Returns true when buffers
+		// switched to new memory or meshes to new ranges, after which whatever refers to them has to be
+		// rewritten before releaseRetired is called.
+		bool step(vk::DeviceSize byteBudget);
+
+		// Frees the memory buffers were moved out of and the ranges meshes were moved out of
+		void releaseRetired();
+
+		vk::DeviceSize getMovedBytes();
+
+		uint32_t getMoveCount();
+
+	private:
+		struct Move {
+			Buffer *buffer;
+			MemoryAllocation memory;
+			vk::UniqueBuffer target;
+			vk::DeviceSize copied;
+		};
+
+		struct RangeMove {
+			GeometryPool *pool;
+			GeometryPool::RangeMove range;
+			vk::DeviceSize copied;
+		};
+
+		// The vk::Buffer is destroyed before its memory is released
+		struct Retired {
+			MemoryAllocation memory;
+			vk::UniqueBuffer buffer;
+		};
+
+		Device *device;
+		CommandBufferManager &commandBuffers;
+		GpuTimeline &timeline;
+		std::vector<Buffer *> buffers;
+		std::unique_ptr<Move> move;
+		std::vector<GeometryPool *> pools;
+		std::unique_ptr<RangeMove> rangeMove;
+		std::vector<Retired> retired;
+		uint64_t copySubmission; // the latest copy's value on timeline
+		vk::DeviceSize movedBytes;
+		uint32_t moveCount;
+
+		std::unique_ptr<Move> findMove();
+		std::unique_ptr<RangeMove> findRangeMove();
+		void copy(vk::Buffer source, vk::Buffer target, const vk::BufferCopy &region);
+	};
+}
+
+#endif // OBTAIN_GRAPHICS_VULKAN_DEFRAGMENTER_HPP
@@ -1,5 +1,6 @@
 #include "device.hpp"
 
+#include <algorithm>
 #include <vector>
 #include <set>
 #include <map>
@@ -23,7 +24,9 @@ namespace Obtain::Graphics::Vulkan {
 	Device::Device(const std::string &gameTitle,
 	               std::array<uint32_t, 3> gameVersion,
 	               std::array<uint32_t, 3> engineVersion)
-		: gameVersion(gameVersion),
+		: hostAllocator(std::make_unique<HostAllocator>()),
+		  allocationCallbacks(TrackHostAllocations ? &hostAllocator->getCallbacks() : nullptr),
+		  gameVersion(gameVersion),
 		  engineVersion(engineVersion),
 		  gameTitle(gameTitle),
 		  resizeOccurred(false)
@@ -34,7 +37,8 @@ namespace Obtain::Graphics::Vulkan {
 
 		surface = createSurface(
 			*instance,
-			window
+			window,
+			allocationCallbacks
 		);
 
 		physicalDevice = selectPhysicalDevice(
@@ -49,8 +53,27 @@ namespace Obtain::Graphics::Vulkan {
 			instance
 		);
 
+		auto limits = physicalDevice.getProperties().limits;
+		memoryAllocator = std::make_unique<MemoryAllocator>(
+			*device,
+			physicalDevice.getMemoryProperties(),
+			limits.bufferImageGranularity,
+			limits.nonCoherentAtomSize,
+			allocationCallbacks
+		);
+
 		graphicsQueue = device->getQueue(queueFamilyIndices.graphicsFamily.value(), 0);
 		presentQueue = device->getQueue(queueFamilyIndices.presentFamily.value(), 0);
+		transferQueue = queueFamilyIndices.transferFamily.has_value()
+		                ? device->getQueue(queueFamilyIndices.transferFamily.value(), 0)
+		                : graphicsQueue;
+
+		// Extension functions need the device in the loader
+		loader.init(*instance, *device);
+		graphicsTimeline = std::make_unique<GpuTimeline>(this, graphicsQueue);
+		if (queueFamilyIndices.transferFamily.has_value()) {
+			transferTimeline = std::make_unique<GpuTimeline>(this, transferQueue);
+		}
 	}
 
 	Device::~Device()
@@ -79,6 +102,37 @@ namespace Obtain::Graphics::Vulkan {
 		return &presentQueue;
 	}
 
+	vk::Queue *Device::getTransferQueue()
+	{
+		return &transferQueue;
+	}
+
+	bool Device::hasDedicatedTransferQueue()
+	{
+		return queueFamilyIndices.transferFamily.has_value();
+	}
+
+	GpuTimeline &Device::getGraphicsTimeline()
+	{
+		return *graphicsTimeline;
+	}
+
+	GpuTimeline &Device::getTransferTimeline()
+	{
+		return transferTimeline ? *transferTimeline : *graphicsTimeline;
+	}
+
+	GpuTimeline &Device::getTimeline(const vk::Queue &queue)
+	{
+		if (queue == graphicsQueue) {
+			return *graphicsTimeline;
+		}
+		if (queue == transferQueue) {
+			return getTransferTimeline();
+		}
+		throw std::invalid_argument("no timeline for queue");
+	}
+
 	SwapchainSupportDetails Device::querySwapchainSupport()
 	{
 		return querySwapchainSupport(physicalDevice);
@@ -143,7 +197,8 @@ namespace Obtain::Graphics::Vulkan {
 				presentMode,
 				true,
 				nullptr
-			)
+			),
+			allocationCallbacks
 		);
 	}
 
@@ -178,7 +233,8 @@ namespace Obtain::Graphics::Vulkan {
 						0U, // base array level
 						1U  // layer count
 					)
-				)
+				),
+				allocationCallbacks
 			);
 		}
 		return imageViews;
@@ -187,7 +243,7 @@ namespace Obtain::Graphics::Vulkan {
 	void Device::destroyImageViews(std::vector<vk::ImageView> imageViews)
 	{
 		for (auto imageView : imageViews) {
-			device->destroyImageView(imageView);
+			device->destroyImageView(imageView, allocationCallbacks);
 		}
 	}
 
@@ -201,16 +257,6 @@ namespace Obtain::Graphics::Vulkan {
 		).value;
 	}
 
-	uint32_t Device::nextImage(vk::UniqueSwapchainKHR &swapchain, vk::UniqueFence &triggerFence)
-	{
-		return device->acquireNextImageKHR(
-			*swapchain,
-			std::numeric_limits<uint64_t>::max(),
-			nullptr,
-			*triggerFence
-		).value;
-	}
-
 	vk::UniqueImage Device::createImage(const vk::Extent3D &extent, const vk::Format &format, uint32_t mipLevels,
 	                                    const vk::ImageTiling &tiling, const vk::ImageUsageFlags &usageFlags,
 	                                    vk::SampleCountFlagBits sampleCount)
@@ -229,7 +275,7 @@ namespace Obtain::Graphics::Vulkan {
 		                               nullptr,
 		                               vk::ImageLayout::eUndefined);
 
-		return device->createImageUnique(createInfo);
+		return device->createImageUnique(createInfo, allocationCallbacks);
 	}
 
 	vk::UniqueImageView Device::createImageView(vk::UniqueImage &image, const vk::Format &format, uint32_t mipLevels,
@@ -254,7 +300,8 @@ namespace Obtain::Graphics::Vulkan {
 					0U, // base array level
 					1U  // layer count
 				)
-			)
+			),
+			allocationCallbacks
 		);
 	}
 
@@ -276,7 +323,7 @@ namespace Obtain::Graphics::Vulkan {
 		                                 mipLevels,
 		                                 vk::BorderColor::eIntOpaqueBlack,
 		                                 false);
-		return device->createSamplerUnique(createInfo);
+		return device->createSamplerUnique(createInfo, allocationCallbacks);
 	}
 
 	vk::FormatProperties Device::getFormatProperties(const vk::Format &format)
@@ -284,18 +331,15 @@ namespace Obtain::Graphics::Vulkan {
 		return physicalDevice.getFormatProperties(format);
 	}
 
-	vk::MemoryRequirements Device::getImageMemoryRequirements(vk::UniqueImage &image)
+	MemoryAllocation Device::allocateImageMemory(vk::UniqueImage &image, const vk::MemoryPropertyFlags &properties,
+	                                             const vk::ImageTiling &tiling, MemoryCategory category, bool transient)
 	{
-		return device->getImageMemoryRequirements(*image);
-	}
-
-	void Device::bindImageMemory(vk::UniqueImage &image, vk::UniqueDeviceMemory &memory, uint32_t offset)
-	{
-		device->bindImageMemory(
-			*image,
-			*memory,
-			offset
-		);
+		auto allocation = memoryAllocator->allocate(device->getImageMemoryRequirements(*image), properties,
+		                                            tiling == vk::ImageTiling::eLinear, category,
+		                                            transient ? vk::MemoryPropertyFlags(vk::MemoryPropertyFlagBits::eLazilyAllocated)
+		                                                      : vk::MemoryPropertyFlags());
+		device->bindImageMemory(*image, allocation.getMemory(), allocation.getOffset());
+		return allocation;
 	}
 
 	vk::UniqueDescriptorSetLayout Device::createDescriptorSetLayout()
@@ -303,7 +347,7 @@ namespace Obtain::Graphics::Vulkan {
 		std::array<vk::DescriptorSetLayoutBinding, 2> bindings = {
 			vk::DescriptorSetLayoutBinding(
 				0,
-				vk::DescriptorType::eUniformBuffer,
+				vk::DescriptorType::eUniformBufferDynamic,
 				1,
 				vk::ShaderStageFlagBits::eVertex,
 				nullptr
@@ -322,14 +366,15 @@ namespace Obtain::Graphics::Vulkan {
 				vk::DescriptorSetLayoutCreateFlags(),
 				bindings.size(),
 				bindings.data()
-			)
+			),
+			allocationCallbacks
 		);
 	}
 
 	vk::UniqueDescriptorPool Device::createDescriptorPool(uint32_t size)
 	{
 		std::array<vk::DescriptorPoolSize, 2> poolSizes = {
-			vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer,
+			vk::DescriptorPoolSize(vk::DescriptorType::eUniformBufferDynamic,
 			                       size),
 			vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler,
 			                       size)
@@ -340,16 +385,56 @@ namespace Obtain::Graphics::Vulkan {
 		                                        poolSizes.size(),
 		                                        poolSizes.data());
 
-		return device->createDescriptorPoolUnique(createInfo);
+		return device->createDescriptorPoolUnique(createInfo, allocationCallbacks);
+	}
+
+
+	vk::UniqueDescriptorSetLayout Device::createDescriptorSetLayout(
+		const std::vector<vk::DescriptorSetLayoutBinding> &bindings)
+	{
+		return device->createDescriptorSetLayoutUnique(
+			vk::DescriptorSetLayoutCreateInfo(
+				vk::DescriptorSetLayoutCreateFlags(),
+				static_cast<uint32_t>(bindings.size()),
+				bindings.data()
+			),
+			allocationCallbacks
+		);
+	}
+
+	vk::UniqueDescriptorPool Device::createDescriptorPool(const std::vector<vk::DescriptorPoolSize> &poolSizes,
+	                                                      uint32_t maxSets)
+	{
+		vk::DescriptorPoolCreateInfo createInfo(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
+		                                        maxSets,
+		                                        static_cast<uint32_t>(poolSizes.size()),
+		                                        poolSizes.data());
+
+		return device->createDescriptorPoolUnique(createInfo, allocationCallbacks);
 	}
 
+	std::vector<vk::UniqueDescriptorSet> Device::allocateDescriptorSets(uint32_t count,
+	                                                                    vk::UniqueDescriptorSetLayout &descriptorSetLayout,
+	                                                                    vk::UniqueDescriptorPool &descriptorPool)
+	{
+		std::vector<vk::DescriptorSetLayout> layouts(count, *descriptorSetLayout);
+
+		return device->allocateDescriptorSetsUnique(
+			vk::DescriptorSetAllocateInfo(*descriptorPool, count, layouts.data())
+		);
+	}
+
+	void Device::updateDescriptorSets(const std::vector<vk::WriteDescriptorSet> &writeOps)
+	{
+		device->updateDescriptorSets(writeOps, nullptr);
+	}
 
 	std::vector<vk::UniqueDescriptorSet> Device::createDescriptorSets(uint32_t size,
 	                                                                  vk::UniqueDescriptorSetLayout &descriptorSetLayout,
 	                                                                  vk::UniqueDescriptorPool &descriptorPool,
 	                                                                  vk::UniqueSampler &sampler,
 	                                                                  vk::UniqueImageView &imageView,
-	                                                                  std::vector<std::unique_ptr<Buffer>> &uniformBuffers)
+	                                                                  const vk::DescriptorBufferInfo &uniformInfo)
 	{
 		std::vector<vk::DescriptorSetLayout> layouts(size, *descriptorSetLayout);
 
@@ -360,10 +445,6 @@ namespace Obtain::Graphics::Vulkan {
 		auto descriptorSets = device->allocateDescriptorSetsUnique(allocateInfo);
 
 		for (size_t i = 0; i < size; i++) {
-			vk::DescriptorBufferInfo bufferInfo(*(uniformBuffers[i]->getBuffer()),
-			                                    0,
-			                                    sizeof(UniformBufferObject));
-
 			vk::DescriptorImageInfo imageInfo(*sampler, *imageView,
 			                                  vk::ImageLayout::eShaderReadOnlyOptimal);
 
@@ -372,9 +453,9 @@ namespace Obtain::Graphics::Vulkan {
 				                       0,
 				                       0,
 				                       1,
-				                       vk::DescriptorType::eUniformBuffer,
+				                       vk::DescriptorType::eUniformBufferDynamic,
 				                       nullptr,
-				                       &bufferInfo,
+				                       &uniformInfo,
 				                       nullptr),
 				vk::WriteDescriptorSet(*(descriptorSets[i]),
 				                       1,
@@ -391,28 +472,55 @@ namespace Obtain::Graphics::Vulkan {
 
 	vk::UniqueSemaphore Device::createSemaphore()
 	{
-		return device->createSemaphoreUnique(vk::SemaphoreCreateInfo());
+		return device->createSemaphoreUnique(vk::SemaphoreCreateInfo(), allocationCallbacks);
 	}
 
-	vk::UniqueFence Device::createFence(bool signaled)
+	vk::UniqueSemaphore Device::createTimelineSemaphore(uint64_t initialValue)
 	{
-		vk::FenceCreateFlags flags = signaled ? vk::FenceCreateFlagBits::eSignaled : vk::FenceCreateFlags();
-		return device->createFenceUnique(vk::FenceCreateInfo(flags));
+		vk::SemaphoreTypeCreateInfoKHR typeInfo(vk::SemaphoreTypeKHR::eTimeline, initialValue);
+		vk::SemaphoreCreateInfo createInfo;
+		createInfo.pNext = &typeInfo;
+		return device->createSemaphoreUnique(createInfo, allocationCallbacks);
 	}
 
-	void Device::waitForFence(vk::UniqueFence &fence)
+	uint64_t Device::getSemaphoreCounterValue(vk::Semaphore semaphore)
 	{
-		device->waitForFences(
-			1,
-			&fence.get(),
-			true,
-			std::numeric_limits<uint64_t>::max()
+		return device->getSemaphoreCounterValueKHR(semaphore, loader);
+	}
+
+	void Device::waitForSemaphore(vk::Semaphore semaphore, uint64_t value)
+	{
+		vk::SemaphoreWaitInfoKHR waitInfo(vk::SemaphoreWaitFlagsKHR(), 1u, &semaphore, &value);
+		device->waitSemaphoresKHR(waitInfo, std::numeric_limits<uint64_t>::max(), loader);
+	}
+
+	vk::UniqueQueryPool Device::createQueryPool(const vk::QueryType &type, uint32_t count,
+	                                            const vk::QueryPipelineStatisticFlags &statistics)
+	{
+		return device->createQueryPoolUnique(
+			vk::QueryPoolCreateInfo(
+				vk::QueryPoolCreateFlags(),
+				type,
+				count,
+				statistics
+			),
+			allocationCallbacks
 		);
 	}
 
-	void Device::resetFence(vk::UniqueFence &fence)
+	bool Device::getQueryResults(vk::UniqueQueryPool &queryPool, uint32_t first, uint32_t count,
+	                             uint32_t valuesPerQuery, uint64_t *results)
 	{
-		device->resetFences(1, &fence.get());
+		// Not waiting; results that are not available yet are reported as such
+		return device->getQueryPoolResults(
+			*queryPool,
+			first,
+			count,
+			count * valuesPerQuery * sizeof(uint64_t),
+			results,
+			valuesPerQuery * sizeof(uint64_t),
+			vk::QueryResultFlagBits::e64
+		) == vk::Result::eSuccess;
 	}
 
 	vk::UniqueShaderModule Device::createShaderModule(size_t size, void *data)
@@ -422,7 +530,8 @@ namespace Obtain::Graphics::Vulkan {
 				vk::ShaderModuleCreateFlags(),
 				size,
 				reinterpret_cast<uint32_t *>(data)
-			)
+			),
+			allocationCallbacks
 		);
 	}
 
@@ -435,24 +544,37 @@ namespace Obtain::Graphics::Vulkan {
 				&descriptorSetLayout.get(),
 				0,
 				nullptr
-			)
+			),
+			allocationCallbacks
+		);
+	}
+
+	vk::UniquePipeline Device::createComputePipeline(vk::UniquePipelineLayout &pipelineLayout,
+	                                                 const vk::PipelineShaderStageCreateInfo &shaderCreateInfo)
+	{
+		return device->createComputePipelineUnique(
+			nullptr,
+			vk::ComputePipelineCreateInfo(
+				vk::PipelineCreateFlags(),
+				shaderCreateInfo,
+				*pipelineLayout
+			),
+			allocationCallbacks
 		);
 	}
 
 	vk::UniquePipeline Device::createGraphicsPipeline(const vk::Extent2D &extent,
 	                                                  vk::UniquePipelineLayout &pipelineLayout,
 	                                                  vk::UniqueRenderPass &renderPass,
-	                                                  vk::PipelineShaderStageCreateInfo *shaderCreateInfos)
+	                                                  vk::PipelineShaderStageCreateInfo *shaderCreateInfos,
+	                                                  const VertexInputDescription &vertexInput)
 	{
-		auto bindingDescription = Vertex::getBindingDescription();
-		auto attributeDescriptions = Vertex::getAttributeDescriptions();
-
 		vk::PipelineVertexInputStateCreateInfo vertexInputStateCreateInfo(
 			vk::PipelineVertexInputStateCreateFlags(),
 			1,
-			&bindingDescription,
-			static_cast<uint32_t>(attributeDescriptions.size()),
-			attributeDescriptions.data()
+			&vertexInput.binding,
+			static_cast<uint32_t>(vertexInput.attributes.size()),
+			vertexInput.attributes.data()
 		);
 
 		vk::PipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo(
@@ -568,10 +690,13 @@ namespace Obtain::Graphics::Vulkan {
 				*pipelineLayout,
 				*renderPass,
 				0
-			)
+			),
+			allocationCallbacks
 		);
 	}
 
+	// The multisampled color and depth attachments are cleared on load and never stored, only the resolve
+	// target is, so tile-based GPUs keep them in tile memory and never write them back
 	vk::UniqueRenderPass Device::createRenderPass(const vk::Format &colorFormat, const vk::Format &depthFormat)
 	{
 		std::array<vk::AttachmentDescription, 3> attachmentDescriptions = {
@@ -579,7 +704,7 @@ namespace Obtain::Graphics::Vulkan {
 			                          colorFormat,
 			                          sampleCount,
 			                          vk::AttachmentLoadOp::eClear,
-			                          vk::AttachmentStoreOp::eStore,
+			                          vk::AttachmentStoreOp::eDontCare,
 			                          vk::AttachmentLoadOp::eDontCare,
 			                          vk::AttachmentStoreOp::eDontCare,
 			                          vk::ImageLayout::eUndefined,
@@ -652,7 +777,8 @@ namespace Obtain::Graphics::Vulkan {
 				&subpassDescription,
 				1,
 				&dependency
-			)
+			),
+			allocationCallbacks
 		);
 	}
 
@@ -684,7 +810,8 @@ namespace Obtain::Graphics::Vulkan {
 					extent.width,
 					extent.height,
 					1
-				)
+				),
+				allocationCallbacks
 			);
 		}
 		return framebuffers;
@@ -704,16 +831,43 @@ namespace Obtain::Graphics::Vulkan {
 	}
 
 
-	vk::UniqueCommandPool Device::createCommandPool()
+	vk::UniqueCommandPool Device::createCommandPool(const vk::CommandPoolCreateFlags &flags)
 	{
 		return device->createCommandPoolUnique(
 			vk::CommandPoolCreateInfo(
-				vk::CommandPoolCreateFlags(),
+				flags,
 				queueFamilyIndices.graphicsFamily.value()
-			)
+			),
+			allocationCallbacks
 		);
 	}
 
+	void Device::resetCommandPool(vk::UniqueCommandPool &pool)
+	{
+		device->resetCommandPool(*pool, vk::CommandPoolResetFlags());
+	}
+
+	vk::UniqueCommandPool Device::createTransferCommandPool(const vk::CommandPoolCreateFlags &flags)
+	{
+		return device->createCommandPoolUnique(
+			vk::CommandPoolCreateInfo(
+				flags,
+				getTransferFamily()
+			),
+			allocationCallbacks
+		);
+	}
+
+	uint32_t Device::getTransferFamily()
+	{
+		return queueFamilyIndices.transferFamily.value_or(queueFamilyIndices.graphicsFamily.value());
+	}
+
+	uint32_t Device::getGraphicsFamily()
+	{
+		return queueFamilyIndices.graphicsFamily.value();
+	}
+
 	void Device::waitIdle()
 	{
 		device->waitIdle();
@@ -724,10 +878,20 @@ namespace Obtain::Graphics::Vulkan {
 		return device->createBufferUnique(vk::BufferCreateInfo(vk::BufferCreateFlags(),
 		                                                       size,
 		                                                       usageFlags,
-		                                                       vk::SharingMode::eExclusive));
+		                                                       vk::SharingMode::eExclusive),
+		                                 allocationCallbacks);
 	}
 
 	uint32_t Device::findMemoryType(uint32_t typeFilter, const vk::MemoryPropertyFlags &properties)
+	{
+		uint32_t memoryType;
+		if (!findMemoryType(typeFilter, properties, memoryType)) {
+			throw std::runtime_error("failed to find suitable memory type!");
+		}
+		return memoryType;
+	}
+
+	bool Device::findMemoryType(uint32_t typeFilter, const vk::MemoryPropertyFlags &properties, uint32_t &memoryType)
 	{
 		auto memoryProperties = physicalDevice.getMemoryProperties();
 
@@ -735,57 +899,86 @@ namespace Obtain::Graphics::Vulkan {
 			if ((typeFilter & (1u << i)) &&
 			    memoryProperties.memoryTypes[i].propertyFlags.operator&(properties) == properties
 				) {
-				return i;
+				memoryType = i;
+				return true;
 			}
 		}
-		throw std::runtime_error("failed to find suitable memory type!");
+		return false;
 	}
 
-	vk::UniqueDeviceMemory Device::allocateMemory(vk::DeviceSize size, uint32_t memoryType)
+	vk::DeviceSize Device::getHeapHeadroom(const vk::MemoryPropertyFlags &properties)
 	{
-		return device->allocateMemoryUnique(
-			vk::MemoryAllocateInfo(
-				size,
-				memoryType
-			)
-		);
+		uint32_t memoryType;
+		if (!findMemoryType(~0u, properties, memoryType)) {
+			return 0u;
+		}
+
+		const auto &heap = getMemoryBudgets()[physicalDevice.getMemoryProperties().memoryTypes[memoryType].heapIndex];
+		return heap.budget > heap.usage ? heap.budget - heap.usage : 0u;
 	}
 
+	MemoryAllocation Device::allocateBufferMemory(vk::UniqueBuffer &buffer, const vk::MemoryPropertyFlags &properties,
+	                                              MemoryCategory category, bool persistentlyMapped)
+	{
+		auto allocation = memoryAllocator->allocate(device->getBufferMemoryRequirements(*buffer), properties, true,
+		                                            category, {}, persistentlyMapped);
+		device->bindBufferMemory(*buffer, allocation.getMemory(), allocation.getOffset());
+		return allocation;
+	}
 
-	vk::MemoryRequirements Device::getBufferMemoryRequirements(vk::UniqueBuffer &buffer)
+	MemoryAllocation Device::allocateCompactedBufferMemory(vk::UniqueBuffer &buffer, const MemoryAllocation &current)
 	{
-		return device->getBufferMemoryRequirements(*buffer);
+		return memoryAllocator->allocateCompacted(current, device->getBufferMemoryRequirements(*buffer), true);
 	}
 
-	void Device::bindBufferMemory(vk::UniqueBuffer &buffer, vk::UniqueDeviceMemory &memory, uint32_t offset)
+	void Device::bindBufferMemory(vk::UniqueBuffer &buffer, const MemoryAllocation &memory)
 	{
-		device->bindBufferMemory(
-			*buffer,
-			*memory,
-			offset
-		);
+		device->bindBufferMemory(*buffer, memory.getMemory(), memory.getOffset());
 	}
 
-	void *Device::mapMemory(vk::UniqueDeviceMemory &memory, uint32_t offset, vk::DeviceSize size)
+	float Device::getMemoryBlockUsage(const MemoryAllocation &allocation)
 	{
-		return device->mapMemory(*memory, offset, size);
+		return memoryAllocator->getBlockUsage(allocation);
 	}
 
-	void Device::unmapMemory(vk::UniqueDeviceMemory &memory)
+	std::vector<MemoryHeapStatistics> Device::getMemoryStatistics()
 	{
-		device->unmapMemory(*memory);
+		return memoryAllocator->getStatistics();
 	}
 
-	void Device::setMemory(vk::UniqueDeviceMemory &memory, uint32_t offset, vk::DeviceSize size, void *src)
+	std::array<MemoryCategoryStatistics, MemoryCategoryCount> Device::getMemoryCategoryStatistics()
 	{
-		void *dest = mapMemory(memory, offset, size);
+		return memoryAllocator->getCategoryStatistics();
+	}
 
-		memcpy(
-			dest,
-			src,
-			static_cast<size_t>(size));
+	HostAllocator &Device::getHostAllocator()
+	{
+		return *hostAllocator;
+	}
 
-		unmapMemory(memory);
+	std::vector<MemoryHeapBudget> Device::getMemoryBudgets()
+	{
+		std::vector<MemoryHeapBudget> budgets;
+		if (memoryBudget) {
+			auto properties = physicalDevice.getMemoryProperties2<vk::PhysicalDeviceMemoryProperties2,
+			                                                      vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+			uint32_t heapCount = properties.get<vk::PhysicalDeviceMemoryProperties2>().memoryProperties.memoryHeapCount;
+			const auto &budget = properties.get<vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+			for (uint32_t i = 0; i < heapCount; i++) {
+				budgets.push_back({budget.heapBudget[i], budget.heapUsage[i]});
+			}
+			return budgets;
+		}
+
+		for (const auto &heap : memoryAllocator->getStatistics()) {
+			budgets.push_back({heap.heapSize, heap.blockBytes});
+		}
+		return budgets;
+	}
+
+	bool Device::hasMemoryBudget()
+	{
+		return memoryBudget;
 	}
 
 	bool Device::windowOpen()
@@ -834,6 +1027,22 @@ namespace Obtain::Graphics::Vulkan {
 		return sampleCount;
 	}
 
+	bool Device::supportsPipelineStatistics()
+	{
+		return pipelineStatisticsQuery == VK_TRUE;
+	}
+
+	// How many draws one drawIndexedIndirect call may issue, 1 without multiDrawIndirect
+	uint32_t Device::getMaxDrawIndirectCount()
+	{
+		return multiDrawIndirect == VK_TRUE ? physicalDevice.getProperties().limits.maxDrawIndirectCount : 1u;
+	}
+
+	vk::DeviceSize Device::getMinUniformBufferOffsetAlignment()
+	{
+		return physicalDevice.getProperties().limits.minUniformBufferOffsetAlignment;
+	}
+
 
 	/******************************************
 	 ***************** private *****************
@@ -884,15 +1093,23 @@ namespace Obtain::Graphics::Vulkan {
 				&presentSupport
 			);
 
-			if (queueFamily.queueCount > 0 && presentSupport) {
+			if (queueFamily.queueCount > 0 && presentSupport && !indices.presentFamily.has_value()) {
 				indices.presentFamily = i;
 			}
 
-			if (queueFamily.queueCount > 0 && queueFamily.queueFlags & vk::QueueFlagBits::eGraphics) {
+			if (queueFamily.queueCount > 0 && queueFamily.queueFlags & vk::QueueFlagBits::eGraphics &&
+			    !indices.graphicsFamily.has_value()) {
 				indices.graphicsFamily = i;
 			}
 
-			if (indices.isComplete()) {
+			// Transfer is implied by graphics and compute, a family without either exists only for copies
+			if (queueFamily.queueCount > 0 && queueFamily.queueFlags & vk::QueueFlagBits::eTransfer &&
+			    !(queueFamily.queueFlags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute)) &&
+			    !indices.transferFamily.has_value()) {
+				indices.transferFamily = i;
+			}
+
+			if (indices.isComplete() && indices.transferFamily.has_value()) {
 				break;
 			}
 
@@ -942,6 +1159,9 @@ namespace Obtain::Graphics::Vulkan {
 			queueFamilyIndices.presentFamily
 				.value()
 		};
+		if (queueFamilyIndices.transferFamily.has_value()) {
+			uniqueQueueFamilies.insert(queueFamilyIndices.transferFamily.value());
+		}
 
 		for (uint32_t queueFamily : uniqueQueueFamilies) {
 			queueCreateInfos.emplace_back(
@@ -957,41 +1177,69 @@ namespace Obtain::Graphics::Vulkan {
 		vk::PhysicalDeviceFeatures deviceFeatures = vk::PhysicalDeviceFeatures();
 		deviceFeatures.samplerAnisotropy = true;
 		deviceFeatures.sampleRateShading = true;
+		// Optional, only used to report fragment shader invocations. They are queried around secondary
+		// command buffers, which have to inherit the query.
+		auto supportedFeatures = physicalDevice.getFeatures();
+		pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery && supportedFeatures.inheritedQueries;
+		deviceFeatures.pipelineStatisticsQuery = pipelineStatisticsQuery;
+		deviceFeatures.inheritedQueries = pipelineStatisticsQuery;
+		// Optional, meshlet draws fall back to one drawIndexedIndirect call each
+		multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+		deviceFeatures.multiDrawIndirect = multiDrawIndirect;
 		std::vector<const char *> validationLayers = Validation::getValidationLayers();
 
-		return physicalDevice.createDeviceUnique(
-			vk::DeviceCreateInfo(
-				vk::DeviceCreateFlags(),
-				static_cast<uint32_t>(queueCreateInfos.size()),
-				queueCreateInfos.data(),
-				static_cast<uint32_t>(validationLayers.size()),
-				validationLayers.empty() ? (const char *const *) nullptr : validationLayers.data(),
-				static_cast<uint32_t>(deviceExtensions.size()),
-				deviceExtensions.data(),
-				&deviceFeatures
-			)
+		// Optional, without it memory budgets fall back to heap sizes
+		std::vector<const char *> extensions = deviceExtensions;
+		auto availableExtensions = physicalDevice.enumerateDeviceExtensionProperties();
+		memoryBudget = std::any_of(availableExtensions.begin(), availableExtensions.end(),
+		                           [](const vk::ExtensionProperties &extension) {
+			                           return std::string(extension.extensionName) ==
+			                                  VK_EXT_MEMORY_BUDGET_EXTENSION_NAME;
+		                           });
+		if (memoryBudget) {
+			extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+		}
+
+		vk::DeviceCreateInfo createInfo(
+			vk::DeviceCreateFlags(),
+			static_cast<uint32_t>(queueCreateInfos.size()),
+			queueCreateInfos.data(),
+			static_cast<uint32_t>(validationLayers.size()),
+			validationLayers.empty() ? (const char *const *) nullptr : validationLayers.data(),
+			static_cast<uint32_t>(extensions.size()),
+			extensions.data(),
+			&deviceFeatures
 		);
+		// Every submission is tracked on a timeline semaphore
+		vk::PhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures(true);
+		createInfo.pNext = &timelineFeatures;
+
+		return physicalDevice.createDeviceUnique(createInfo, allocationCallbacks);
 	}
 
-	vk::UniqueSurfaceKHR Device::createSurface(const vk::Instance &instance, GLFWwindow *window)
+	vk::UniqueSurfaceKHR Device::createSurface(const vk::Instance &instance, GLFWwindow *window,
+	                                           const vk::AllocationCallbacks *allocationCallbacks)
 	{
 		VkSurfaceKHR surface;
 
 		if (glfwCreateWindowSurface(
 			instance,
 			window,
-			nullptr,
+			reinterpret_cast<const VkAllocationCallbacks *>(allocationCallbacks),
 			&surface
 		) != VK_SUCCESS) {
 			throw std::runtime_error("could not create surface");
 		}
 		return vk::UniqueSurfaceKHR(
 			surface,
-			instance
+			vk::ObjectDestroy<vk::Instance, vk::DispatchLoaderStatic>(instance, allocationCallbacks)
 		);
 	}
 
-	const std::vector<const char *> Device::deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+	const std::vector<const char *> Device::deviceExtensions = {
+		VK_KHR_SWAPCHAIN_EXTENSION_NAME,
+		VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME
+	};
 
 	uint32_t Device::ratePhysicalDeviceSuitability(const vk::PhysicalDevice &physicalDeviceCandidate)
 	{
@@ -1134,7 +1382,8 @@ namespace Obtain::Graphics::Vulkan {
 				useValidationLayers ? Validation::validationLayers.data() : nullptr,
 				static_cast<uint32_t>(requiredExtensions.size()),
 				requiredExtensions.data()
-			)
+			),
+			allocationCallbacks
 		);
 
 		loader.init(*instance);
@@ -8,10 +8,12 @@
 
 #include "queue-family-indices.hpp"
 #include "swapchain-support-details.hpp"
+#include "vertex-layout.hpp"
+#include "memory-allocator.hpp"
+#include "host-allocator.hpp"
+#include "gpu-timeline.hpp"
 
 namespace Obtain::Graphics::Vulkan {
-	class Buffer; // Forward declaration
-
 	class Device {
 	public:
 		Device(const std::string &gameTitle,
@@ -23,6 +25,17 @@ namespace Obtain::Graphics::Vulkan {
 		QueueFamilyIndices getQueueFamilies();
 		vk::Queue *getGraphicsQueue();
 		vk::Queue *getPresentQueue();
+		// The queue of the dedicated transfer family, the graphics queue when there is none
+		vk::Queue *getTransferQueue();
+		bool hasDedicatedTransferQueue();
+		uint32_t getGraphicsFamily();
+		uint32_t getTransferFamily();
+		// Numbers the submissions to the graphics and transfer queue; the same timeline for both when
+		// there is no dedicated transfer queue
+		GpuTimeline &getGraphicsTimeline();
+		GpuTimeline &getTransferTimeline();
+		// Timeline of queue, which has to be the graphics or transfer queue
+		GpuTimeline &getTimeline(const vk::Queue &queue);
 
 		SwapchainSupportDetails querySwapchainSupport();
 		SwapchainSupportDetails querySwapchainSupport(vk::PhysicalDevice physicalDeviceCandidate);
@@ -33,7 +46,6 @@ namespace Obtain::Graphics::Vulkan {
 		std::vector<vk::ImageView> generateSwapchainImageViews(std::vector<vk::Image> &images, const vk::Format &format);
 		void destroyImageViews(std::vector<vk::ImageView> imageViews);
 		uint32_t nextImage(vk::UniqueSwapchainKHR &swapchain, vk::UniqueSemaphore &triggerSemaphore);
-		uint32_t nextImage(vk::UniqueSwapchainKHR &swapchain, vk::UniqueFence &triggerFence);
 		vk::UniqueImage createImage(const vk::Extent3D &extent, const vk::Format &format, uint32_t mipLevels,
 		                            const vk::ImageTiling &tiling, const vk::ImageUsageFlags &usageFlags,
 		                            vk::SampleCountFlagBits sampleCount = vk::SampleCountFlagBits::e1);
@@ -42,29 +54,47 @@ namespace Obtain::Graphics::Vulkan {
 		vk::UniqueSampler createSampler(float mipLevels);
 		vk::FormatProperties getFormatProperties(const vk::Format &format);
 
-		vk::MemoryRequirements getImageMemoryRequirements(vk::UniqueImage &image);
-		void bindImageMemory(vk::UniqueImage &image, vk::UniqueDeviceMemory &memory, uint32_t offset);
+		// Sub-allocates memory for image and binds it, transient attachments in lazily allocated memory
+		// where there is some, which tile-based GPUs never back with real memory
+		MemoryAllocation allocateImageMemory(vk::UniqueImage &image, const vk::MemoryPropertyFlags &properties,
+		                                     const vk::ImageTiling &tiling, MemoryCategory category,
+		                                     bool transient = false);
 
 		vk::UniqueDescriptorSetLayout createDescriptorSetLayout();
 		vk::UniqueDescriptorPool createDescriptorPool(uint32_t size);
+		vk::UniqueDescriptorSetLayout createDescriptorSetLayout(const std::vector<vk::DescriptorSetLayoutBinding> &bindings);
+		vk::UniqueDescriptorPool createDescriptorPool(const std::vector<vk::DescriptorPoolSize> &poolSizes, uint32_t maxSets);
+		std::vector<vk::UniqueDescriptorSet> allocateDescriptorSets(uint32_t count,
+		                                                            vk::UniqueDescriptorSetLayout &descriptorSetLayout,
+		                                                            vk::UniqueDescriptorPool &descriptorPool);
+		void updateDescriptorSets(const std::vector<vk::WriteDescriptorSet> &writeOps);
 		std::vector<vk::UniqueDescriptorSet> createDescriptorSets(uint32_t size,
 		                                                          vk::UniqueDescriptorSetLayout &descriptorSetLayout,
 		                                                          vk::UniqueDescriptorPool &descriptorPool,
 		                                                          vk::UniqueSampler &sampler,
 		                                                          vk::UniqueImageView &imageView,
-		                                                          std::vector<std::unique_ptr<Buffer>> &uniformBuffers);
+		                                                          const vk::DescriptorBufferInfo &uniformInfo);
 
 		vk::UniqueSemaphore createSemaphore();
-		vk::UniqueFence createFence(bool signaled = false);
-		void waitForFence(vk::UniqueFence &fence);
-		void resetFence(vk::UniqueFence &fence);
+		vk::UniqueSemaphore createTimelineSemaphore(uint64_t initialValue);
+		uint64_t getSemaphoreCounterValue(vk::Semaphore semaphore);
+		// Blocks until the timeline semaphore reaches value
+		void waitForSemaphore(vk::Semaphore semaphore, uint64_t value);
+
+		vk::UniqueQueryPool createQueryPool(const vk::QueryType &type, uint32_t count,
+		                                    const vk::QueryPipelineStatisticFlags &statistics = {});
+		bool getQueryResults(vk::UniqueQueryPool &queryPool, uint32_t first, uint32_t count,
+		                     uint32_t valuesPerQuery, uint64_t *results);
 
 		vk::UniqueShaderModule createShaderModule(size_t size, void *data);
 		vk::UniqueRenderPass createRenderPass(const vk::Format &colorFormat, const vk::Format &depthFormat);
 		vk::UniquePipeline createGraphicsPipeline(const vk::Extent2D &extent,
 		                                          vk::UniquePipelineLayout &pipelineLayout,
 		                                          vk::UniqueRenderPass &renderPass,
-		                                          vk::PipelineShaderStageCreateInfo *shaderCreateInfos);
+		                                          vk::PipelineShaderStageCreateInfo *shaderCreateInfos,
+		                                          const VertexInputDescription &vertexInput);
+		vk::UniquePipeline createComputePipeline(vk::UniquePipelineLayout &pipelineLayout,
+		                                         const vk::PipelineShaderStageCreateInfo &shaderCreateInfo);
 		std::vector<vk::UniqueFramebuffer> createFramebuffers(std::vector<vk::ImageView> imageViews,
 		                                                      vk::UniqueImageView &colorImageView,
 		                                                      vk::UniqueImageView &depthImageView,
@@ -73,21 +103,42 @@ namespace Obtain::Graphics::Vulkan {
 		std::vector<vk::UniqueCommandBuffer> allocateCommandBuffers(vk::UniqueCommandPool &commandPool,
 		                                                            vk::CommandBufferLevel level,
 		                                                            uint32_t count);
-		vk::UniqueCommandPool createCommandPool();
+		vk::UniqueCommandPool createCommandPool(const vk::CommandPoolCreateFlags &flags = vk::CommandPoolCreateFlags());
+		// Returns every command buffer of pool to the initial state, none may be pending
+		void resetCommandPool(vk::UniqueCommandPool &pool);
+		// For command buffers submitted to getTransferQueue
+		vk::UniqueCommandPool createTransferCommandPool(
+			const vk::CommandPoolCreateFlags &flags = vk::CommandPoolCreateFlags());
 
 		vk::UniquePipelineLayout createPipelineLayout(vk::UniqueDescriptorSetLayout &descriptorSetLayout);
 
 		void waitIdle();
 
 		vk::UniqueBuffer createBuffer(vk::DeviceSize size, const vk::BufferUsageFlags &usageFlags);
+		// First memory type in typeFilter with all of properties, throws when there is none
 		uint32_t findMemoryType(uint32_t typeFilter, const vk::MemoryPropertyFlags &properties);
-		vk::UniqueDeviceMemory allocateMemory(vk::DeviceSize size, uint32_t memoryType);
-		vk::MemoryRequirements getBufferMemoryRequirements(vk::UniqueBuffer &buffer);
-		void bindBufferMemory(vk::UniqueBuffer &buffer, vk::UniqueDeviceMemory &memory, uint32_t offset);
-
-		void *mapMemory(vk::UniqueDeviceMemory &memory, uint32_t offset, vk::DeviceSize size);
-		void unmapMemory(vk::UniqueDeviceMemory &memory);
-		void setMemory(vk::UniqueDeviceMemory &memory, uint32_t offset, vk::DeviceSize size, void *src);
+		// Capability query, whether some memory type in typeFilter has all of properties, e.g. device local
+		// and host visible on integrated GPUs and with resizable BAR; memoryType is set to the first
+		bool findMemoryType(uint32_t typeFilter, const vk::MemoryPropertyFlags &properties, uint32_t &memoryType);
+		// Bytes left in the budget of the heap behind the first memory type with all of properties, which
+		// counts other processes' usage where the driver reports budgets
+		vk::DeviceSize getHeapHeadroom(const vk::MemoryPropertyFlags &properties);
+		// Sub-allocates memory for buffer and binds it
+		MemoryAllocation allocateBufferMemory(vk::UniqueBuffer &buffer, const vk::MemoryPropertyFlags &properties,
+		                                      MemoryCategory category, bool persistentlyMapped = true);
+		// Unbound memory for a copy of buffer, which is bound to current, in a block that is used more than
+		// current's; empty when there is no room in such a block
+		MemoryAllocation allocateCompactedBufferMemory(vk::UniqueBuffer &buffer, const MemoryAllocation &current);
+		void bindBufferMemory(vk::UniqueBuffer &buffer, const MemoryAllocation &memory);
+		float getMemoryBlockUsage(const MemoryAllocation &allocation);
+		std::vector<MemoryHeapStatistics> getMemoryStatistics();
+		std::array<MemoryCategoryStatistics, MemoryCategoryCount> getMemoryCategoryStatistics();
+		// Per heap, from VK_EXT_memory_budget where the driver has it. Without it the budget is the heap size
+		// and the usage what the allocator has taken from the heap.
+		std::vector<MemoryHeapBudget> getMemoryBudgets();
+		bool hasMemoryBudget();
+		// Host memory the driver allocated through our callbacks, per allocation scope
+		HostAllocator &getHostAllocator();
 
 		bool windowOpen();
 		std::array<uint32_t, 2> updateWindowSizeOnceVisible();
@@ -98,7 +149,15 @@ namespace Obtain::Graphics::Vulkan {
 
 		bool hasOptimalTilingFeature(const vk::Format &format, const vk::FormatFeatureFlags &feature);
 		vk::SampleCountFlagBits getSampleCount();
+		bool supportsPipelineStatistics();
+		uint32_t getMaxDrawIndirectCount();
+		vk::DeviceSize getMinUniformBufferOffsetAlignment();
 	private:
+		// Driver host allocations go through hostAllocator; turn off to compare against the driver's own
+		static const bool TrackHostAllocations = true;
+		// Outlives the instance and everything else created with its callbacks
+		std::unique_ptr<HostAllocator> hostAllocator;
+		const vk::AllocationCallbacks *allocationCallbacks; // nullptr when not tracking
 		vk::UniqueInstance instance;
 		GLFWwindow *window;
 		bool resizeOccurred;
@@ -108,6 +167,10 @@ namespace Obtain::Graphics::Vulkan {
 		vk::PhysicalDevice physicalDevice;
 		vk::UniqueSurfaceKHR surface;
 		vk::UniqueDevice device;
+		// Destroyed before device
+		std::unique_ptr<MemoryAllocator> memoryAllocator;
+		std::unique_ptr<GpuTimeline> graphicsTimeline;
+		std::unique_ptr<GpuTimeline> transferTimeline; // null without a dedicated transfer queue
 
 		std::string gameTitle;
 		std::array<uint32_t, 3> gameVersion;
@@ -118,9 +181,13 @@ namespace Obtain::Graphics::Vulkan {
 
 		vk::Queue graphicsQueue;
 		vk::Queue presentQueue;
+		vk::Queue transferQueue;
 
 		QueueFamilyIndices queueFamilyIndices;
 		vk::SampleCountFlagBits sampleCount;
+		vk::Bool32 pipelineStatisticsQuery;
+		vk::Bool32 multiDrawIndirect;
+		bool memoryBudget;
 
 
 		void findSampleCount();
@@ -135,7 +202,8 @@ namespace Obtain::Graphics::Vulkan {
 			vk::UniqueInstance &instance
 		);
 
-		static vk::UniqueSurfaceKHR createSurface(const vk::Instance &instance, GLFWwindow *window);
+		static vk::UniqueSurfaceKHR createSurface(const vk::Instance &instance, GLFWwindow *window,
+		                                          const vk::AllocationCallbacks *allocationCallbacks);
 
 		static const std::vector<const char *> deviceExtensions;
 
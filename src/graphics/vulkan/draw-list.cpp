@@ -0,0 +1,42 @@
+#include "draw-list.hpp"
+
+#include <algorithm>
+
+namespace Obtain::Graphics::Vulkan {
+	/******************************************
+	 ***************** public *****************
+	 ******************************************/
+	void DrawList::clear()
+	{
+		items.clear();
+	}
+
+	void DrawList::add(uint32_t mesh, uint32_t material, const glm::mat4 &transform)
+	{
+		items.push_back({mesh, material, transform, static_cast<uint32_t>(items.size())});
+	}
+
+	// std::stable_sort would allocate a buffer every frame, the sequence breaks ties instead
+	void DrawList::sort()
+	{
+		std::sort(items.begin(), items.end(), [](const DrawItem &a, const DrawItem &b) {
+			if (a.material != b.material) {
+				return a.material < b.material;
+			}
+			if (a.mesh != b.mesh) {
+				return a.mesh < b.mesh;
+			}
+			return a.sequence < b.sequence;
+		});
+	}
+
+	const std::vector<DrawItem> &DrawList::getItems() const
+	{
+		return items;
+	}
+
+	size_t DrawList::size() const
+	{
+		return items.size();
+	}
+}
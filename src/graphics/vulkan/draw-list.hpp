@@ -0,0 +1,43 @@
+#ifndef OBTAIN_GRAPHICS_VULKAN_DRAW_LIST_HPP
+#define OBTAIN_GRAPHICS_VULKAN_DRAW_LIST_HPP
+
+#include <cstdint>
+#include <vector>
+
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+namespace Obtain::Graphics::Vulkan {
+	// One mesh drawn with one material, both indices into what the renderer registered
+	struct DrawItem {
+		uint32_t mesh;
+		uint32_t material;
+		glm::mat4 transform;
+		uint32_t sequence; // position in the order items were added, keeps sorting stable
+	};
+
+	/*
+	 * What to draw in a frame. Filled anew every frame and sorted before it's drawn, by material and
+	 * then mesh, so consecutive draws share bindings. Only the meshes and materials in the sorted order
+	 * decide what gets recorded, transforms reach the GPU through uniforms: a list that only moves
+	 * things around reuses the command buffers recorded for it. Capacity is kept across clear, so a
+	 * list refilled every frame stops allocating.
+	 */
+	class DrawList {
+	public:
+		void clear();
+
+		void add(uint32_t mesh, uint32_t material, const glm::mat4 &transform);
+
+		void sort();
+
+		const std::vector<DrawItem> &getItems() const;
+
+		size_t size() const;
+
+	private:
+		std::vector<DrawItem> items;
+	};
+}
+
+#endif // OBTAIN_GRAPHICS_VULKAN_DRAW_LIST_HPP
@@ -0,0 +1,289 @@
+#include "geometry-pool.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace Obtain::Graphics::Vulkan {
+	/******************************************
+	 *********** GeometryAllocation ***********
+	 ******************************************/
+
+	GeometryAllocation::GeometryAllocation()
+		: pool(nullptr), vertexOffset(0u), vertexCount(0u), vertexStride(0u), firstIndex(0u), indexCount(0u),
+		  indexType(vk::IndexType::eUint32)
+	{}
+
+	GeometryAllocation::GeometryAllocation(GeometryAllocation &&other) noexcept
+		: pool(other.pool), vertexOffset(other.vertexOffset), vertexCount(other.vertexCount),
+		  vertexStride(other.vertexStride), firstIndex(other.firstIndex), indexCount(other.indexCount),
+		  indexType(other.indexType)
+	{
+		if (pool != nullptr) {
+			pool->replace(&other, this);
+		}
+		other.pool = nullptr;
+	}
+
+	GeometryAllocation &GeometryAllocation::operator=(GeometryAllocation &&other) noexcept
+	{
+		if (this != &other) {
+			release();
+			pool = other.pool;
+			vertexOffset = other.vertexOffset;
+			vertexCount = other.vertexCount;
+			vertexStride = other.vertexStride;
+			firstIndex = other.firstIndex;
+			indexCount = other.indexCount;
+			indexType = other.indexType;
+			if (pool != nullptr) {
+				pool->replace(&other, this);
+			}
+			other.pool = nullptr;
+		}
+		return *this;
+	}
+
+	GeometryAllocation::~GeometryAllocation()
+	{
+		release();
+	}
+
+	uint32_t GeometryAllocation::getVertexOffset() const
+	{
+		return vertexOffset;
+	}
+
+	uint32_t GeometryAllocation::getVertexCount() const
+	{
+		return vertexCount;
+	}
+
+	uint32_t GeometryAllocation::getFirstIndex() const
+	{
+		return firstIndex;
+	}
+
+	uint32_t GeometryAllocation::getIndexCount() const
+	{
+		return indexCount;
+	}
+
+	vk::IndexType GeometryAllocation::getIndexType() const
+	{
+		return indexType;
+	}
+
+	void GeometryAllocation::release()
+	{
+		if (pool != nullptr) {
+			pool->free(*this);
+			pool = nullptr;
+		}
+	}
+
+	/******************************************
+	 ************** GeometryPool **************
+	 ******************************************/
+
+	GeometryPool::GeometryPool(UploadBatch &batch, vk::DeviceSize vertexCapacity, vk::DeviceSize indexCapacity)
+		: vertexBuffer(batch.createBuffer(vertexCapacity, vk::BufferUsageFlagBits::eVertexBuffer |
+		                                                  vk::BufferUsageFlagBits::eTransferSrc |
+		                                                  vk::BufferUsageFlagBits::eTransferDst,
+		                                  MemoryCategory::Geometry)),
+		  indexBuffer(batch.createBuffer(indexCapacity, vk::BufferUsageFlagBits::eIndexBuffer |
+		                                                vk::BufferUsageFlagBits::eTransferSrc |
+		                                                vk::BufferUsageFlagBits::eTransferDst,
+		                                 MemoryCategory::Geometry)),
+		  vertexRanges(vertexCapacity), indexRanges(indexCapacity)
+	{}
+
+	std::unique_ptr<GeometryPool> GeometryPool::unique(UploadBatch &batch, vk::DeviceSize vertexCapacity,
+	                                                   vk::DeviceSize indexCapacity)
+	{
+		return std::make_unique<GeometryPool>(GeometryPool(batch, vertexCapacity, indexCapacity));
+	}
+
+	GeometryAllocation GeometryPool::allocate(uint32_t vertexCount, uint32_t vertexStride, uint32_t indexCount,
+	                                          vk::IndexType indexType)
+	{
+		uint32_t indexSize = getIndexSize(indexType);
+
+		vk::DeviceSize vertexStart = vertexRanges.allocate(static_cast<vk::DeviceSize>(vertexCount) * vertexStride,
+		                                                   vertexStride);
+		if (vertexStart == RangeAllocator::NoSpace) {
+			throw std::runtime_error("geometry pool is out of vertex space!");
+		}
+		vk::DeviceSize indexStart = indexRanges.allocate(static_cast<vk::DeviceSize>(indexCount) * indexSize,
+		                                                 indexSize);
+		if (indexStart == RangeAllocator::NoSpace) {
+			vertexRanges.free(vertexStart, static_cast<vk::DeviceSize>(vertexCount) * vertexStride);
+			throw std::runtime_error("geometry pool is out of index space!");
+		}
+
+		GeometryAllocation allocation;
+		allocation.pool = this;
+		allocation.vertexOffset = static_cast<uint32_t>(vertexStart / vertexStride);
+		allocation.vertexCount = vertexCount;
+		allocation.vertexStride = vertexStride;
+		allocation.firstIndex = static_cast<uint32_t>(indexStart / indexSize);
+		allocation.indexCount = indexCount;
+		allocation.indexType = indexType;
+		allocations.push_back(&allocation);
+		return allocation;
+	}
+
+	void GeometryPool::upload(UploadBatch &batch, const GeometryAllocation &allocation, const void *vertices,
+	                          const void *indices)
+	{
+		if (vertexBuffer->isMovable() || indexBuffer->isMovable()) {
+			throw std::logic_error("uploading into geometry pool buffers registered with the defragmenter!");
+		}
+		uint32_t indexSize = getIndexSize(allocation.indexType);
+		batch.copyToBuffer(vertices, static_cast<vk::DeviceSize>(allocation.vertexCount) * allocation.vertexStride,
+		                   vertexBuffer, static_cast<vk::DeviceSize>(allocation.vertexOffset) * allocation.vertexStride);
+		batch.copyToBuffer(indices, static_cast<vk::DeviceSize>(allocation.indexCount) * indexSize,
+		                   indexBuffer, static_cast<vk::DeviceSize>(allocation.firstIndex) * indexSize);
+	}
+
+	void GeometryPool::bind(vk::CommandBuffer commandBuffer, vk::IndexType indexType)
+	{
+		vk::Buffer vertexBuffers[] = {*(vertexBuffer->getBuffer())};
+		vk::DeviceSize offsets[] = {vertexBuffer->getOffset()};
+		commandBuffer.bindVertexBuffers(0, 1, vertexBuffers, offsets);
+		commandBuffer.bindIndexBuffer(*(indexBuffer->getBuffer()), indexBuffer->getOffset(), indexType);
+	}
+
+	std::unique_ptr<Buffer> &GeometryPool::getVertexBuffer()
+	{
+		return vertexBuffer;
+	}
+
+	std::unique_ptr<Buffer> &GeometryPool::getIndexBuffer()
+	{
+		return indexBuffer;
+	}
+
+	vk::DeviceSize GeometryPool::getUsedBytes()
+	{
+		return vertexRanges.getUsedBytes() + indexRanges.getUsedBytes();
+	}
+
+	vk::DeviceSize GeometryPool::getCapacity()
+	{
+		return vertexRanges.getCapacity() + indexRanges.getCapacity();
+	}
+
+	bool GeometryPool::beginMove(RangeMove &move)
+	{
+		if (pendingMove || !fragmented) {
+			return false;
+		}
+		if (findMove(false, move) || findMove(true, move)) {
+			return true;
+		}
+		fragmented = false;
+		return false;
+	}
+
+	bool GeometryPool::endMove(bool copied)
+	{
+		std::unique_ptr<PendingMove> move = std::move(pendingMove);
+		GeometryAllocation *allocation = move->allocation;
+		if (allocation == nullptr || !copied) {
+			retired.push_back({move->indices, move->target, move->size});
+			return false;
+		}
+
+		if (move->indices) {
+			allocation->firstIndex = static_cast<uint32_t>(move->target / getIndexSize(allocation->indexType));
+		} else {
+			allocation->vertexOffset = static_cast<uint32_t>(move->target / allocation->vertexStride);
+		}
+		retired.push_back({move->indices, move->source, move->size});
+		return true;
+	}
+
+	void GeometryPool::releaseRetired()
+	{
+		for (const auto &range : retired) {
+			(range.indices ? indexRanges : vertexRanges).free(range.offset, range.size);
+			fragmented = true;
+		}
+		retired.clear();
+	}
+
+	/******************************************
+	 ***************** private *****************
+	 ******************************************/
+
+	uint32_t GeometryPool::getIndexSize(vk::IndexType indexType)
+	{
+		return indexType == vk::IndexType::eUint16 ? 2u : 4u;
+	}
+
+	// First fit hands out the lowest free range that fits, so a range either gets one below it or none
+	// below it fits; the highest ranges are tried first as moving them frees the end of the buffer
+	bool GeometryPool::findMove(bool indices, RangeMove &move)
+	{
+		struct Range {
+			vk::DeviceSize offset;
+			vk::DeviceSize size;
+			vk::DeviceSize alignment;
+			GeometryAllocation *allocation;
+		};
+
+		std::vector<Range> candidates;
+		for (GeometryAllocation *allocation : allocations) {
+			vk::DeviceSize elementSize = indices ? getIndexSize(allocation->indexType) : allocation->vertexStride;
+			vk::DeviceSize first = indices ? allocation->firstIndex : allocation->vertexOffset;
+			vk::DeviceSize count = indices ? allocation->indexCount : allocation->vertexCount;
+			if (count > 0u) {
+				candidates.push_back({first * elementSize, count * elementSize, elementSize, allocation});
+			}
+		}
+		std::sort(candidates.begin(), candidates.end(), [](const Range &a, const Range &b) {
+			return a.offset > b.offset;
+		});
+
+		RangeAllocator &ranges = indices ? indexRanges : vertexRanges;
+		for (const Range &candidate : candidates) {
+			vk::DeviceSize target = ranges.allocate(candidate.size, candidate.alignment);
+			if (target == RangeAllocator::NoSpace) {
+				continue;
+			}
+			if (target < candidate.offset) {
+				pendingMove = std::unique_ptr<PendingMove>(new PendingMove{
+					candidate.allocation, indices, candidate.offset, target, candidate.size
+				});
+				move = {indices ? indexBuffer.get() : vertexBuffer.get(), candidate.offset, target, candidate.size};
+				return true;
+			}
+			ranges.free(target, candidate.size);
+		}
+		return false;
+	}
+
+	void GeometryPool::replace(GeometryAllocation *previous, GeometryAllocation *allocation)
+	{
+		std::replace(allocations.begin(), allocations.end(), previous, allocation);
+		if (pendingMove && pendingMove->allocation == previous) {
+			pendingMove->allocation = allocation;
+		}
+	}
+
+	void GeometryPool::free(const GeometryAllocation &allocation)
+	{
+		// A mesh freed while it is moved leaves its new range to endMove
+		if (pendingMove && pendingMove->allocation == &allocation) {
+			pendingMove->allocation = nullptr;
+		}
+		allocations.erase(std::remove(allocations.begin(), allocations.end(), &allocation), allocations.end());
+		fragmented = true;
+
+		uint32_t indexSize = getIndexSize(allocation.indexType);
+		vertexRanges.free(static_cast<vk::DeviceSize>(allocation.vertexOffset) * allocation.vertexStride,
+		                  static_cast<vk::DeviceSize>(allocation.vertexCount) * allocation.vertexStride);
+		indexRanges.free(static_cast<vk::DeviceSize>(allocation.firstIndex) * indexSize,
+		                 static_cast<vk::DeviceSize>(allocation.indexCount) * indexSize);
+	}
+}
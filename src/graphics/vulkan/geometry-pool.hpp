@@ -0,0 +1,144 @@
+#ifndef OBTAIN_GRAPHICS_VULKAN_GEOMETRY_POOL_HPP
+#define OBTAIN_GRAPHICS_VULKAN_GEOMETRY_POOL_HPP
+
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "buffer.hpp"
+#include "range-allocator.hpp"
+#include "upload-batch.hpp"
+
+namespace Obtain::Graphics::Vulkan {
+	class GeometryPool;
+
+	/*
+	 * A mesh in a GeometryPool: vertexOffset and firstIndex go straight into draw commands, so draws
+	 * of any mesh in the pool only need the pool's buffers bound. Returns its ranges to the pool when
+	 * destroyed.
+	 */
+	class GeometryAllocation {
+	public:
+		GeometryAllocation();
+		GeometryAllocation(GeometryAllocation &&other) noexcept;
+		GeometryAllocation &operator=(GeometryAllocation &&other) noexcept;
+		GeometryAllocation(const GeometryAllocation &) = delete;
+		GeometryAllocation &operator=(const GeometryAllocation &) = delete;
+		~GeometryAllocation();
+
+		uint32_t getVertexOffset() const;
+		uint32_t getVertexCount() const;
+		uint32_t getFirstIndex() const;
+		uint32_t getIndexCount() const;
+		vk::IndexType getIndexType() const;
+
+	private:
+		friend class GeometryPool;
+
+		GeometryPool *pool;
+		uint32_t vertexOffset;
+		uint32_t vertexCount;
+		uint32_t vertexStride;
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		vk::IndexType indexType;
+
+		void release();
+	};
+
+	/*
+	 * One vertex buffer and one index buffer shared by all meshes, with a range allocator each.
+	 * Ranges are aligned to the vertex stride and index size of the mesh, so meshes with different
+	 * vertex formats and index types can share the pool; the index buffer is bound once per index
+	 * type. Uploads write the buffers in place, so they have to be finished before the pool is handed
+	 * to the defragmenter, and new meshes need it removed from the defragmenter first.
+	 *
+	 * The buffers are as large as a memory block or larger, so they have blocks of their own and never
+	 * move; the holes freed meshes leave are inside them. The defragmenter closes those by moving the
+	 * highest mesh ranges down into free ranges below them, one range at a time, and the allocation
+	 * handles are pointed at the new ranges once they're copied.
+	 */
+	class GeometryPool {
+	public:
+		// The vertices or indices of a mesh being copied to a lower free range of the same buffer
+		struct RangeMove {
+			Buffer *buffer;
+			vk::DeviceSize source;
+			vk::DeviceSize target;
+			vk::DeviceSize size;
+		};
+
+		// The buffers are created through batch, so they are written directly where the batch can, and with
+		// transfer usage so the defragmenter can move them
+		GeometryPool(UploadBatch &batch, vk::DeviceSize vertexCapacity, vk::DeviceSize indexCapacity);
+
+		static std::unique_ptr<GeometryPool> unique(UploadBatch &batch, vk::DeviceSize vertexCapacity,
+		                                            vk::DeviceSize indexCapacity);
+
+		// Throws when either buffer has no free range large enough
+		GeometryAllocation allocate(uint32_t vertexCount, uint32_t vertexStride, uint32_t indexCount,
+		                            vk::IndexType indexType);
+
+		// Records the upload of all vertices and indices of allocation into batch; throws while the buffers
+		// are registered with the defragmenter
+		void upload(UploadBatch &batch, const GeometryAllocation &allocation, const void *vertices,
+		            const void *indices);
+
+		void bind(vk::CommandBuffer commandBuffer, vk::IndexType indexType);
+
+		std::unique_ptr<Buffer> &getVertexBuffer();
+
+		std::unique_ptr<Buffer> &getIndexBuffer();
+
+		vk::DeviceSize getUsedBytes();
+
+		vk::DeviceSize getCapacity();
+
+		// Reserves the lowest free range for the highest mesh range that has one below it; false when no
+		// range can move down. Only one move may be in progress.
+		bool beginMove(RangeMove &move);
+
+		// Once the copy of the move is complete: points the mesh at its new range and retires the old one.
+		// Returns false when the mesh was freed during the move or copied is false, which retire the new
+		// range instead.
+		bool endMove(bool copied = true);
+
+		// Frees the ranges retired by endMove, once nothing reads them any more
+		void releaseRetired();
+
+	private:
+		friend class GeometryAllocation;
+
+		struct PendingMove {
+			GeometryAllocation *allocation; // nullptr once the mesh is freed
+			bool indices;
+			vk::DeviceSize source;
+			vk::DeviceSize target;
+			vk::DeviceSize size;
+		};
+
+		struct RetiredRange {
+			bool indices;
+			vk::DeviceSize offset;
+			vk::DeviceSize size;
+		};
+
+		std::unique_ptr<Buffer> vertexBuffer;
+		std::unique_ptr<Buffer> indexBuffer;
+		RangeAllocator vertexRanges;
+		RangeAllocator indexRanges;
+		// Every live handle, kept up to date as handles are moved, for moves to patch
+		std::vector<GeometryAllocation *> allocations;
+		std::unique_ptr<PendingMove> pendingMove;
+		std::vector<RetiredRange> retired;
+		bool fragmented = true; // whether beginMove may find something, set again whenever ranges are freed
+
+		static uint32_t getIndexSize(vk::IndexType indexType);
+
+		bool findMove(bool indices, RangeMove &move);
+		void replace(GeometryAllocation *previous, GeometryAllocation *allocation);
+		void free(const GeometryAllocation &allocation);
+	};
+}
+
+#endif // OBTAIN_GRAPHICS_VULKAN_GEOMETRY_POOL_HPP
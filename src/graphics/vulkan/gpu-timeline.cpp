@@ -0,0 +1,81 @@
+#include "gpu-timeline.hpp"
+
+#include <stdexcept>
+
+#include "device.hpp"
+
+namespace Obtain::Graphics::Vulkan {
+	GpuTimeline::GpuTimeline(Device *device, const vk::Queue &queue)
+		: device(device), queue(queue), semaphore(device->createTimelineSemaphore(0u)), submitted(0u), completed(0u)
+	{}
+
+	GpuTimeline::~GpuTimeline()
+	{
+		wait(submitted);
+	}
+
+	uint64_t GpuTimeline::submit(vk::ArrayProxy<const vk::CommandBuffer> commandBuffers,
+	                             vk::ArrayProxy<const GpuWait> waits, vk::Semaphore signalSemaphore)
+	{
+		if (waits.size() > MaxWaits) {
+			throw std::logic_error("submission waits on more semaphores than a timeline submit takes");
+		}
+
+		vk::Semaphore waitSemaphores[MaxWaits];
+		uint64_t waitValues[MaxWaits];
+		vk::PipelineStageFlags waitStages[MaxWaits];
+		uint32_t waitCount = 0u;
+		for (const GpuWait &wait : waits) {
+			waitSemaphores[waitCount] = wait.semaphore;
+			waitValues[waitCount] = wait.value;
+			waitStages[waitCount] = wait.stage;
+			waitCount++;
+		}
+
+		uint64_t value = submitted + 1u;
+		vk::Semaphore signalSemaphores[] = {*semaphore, signalSemaphore};
+		uint64_t signalValues[] = {value, 0u};
+		uint32_t signalCount = signalSemaphore ? 2u : 1u;
+
+		vk::TimelineSemaphoreSubmitInfoKHR timelineInfo(waitCount, waitValues, signalCount, signalValues);
+		vk::SubmitInfo submitInfo(waitCount, waitSemaphores, waitStages,
+		                          commandBuffers.size(), commandBuffers.data(),
+		                          signalCount, signalSemaphores);
+		submitInfo.pNext = &timelineInfo;
+		queue.submit(1, &submitInfo, vk::Fence());
+
+		submitted = value;
+		return value;
+	}
+
+	GpuWait GpuTimeline::waitFor(uint64_t value, const vk::PipelineStageFlags &stage)
+	{
+		return {*semaphore, value, stage};
+	}
+
+	bool GpuTimeline::isComplete(uint64_t value)
+	{
+		if (completed < value) {
+			completed = device->getSemaphoreCounterValue(*semaphore);
+		}
+		return completed >= value;
+	}
+
+	void GpuTimeline::wait(uint64_t value)
+	{
+		if (!isComplete(value)) {
+			device->waitForSemaphore(*semaphore, value);
+			completed = value;
+		}
+	}
+
+	uint64_t GpuTimeline::getSubmitted()
+	{
+		return submitted;
+	}
+
+	const vk::Queue &GpuTimeline::getQueue()
+	{
+		return queue;
+	}
+}
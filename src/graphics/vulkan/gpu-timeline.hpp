@@ -0,0 +1,67 @@
+#ifndef OBTAIN_GRAPHICS_VULKAN_GPU_TIMELINE_HPP
+#define OBTAIN_GRAPHICS_VULKAN_GPU_TIMELINE_HPP
+
+#include <cstdint>
+#include <vulkan/vulkan.hpp>
+
+namespace Obtain::Graphics::Vulkan {
+	class Device;
+
+	// A semaphore a submission waits on in stage; value is ignored for binary semaphores
+	struct GpuWait {
+		vk::Semaphore semaphore;
+		uint64_t value;
+		vk::PipelineStageFlags stage;
+	};
+
+	/*
+	 * The submissions to one queue, numbered in order by the values of a timeline semaphore. Every
+	 * submit signals the next value, and whether a submission is done is a comparison against the
+	 * highest value known to be reached, so one primitive tracks frames in flight, uploads and the
+	 * lifetime of whatever they use, without a fence per submission. Submissions on other queues wait
+	 * on a value with waitFor. Values only grow, which is why each queue has its own timeline: queues
+	 * run independently and would otherwise signal out of order.
+	 */
+	class GpuTimeline {
+	public:
+		// Binary and timeline semaphores a single submit waits on at most
+		static const uint32_t MaxWaits = 4;
+
+		GpuTimeline(Device *device, const vk::Queue &queue);
+
+		// Waits for every submission, the semaphore must not be in use when it is destroyed
+		~GpuTimeline();
+
+		GpuTimeline(const GpuTimeline &) = delete;
+		GpuTimeline &operator=(const GpuTimeline &) = delete;
+
+		// Submits commandBuffers to the queue after waits and returns the value signaled once they
+		// complete; signalSemaphore, if given, is a binary semaphore signaled along with it, e.g. for
+		// presentation
+		uint64_t submit(vk::ArrayProxy<const vk::CommandBuffer> commandBuffers,
+		                vk::ArrayProxy<const GpuWait> waits = nullptr,
+		                vk::Semaphore signalSemaphore = vk::Semaphore());
+
+		// For a submission on any queue to wait in stage until value is reached
+		GpuWait waitFor(uint64_t value, const vk::PipelineStageFlags &stage);
+
+		// Polls the semaphore only if value isn't known to be reached yet
+		bool isComplete(uint64_t value);
+
+		void wait(uint64_t value);
+
+		// Value of the latest submit, 0 before the first
+		uint64_t getSubmitted();
+
+		const vk::Queue &getQueue();
+
+	private:
+		Device *device;
+		vk::Queue queue;
+		vk::UniqueSemaphore semaphore;
+		uint64_t submitted;
+		uint64_t completed; // highest value seen reached
+	};
+}
+
+#endif // OBTAIN_GRAPHICS_VULKAN_GPU_TIMELINE_HPP
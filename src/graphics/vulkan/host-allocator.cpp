@@ -0,0 +1,137 @@
+#include "host-allocator.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+namespace Obtain::Graphics::Vulkan {
+	namespace {
+		// Stored right in front of every allocation, which may be moved by reallocations and freed
+		// without its size
+		struct AllocationHeader {
+			size_t size;
+			size_t offset; // from the start of the underlying allocation
+			size_t alignment;
+			VkSystemAllocationScope scope;
+		};
+
+		size_t alignUp(size_t value, size_t alignment)
+		{
+			return (value + alignment - 1u) / alignment * alignment;
+		}
+
+		AllocationHeader *getHeader(void *memory)
+		{
+			return reinterpret_cast<AllocationHeader *>(static_cast<char *>(memory) - sizeof(AllocationHeader));
+		}
+	}
+
+	/******************************************
+	 ***************** public *****************
+	 ******************************************/
+
+	HostAllocator::HostAllocator()
+		: callbacks(this, allocateCallback, reallocateCallback, freeCallback, internalAllocationCallback,
+		            internalFreeCallback)
+	{}
+
+	const vk::AllocationCallbacks &HostAllocator::getCallbacks()
+	{
+		return callbacks;
+	}
+
+	void HostAllocator::endFrame()
+	{
+		for (auto &scope : scopes) {
+			scope.frameAllocationCount = scope.currentFrameAllocations.exchange(0u);
+		}
+	}
+
+	std::array<HostAllocationStatistics, HostAllocator::ScopeCount> HostAllocator::getStatistics()
+	{
+		std::array<HostAllocationStatistics, ScopeCount> statistics{};
+		for (size_t i = 0; i < ScopeCount; i++) {
+			statistics[i] = {scopes[i].bytes, scopes[i].peakBytes, scopes[i].allocationCount,
+			                 scopes[i].frameAllocationCount, scopes[i].internalBytes};
+		}
+		return statistics;
+	}
+
+	/******************************************
+	 ***************** private *****************
+	 ******************************************/
+
+	void *HostAllocator::allocate(size_t size, size_t alignment, VkSystemAllocationScope scope)
+	{
+		alignment = std::max(alignment, alignof(AllocationHeader));
+		size_t offset = alignUp(sizeof(AllocationHeader), alignment);
+		void *base = ::operator new(offset + size, std::align_val_t(alignment), std::nothrow);
+		if (base == nullptr) {
+			return nullptr;
+		}
+
+		void *memory = static_cast<char *>(base) + offset;
+		*getHeader(memory) = {size, offset, alignment, scope};
+
+		auto &counters = scopes[static_cast<size_t>(scope)];
+		uint64_t bytes = counters.bytes += size;
+		uint64_t peak = counters.peakBytes;
+		while (bytes > peak && !counters.peakBytes.compare_exchange_weak(peak, bytes)) {}
+		counters.allocationCount++;
+		counters.currentFrameAllocations++;
+		return memory;
+	}
+
+	void HostAllocator::free(void *memory)
+	{
+		AllocationHeader header = *getHeader(memory);
+		scopes[static_cast<size_t>(header.scope)].bytes -= header.size;
+		::operator delete(static_cast<char *>(memory) - header.offset, std::align_val_t(header.alignment));
+	}
+
+	void *HostAllocator::allocateCallback(void *userData, size_t size, size_t alignment,
+	                                      VkSystemAllocationScope scope)
+	{
+		return static_cast<HostAllocator *>(userData)->allocate(size, alignment, scope);
+	}
+
+	void *HostAllocator::reallocateCallback(void *userData, void *original, size_t size, size_t alignment,
+	                                        VkSystemAllocationScope scope)
+	{
+		auto *allocator = static_cast<HostAllocator *>(userData);
+		if (original == nullptr) {
+			return allocator->allocate(size, alignment, scope);
+		}
+		if (size == 0u) {
+			allocator->free(original);
+			return nullptr;
+		}
+
+		// On failure the original allocation has to stay untouched
+		void *memory = allocator->allocate(size, alignment, scope);
+		if (memory != nullptr) {
+			memcpy(memory, original, std::min(size, getHeader(original)->size));
+			allocator->free(original);
+		}
+		return memory;
+	}
+
+	void HostAllocator::freeCallback(void *userData, void *memory)
+	{
+		if (memory != nullptr) {
+			static_cast<HostAllocator *>(userData)->free(memory);
+		}
+	}
+
+	void HostAllocator::internalAllocationCallback(void *userData, size_t size, VkInternalAllocationType type,
+	                                               VkSystemAllocationScope scope)
+	{
+		static_cast<HostAllocator *>(userData)->scopes[static_cast<size_t>(scope)].internalBytes += size;
+	}
+
+	void HostAllocator::internalFreeCallback(void *userData, size_t size, VkInternalAllocationType type,
+	                                         VkSystemAllocationScope scope)
+	{
+		static_cast<HostAllocator *>(userData)->scopes[static_cast<size_t>(scope)].internalBytes -= size;
+	}
+}
@@ -0,0 +1,73 @@
+#ifndef OBTAIN_GRAPHICS_VULKAN_HOST_ALLOCATOR_HPP
+#define OBTAIN_GRAPHICS_VULKAN_HOST_ALLOCATOR_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vulkan/vulkan.hpp>
+
+namespace Obtain::Graphics::Vulkan {
+	struct HostAllocationStatistics {
+		uint64_t bytes; // live
+		uint64_t peakBytes;
+		uint64_t allocationCount; // since creation, reallocations included
+		uint64_t frameAllocationCount; // in the last frame ended
+		uint64_t internalBytes; // allocated by the driver itself and only reported to us
+	};
+
+	/*
+	 * Host memory for the driver, handed out through vk::AllocationCallbacks and counted per
+	 * VkSystemAllocationScope: live and peak bytes, and how many allocations each frame makes. In
+	 * steady state command and object scope allocations per frame should be zero, anything else is a
+	 * driver call on the hot path that allocates. Counters are atomic since drivers allocate from
+	 * whichever thread calls them. Must outlive everything created with its callbacks.
+	 */
+	class HostAllocator {
+	public:
+		// Command, object, cache, device and instance
+		static constexpr size_t ScopeCount = 5;
+
+		HostAllocator();
+
+		HostAllocator(const HostAllocator &) = delete;
+		HostAllocator &operator=(const HostAllocator &) = delete;
+
+		const vk::AllocationCallbacks &getCallbacks();
+
+		// Makes the allocations counted since the previous call the frame allocation counts
+		void endFrame();
+
+		std::array<HostAllocationStatistics, ScopeCount> getStatistics();
+
+	private:
+		struct Scope {
+			std::atomic<uint64_t> bytes{0u};
+			std::atomic<uint64_t> peakBytes{0u};
+			std::atomic<uint64_t> allocationCount{0u};
+			std::atomic<uint64_t> currentFrameAllocations{0u};
+			std::atomic<uint64_t> frameAllocationCount{0u};
+			std::atomic<uint64_t> internalBytes{0u};
+		};
+
+		vk::AllocationCallbacks callbacks;
+		std::array<Scope, ScopeCount> scopes;
+
+		void *allocate(size_t size, size_t alignment, VkSystemAllocationScope scope);
+		void free(void *memory);
+
+		static VKAPI_ATTR void *VKAPI_CALL allocateCallback(void *userData, size_t size, size_t alignment,
+		                                                    VkSystemAllocationScope scope);
+		static VKAPI_ATTR void *VKAPI_CALL reallocateCallback(void *userData, void *original, size_t size,
+		                                                      size_t alignment, VkSystemAllocationScope scope);
+		static VKAPI_ATTR void VKAPI_CALL freeCallback(void *userData, void *memory);
+		static VKAPI_ATTR void VKAPI_CALL internalAllocationCallback(void *userData, size_t size,
+		                                                             VkInternalAllocationType type,
+		                                                             VkSystemAllocationScope scope);
+		static VKAPI_ATTR void VKAPI_CALL internalFreeCallback(void *userData, size_t size,
+		                                                       VkInternalAllocationType type,
+		                                                       VkSystemAllocationScope scope);
+	};
+}
+
+#endif // OBTAIN_GRAPHICS_VULKAN_HOST_ALLOCATOR_HPP
@@ -11,6 +11,7 @@
 #include "buffer.hpp"
 #include "device.hpp"
 #include "command.hpp"
+#include "upload-batch.hpp"
 
 #define TEXTURE_LOCATION "assets/textures/"
 
@@ -18,16 +19,14 @@ namespace Obtain::Graphics::Vulkan {
 	Image::Image(Device *device, uint32_t width, uint32_t height, uint32_t mipLevels,
 	             vk::Format format, vk::ImageTiling tiling, const vk::ImageAspectFlags &aspectMask,
 	             const vk::ImageUsageFlags &usageFlags, const vk::MemoryPropertyFlags &propertyFlags,
-	             vk::SampleCountFlagBits sampleCount)
+	             MemoryCategory category, vk::SampleCountFlagBits sampleCount)
 		: device(device), format(format), mipLevels(mipLevels), extent(width, height, 1u)
 	{
 		image = device->createImage(extent, format, mipLevels, tiling,
 		                            usageFlags, sampleCount);
 
-		auto memoryRequirements = device->getImageMemoryRequirements(image);
-		auto memoryType = device->findMemoryType(memoryRequirements.memoryTypeBits, propertyFlags);
-		memory = device->allocateMemory(memoryRequirements.size, memoryType);
-		device->bindImageMemory(image, memory, 0);
+		memory = device->allocateImageMemory(image, propertyFlags, tiling, category,
+		                                     static_cast<bool>(usageFlags & vk::ImageUsageFlagBits::eTransientAttachment));
 		view = device->createImageView(image, format, mipLevels, aspectMask);
 	}
 
@@ -35,15 +34,15 @@ namespace Obtain::Graphics::Vulkan {
 	                                     vk::Format format, vk::ImageTiling tiling,
 	                                     const vk::ImageAspectFlags &aspectMask,
 	                                     const vk::ImageUsageFlags &usageFlags,
-	                                     const vk::MemoryPropertyFlags &propertyFlags,
+	                                     const vk::MemoryPropertyFlags &propertyFlags, MemoryCategory category,
 	                                     vk::SampleCountFlagBits sampleCount)
 	{
 		return std::make_unique<Image>(Image(device, width, height, mipLevels,
 		                                     format, tiling, aspectMask, usageFlags,
-		                                     propertyFlags, sampleCount));
+		                                     propertyFlags, category, sampleCount));
 	}
 
-	std::unique_ptr<Image> Image::createTextureImage(Device *device, vk::UniqueCommandPool &pool,
+	std::unique_ptr<Image> Image::createTextureImage(Device *device, UploadBatch &batch,
 	                                                 const std::string &file)
 	{
 		std::string filePath = TEXTURE_LOCATION + file;
@@ -58,18 +57,6 @@ namespace Obtain::Graphics::Vulkan {
 			throw std::runtime_error("failed to load texture from file " + filePath);
 		}
 
-		vk::DeviceSize size = width * height * 4;
-
-		auto stagingBuffer = Buffer(device,
-		                            size,
-		                            vk::BufferUsageFlagBits::eTransferSrc,
-		                            vk::MemoryPropertyFlagBits::eHostCoherent |
-		                            vk::MemoryPropertyFlagBits::eHostVisible);
-
-		stagingBuffer.load(0, pixels, size);
-
-		stbi_image_free(pixels);
-
 		uint32_t mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height))) + 1);
 
 		auto image = Image::unique(device,
@@ -81,15 +68,41 @@ namespace Obtain::Graphics::Vulkan {
 		                           vk::ImageAspectFlagBits::eColor,
 		                           vk::ImageUsageFlagBits::eTransferSrc |
 		                           vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
-		                           vk::MemoryPropertyFlagBits::eDeviceLocal);
-
-		image->transitionLayout(pool, *device->getGraphicsQueue(),
-		                        vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
+		                           vk::MemoryPropertyFlagBits::eDeviceLocal,
+		                           MemoryCategory::Textures);
+
+		image->transitionLayout(batch, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
+
+		// Textures larger than a staging chunk go up in bands of whole rows, and rows larger than a
+		// chunk in pieces of a row each
+		vk::DeviceSize texelSize = 4u;
+		vk::DeviceSize rowSize = static_cast<vk::DeviceSize>(width) * texelSize;
+		vk::DeviceSize maxStageSize = batch.getMaxStageSize();
+		if (rowSize <= maxStageSize) {
+			uint32_t rowsPerChunk = static_cast<uint32_t>(maxStageSize / rowSize);
+			for (uint32_t row = 0; row < static_cast<uint32_t>(height); row += rowsPerChunk) {
+				uint32_t rows = std::min(rowsPerChunk, static_cast<uint32_t>(height) - row);
+				StagedRange staged = batch.stage(pixels + row * rowSize, rows * rowSize);
+				image->copyFromBuffer(batch, staged, 0u, row, static_cast<uint32_t>(width), rows);
+			}
+		} else {
+			uint32_t texelsPerChunk = static_cast<uint32_t>(maxStageSize / texelSize);
+			for (uint32_t row = 0; row < static_cast<uint32_t>(height); row++) {
+				for (uint32_t column = 0; column < static_cast<uint32_t>(width); column += texelsPerChunk) {
+					uint32_t texels = std::min(texelsPerChunk, static_cast<uint32_t>(width) - column);
+					StagedRange staged = batch.stage(pixels + row * rowSize + column * texelSize, texels * texelSize);
+					image->copyFromBuffer(batch, staged, column, row, texels, 1u);
+				}
+			}
+		}
 
-		image->copyFromBuffer(pool, *device->getGraphicsQueue(), stagingBuffer,
-		                      static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+		stbi_image_free(pixels);
 
-		image->generateMipmaps(pool);
+		// Blits need the graphics queue, copies may have run on a transfer queue
+		batch.handOver(*image->image,
+		               vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0u, mipLevels, 0u, 1u),
+		               vk::ImageLayout::eTransferDstOptimal);
+		image->generateMipmaps(batch);
 
 		return image;
 	}
@@ -111,8 +124,10 @@ namespace Obtain::Graphics::Vulkan {
 		                           format,
 		                           vk::ImageTiling::eOptimal,
 		                           vk::ImageAspectFlagBits::eDepth,
+		                           vk::ImageUsageFlagBits::eTransientAttachment |
 		                           vk::ImageUsageFlagBits::eDepthStencilAttachment,
 		                           vk::MemoryPropertyFlagBits::eDeviceLocal,
+		                           MemoryCategory::Attachments,
 		                           device->getSampleCount());
 
 		image->transitionLayout(pool, *device->getGraphicsQueue(),
@@ -132,6 +147,7 @@ namespace Obtain::Graphics::Vulkan {
 		                           vk::ImageUsageFlagBits::eTransientAttachment |
 		                           vk::ImageUsageFlagBits::eColorAttachment,
 		                           vk::MemoryPropertyFlagBits::eDeviceLocal,
+		                           MemoryCategory::Attachments,
 		                           device->getSampleCount());
 
 		image->transitionLayout(pool, *device->getGraphicsQueue(),
@@ -153,43 +169,29 @@ namespace Obtain::Graphics::Vulkan {
 		auto action = [&oldLayout,
 		               &newLayout,
 		               this](vk::CommandBuffer commandBuffer) {
-			vk::ImageMemoryBarrier barrier(accessMaskForLayout(oldLayout),
-			                               accessMaskForLayout(newLayout),
-			                               oldLayout,
-			                               newLayout,
-			                               VK_QUEUE_FAMILY_IGNORED,
-			                               VK_QUEUE_FAMILY_IGNORED,
-			                               *image,
-			                               vk::ImageSubresourceRange(
-				                               aspectMaskForLayout(newLayout),
-				                               0u,
-				                               mipLevels,
-				                               0u,
-				                               1u));
-
-			commandBuffer.pipelineBarrier(pipelineStageForLayout(oldLayout),
-			                              pipelineStageForLayout(newLayout),
-			                              vk::DependencyFlags(),
-			                              0u, nullptr,
-			                              0u, nullptr,
-			                              1u, &barrier);
+			recordTransitionLayout(commandBuffer, oldLayout, newLayout);
 		};
 
 		Command::runSingleTime(device, commandPool, graphicsQueue, action);
 	}
 
-	void Image::copyFromBuffer(vk::UniqueCommandPool &commandPool, const vk::Queue &graphicsQueue,
-	                           Buffer &buffer, uint32_t width, uint32_t height)
+	void Image::transitionLayout(UploadBatch &batch, const vk::ImageLayout &oldLayout,
+	                             const vk::ImageLayout &newLayout)
 	{
+		recordTransitionLayout(batch.getCommandBuffer(), oldLayout, newLayout);
+	}
 
+	void Image::copyFromBuffer(UploadBatch &batch, const StagedRange &staged, uint32_t x, uint32_t y, uint32_t width,
+	                           uint32_t height)
+	{
 		vk::ImageSubresourceLayers subresource(vk::ImageAspectFlagBits::eColor,
 		                                       0, 0, 1);
-		vk::BufferImageCopy region(0, 0, 0,
-		                           subresource, vk::Offset3D(0, 0, 0),
+		vk::BufferImageCopy region(staged.offset, 0, 0,
+		                           subresource, vk::Offset3D(static_cast<int32_t>(x), static_cast<int32_t>(y), 0),
 		                           vk::Extent3D(width, height, 1));
 
-		buffer.copyToImage(commandPool, graphicsQueue, image,
-		                   region, subresource);
+		batch.getCommandBuffer().copyBufferToImage(staged.buffer, *image,
+		                                           vk::ImageLayout::eTransferDstOptimal, 1, &region);
 	}
 
 	bool Image::hasStencilComponent()
@@ -211,7 +213,32 @@ namespace Obtain::Graphics::Vulkan {
 	 ******************* Private ************************
 	 ****************************************************/
 
-	void Image::generateMipmaps(vk::UniqueCommandPool &pool)
+	void Image::recordTransitionLayout(vk::CommandBuffer commandBuffer,
+	                                   const vk::ImageLayout &oldLayout, const vk::ImageLayout &newLayout)
+	{
+		vk::ImageMemoryBarrier barrier(accessMaskForLayout(oldLayout),
+		                               accessMaskForLayout(newLayout),
+		                               oldLayout,
+		                               newLayout,
+		                               VK_QUEUE_FAMILY_IGNORED,
+		                               VK_QUEUE_FAMILY_IGNORED,
+		                               *image,
+		                               vk::ImageSubresourceRange(
+			                               aspectMaskForLayout(newLayout),
+			                               0u,
+			                               mipLevels,
+			                               0u,
+			                               1u));
+
+		commandBuffer.pipelineBarrier(pipelineStageForLayout(oldLayout),
+		                              pipelineStageForLayout(newLayout),
+		                              vk::DependencyFlags(),
+		                              0u, nullptr,
+		                              0u, nullptr,
+		                              1u, &barrier);
+	}
+
+	void Image::generateMipmaps(UploadBatch &batch)
 	{
 		if (!device->hasOptimalTilingFeature(format,
 		                                     vk::FormatFeatureFlagBits::eSampledImageFilterLinear)) {
@@ -227,62 +254,39 @@ namespace Obtain::Graphics::Vulkan {
 		                               (VK_QUEUE_FAMILY_IGNORED),
 		                               *image, subresourceRange);
 
+		vk::CommandBuffer commandBuffer = batch.getGraphicsCommandBuffer();
+		int32_t width = extent.width;
+		int32_t height = extent.height;
 
-		auto action = [&barrier,
-		               this](vk::CommandBuffer commandBuffer) {
-			int32_t width = extent.width;
-			int32_t height = extent.height;
-
-			for (uint32_t i = 1; i < mipLevels; i++) {
-				barrier.subresourceRange.baseMipLevel = i - 1;
-				barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
-				barrier.newLayout = vk::ImageLayout::eTransferSrcOptimal;
-				barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-				barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
-				commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
-				                              vk::PipelineStageFlagBits::eTransfer,
-				                              vk::DependencyFlags(), 0,
-				                              nullptr, 0,
-				                              nullptr, 1,
-				                              &barrier);
-
-				vk::ImageSubresourceLayers srcSubresourceLayers(vk::ImageAspectFlagBits::eColor,
-				                                                i - 1, 0, 1);
-				vk::ImageSubresourceLayers dstSubresourceLayers(vk::ImageAspectFlagBits::eColor,
-				                                                i, 0, 1);
-				vk::Offset3D sharedOffset(0, 0, 0);
-				vk::Offset3D srcOffset(width, height, 1);
-				vk::Offset3D dstOffset(width > 1 ? width / 2 : 1, height > 1 ? height / 2 : 1, 1);
-				vk::ImageBlit blit(srcSubresourceLayers, {sharedOffset, srcOffset},
-				                   dstSubresourceLayers, {sharedOffset, dstOffset});
-				commandBuffer.blitImage(*image, vk::ImageLayout::eTransferSrcOptimal,
-				                        *image, vk::ImageLayout::eTransferDstOptimal,
-				                        1, &blit, vk::Filter::eLinear);
-
-				barrier.oldLayout = vk::ImageLayout::eTransferSrcOptimal;
-				barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-				barrier.srcAccessMask = vk::AccessFlagBits::eTransferRead;
-				barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
-				commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
-				                              vk::PipelineStageFlagBits::eFragmentShader,
-				                              vk::DependencyFlags(), 0,
-				                              nullptr, 0,
-				                              nullptr, 1,
-				                              &barrier);
-
-				if (width > 1) {
-					width /= 2;
-				}
-
-				if (height > 1) {
-					height /= 2;
-				}
-			}
-
-			barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+		for (uint32_t i = 1; i < mipLevels; i++) {
+			barrier.subresourceRange.baseMipLevel = i - 1;
 			barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
-			barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+			barrier.newLayout = vk::ImageLayout::eTransferSrcOptimal;
 			barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+			barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+			commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+			                              vk::PipelineStageFlagBits::eTransfer,
+			                              vk::DependencyFlags(), 0,
+			                              nullptr, 0,
+			                              nullptr, 1,
+			                              &barrier);
+
+			vk::ImageSubresourceLayers srcSubresourceLayers(vk::ImageAspectFlagBits::eColor,
+			                                                i - 1, 0, 1);
+			vk::ImageSubresourceLayers dstSubresourceLayers(vk::ImageAspectFlagBits::eColor,
+			                                                i, 0, 1);
+			vk::Offset3D sharedOffset(0, 0, 0);
+			vk::Offset3D srcOffset(width, height, 1);
+			vk::Offset3D dstOffset(width > 1 ? width / 2 : 1, height > 1 ? height / 2 : 1, 1);
+			vk::ImageBlit blit(srcSubresourceLayers, {sharedOffset, srcOffset},
+			                   dstSubresourceLayers, {sharedOffset, dstOffset});
+			commandBuffer.blitImage(*image, vk::ImageLayout::eTransferSrcOptimal,
+			                        *image, vk::ImageLayout::eTransferDstOptimal,
+			                        1, &blit, vk::Filter::eLinear);
+
+			barrier.oldLayout = vk::ImageLayout::eTransferSrcOptimal;
+			barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+			barrier.srcAccessMask = vk::AccessFlagBits::eTransferRead;
 			barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
 			commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
 			                              vk::PipelineStageFlagBits::eFragmentShader,
@@ -290,9 +294,27 @@ namespace Obtain::Graphics::Vulkan {
 			                              nullptr, 0,
 			                              nullptr, 1,
 			                              &barrier);
-		};
 
-		Command::runSingleTime(device, pool, *device->getGraphicsQueue(), action);
+			if (width > 1) {
+				width /= 2;
+			}
+
+			if (height > 1) {
+				height /= 2;
+			}
+		}
+
+		barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+		barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+		barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+		barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+		barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+		                              vk::PipelineStageFlagBits::eFragmentShader,
+		                              vk::DependencyFlags(), 0,
+		                              nullptr, 0,
+		                              nullptr, 1,
+		                              &barrier);
 	}
 
 	const vk::AccessFlags Image::accessMaskForLayout(const vk::ImageLayout &layout)
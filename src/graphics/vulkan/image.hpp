@@ -9,21 +9,25 @@
 #include "device.hpp"
 
 namespace Obtain::Graphics::Vulkan {
+	class UploadBatch;
+	struct StagedRange;
+
 	class Image {
 	public:
 		Image(Device *device, uint32_t width, uint32_t height, uint32_t mipLevels,
 		      vk::Format format, vk::ImageTiling tiling, const vk::ImageAspectFlags &aspectMask,
 		      const vk::ImageUsageFlags &usageFlags, const vk::MemoryPropertyFlags &propertyFlags,
-		      vk::SampleCountFlagBits sampleCount = vk::SampleCountFlagBits::e1);
+		      MemoryCategory category, vk::SampleCountFlagBits sampleCount = vk::SampleCountFlagBits::e1);
 
 		static std::unique_ptr<Image> unique(Device *device, uint32_t width, uint32_t height, uint32_t mipLevels,
 		                                     vk::Format format, vk::ImageTiling tiling,
 		                                     const vk::ImageAspectFlags &aspectMask,
 		                                     const vk::ImageUsageFlags &usageFlags,
-		                                     const vk::MemoryPropertyFlags &propertyFlags,
+		                                     const vk::MemoryPropertyFlags &propertyFlags, MemoryCategory category,
 		                                     vk::SampleCountFlagBits sampleCount = vk::SampleCountFlagBits::e1);
 
-		static std::unique_ptr<Image> createTextureImage(Device *device, vk::UniqueCommandPool &pool,
+		// Records the upload and mipmap generation into batch; usable once the batch completes
+		static std::unique_ptr<Image> createTextureImage(Device *device, UploadBatch &batch,
 		                                                 const std::string &file);
 
 		static std::unique_ptr<Image> createDepthImage(Device *device, const vk::Extent2D &extent,
@@ -38,8 +42,11 @@ namespace Obtain::Graphics::Vulkan {
 		void transitionLayout(vk::UniqueCommandPool &commandPool, const vk::Queue &graphicsQueue,
 		                      const vk::ImageLayout &oldLayout, const vk::ImageLayout &newLayout);
 
-		void copyFromBuffer(vk::UniqueCommandPool &commandPool, const vk::Queue &graphicsQueue,
-		                    Buffer &buffer, uint32_t width, uint32_t height);
+		void transitionLayout(UploadBatch &batch, const vk::ImageLayout &oldLayout, const vk::ImageLayout &newLayout);
+
+		// Copies the width by height block at x, y of the base level, tightly packed in staged
+		void copyFromBuffer(UploadBatch &batch, const StagedRange &staged, uint32_t x, uint32_t y, uint32_t width,
+		                    uint32_t height);
 
 		bool hasStencilComponent();
 
@@ -48,8 +55,8 @@ namespace Obtain::Graphics::Vulkan {
 		vk::Format &getFormat();
 	private:
 		Device *device;
+		MemoryAllocation memory; // declared first so image is destroyed before its memory is released
 		vk::UniqueImage image;
-		vk::UniqueDeviceMemory memory;
 		vk::UniqueImageView view;
 		vk::Format format;
 		vk::Extent3D extent;
@@ -57,7 +64,9 @@ namespace Obtain::Graphics::Vulkan {
 		uint32_t mipLevels;
 
 		vk::ImageAspectFlags aspectMaskForLayout(const vk::ImageLayout &layout);
-		void generateMipmaps(vk::UniqueCommandPool &pool);
+		void recordTransitionLayout(vk::CommandBuffer commandBuffer,
+		                            const vk::ImageLayout &oldLayout, const vk::ImageLayout &newLayout);
+		void generateMipmaps(UploadBatch &batch);
 
 		static const vk::AccessFlags accessMaskForLayout(const vk::ImageLayout &layout);
 		static const vk::PipelineStageFlags pipelineStageForLayout(const vk::ImageLayout &layout);
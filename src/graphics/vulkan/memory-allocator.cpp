@@ -0,0 +1,412 @@
+#include "memory-allocator.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "tlsf-metadata.hpp"
+
+namespace Obtain::Graphics::Vulkan {
+	namespace {
+		constexpr uint32_t NullNode = TlsfMetadata::NullNode;
+
+		vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+		{
+			return (value + alignment - 1u) / alignment * alignment;
+		}
+	}
+
+	class MemoryBlock {
+	public:
+		MemoryBlock(vk::UniqueDeviceMemory memory, vk::DeviceSize size, uint32_t memoryType, void *mappedData,
+		            bool coherent, bool dedicated)
+			: memory(std::move(memory)), memoryType(memoryType), mappedData(mappedData), coherent(coherent),
+			  dedicated(dedicated), metadata(size)
+		{}
+
+		vk::UniqueDeviceMemory memory;
+		uint32_t memoryType;
+		void *mappedData; // whole block, stays mapped until the memory is freed
+		bool coherent;
+		bool dedicated;
+		TlsfMetadata metadata;
+
+		float getUsage() const
+		{
+			return dedicated ? 1.0f : static_cast<float>(metadata.getUsedBytes()) /
+			                          static_cast<float>(metadata.getSize());
+		}
+	};
+
+	/******************************************
+	 ************ MemoryAllocation ************
+	 ******************************************/
+
+	MemoryAllocation::MemoryAllocation()
+		: allocator(nullptr), block(nullptr), node(NullNode), offset(0u), size(0u), mappedData(nullptr),
+		  coherent(true), category(MemoryCategory::Geometry)
+	{}
+
+	MemoryAllocation::MemoryAllocation(MemoryAllocation &&other) noexcept
+		: allocator(other.allocator), block(other.block), node(other.node), memory(other.memory),
+		  offset(other.offset), size(other.size), mappedData(other.mappedData), coherent(other.coherent),
+		  category(other.category)
+	{
+		other.allocator = nullptr;
+	}
+
+	MemoryAllocation &MemoryAllocation::operator=(MemoryAllocation &&other) noexcept
+	{
+		if (this != &other) {
+			release();
+			allocator = other.allocator;
+			block = other.block;
+			node = other.node;
+			memory = other.memory;
+			offset = other.offset;
+			size = other.size;
+			mappedData = other.mappedData;
+			coherent = other.coherent;
+			category = other.category;
+			other.allocator = nullptr;
+		}
+		return *this;
+	}
+
+	MemoryAllocation::~MemoryAllocation()
+	{
+		release();
+	}
+
+	vk::DeviceMemory MemoryAllocation::getMemory() const
+	{
+		return memory;
+	}
+
+	vk::DeviceSize MemoryAllocation::getOffset() const
+	{
+		return offset;
+	}
+
+	vk::DeviceSize MemoryAllocation::getSize() const
+	{
+		return size;
+	}
+
+	MemoryCategory MemoryAllocation::getCategory() const
+	{
+		return category;
+	}
+
+	void *MemoryAllocation::getMappedData() const
+	{
+		return mappedData;
+	}
+
+	void *MemoryAllocation::map()
+	{
+		return static_cast<char *>(allocator->device.mapMemory(memory, 0u, VK_WHOLE_SIZE)) + offset;
+	}
+
+	void MemoryAllocation::unmap()
+	{
+		allocator->device.unmapMemory(memory);
+	}
+
+	bool MemoryAllocation::isCoherent() const
+	{
+		return coherent;
+	}
+
+	void MemoryAllocation::flush(vk::DeviceSize rangeOffset, vk::DeviceSize rangeSize)
+	{
+		if (!coherent) {
+			auto range = allocator->getMappedRange(block, offset + rangeOffset,
+			                                       std::min(rangeSize, size - rangeOffset));
+			allocator->device.flushMappedMemoryRanges(1u, &range);
+		}
+	}
+
+	void MemoryAllocation::invalidate(vk::DeviceSize rangeOffset, vk::DeviceSize rangeSize)
+	{
+		if (!coherent) {
+			auto range = allocator->getMappedRange(block, offset + rangeOffset,
+			                                       std::min(rangeSize, size - rangeOffset));
+			allocator->device.invalidateMappedMemoryRanges(1u, &range);
+		}
+	}
+
+	void MemoryAllocation::release()
+	{
+		if (allocator != nullptr) {
+			allocator->free(block, node, category);
+			allocator = nullptr;
+		}
+	}
+
+	/******************************************
+	 ************ MemoryAllocator *************
+	 ******************************************/
+
+	MemoryAllocator::MemoryAllocator(vk::Device device, const vk::PhysicalDeviceMemoryProperties &memoryProperties,
+	                                 vk::DeviceSize bufferImageGranularity, vk::DeviceSize nonCoherentAtomSize,
+	                                 const vk::AllocationCallbacks *allocationCallbacks)
+		: device(device), memoryProperties(memoryProperties), bufferImageGranularity(bufferImageGranularity),
+		  nonCoherentAtomSize(nonCoherentAtomSize), allocationCallbacks(allocationCallbacks), blocks(memoryProperties.memoryTypeCount), categories()
+	{
+		for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+			vk::DeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[i].heapIndex].size;
+			blockSizes.push_back(std::min(MaxBlockSize, heapSize / 8u));
+		}
+	}
+
+	MemoryAllocator::~MemoryAllocator() = default;
+
+	MemoryAllocation MemoryAllocator::allocate(const vk::MemoryRequirements &requirements,
+	                                           const vk::MemoryPropertyFlags &properties, bool linear,
+	                                           MemoryCategory category,
+	                                           const vk::MemoryPropertyFlags &preferredProperties,
+	                                           bool persistentlyMapped)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		MemoryAllocation allocation;
+		for (auto wanted : {properties | preferredProperties, properties}) {
+			for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+				if ((requirements.memoryTypeBits & (1u << i)) &&
+				    (memoryProperties.memoryTypes[i].propertyFlags & wanted) == wanted &&
+				    tryAllocate(i, requirements, linear, category, persistentlyMapped, allocation)) {
+					return allocation;
+				}
+			}
+		}
+		throw std::runtime_error("failed to allocate device memory!");
+	}
+
+	MemoryAllocation MemoryAllocator::allocateCompacted(const MemoryAllocation &allocation,
+	                                                    const vk::MemoryRequirements &requirements, bool linear)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		MemoryAllocation compacted;
+		MemoryBlock *source = allocation.block;
+		if (source == nullptr || source->dedicated || !(requirements.memoryTypeBits & (1u << source->memoryType))) {
+			return compacted;
+		}
+
+		// Fullest blocks first, the copy should leave as little free space behind as it can
+		std::vector<MemoryBlock *> targets;
+		for (auto &block : blocks[source->memoryType]) {
+			if (!block->dedicated && block->getUsage() > source->getUsage()) {
+				targets.push_back(block.get());
+			}
+		}
+		std::sort(targets.begin(), targets.end(), [](const MemoryBlock *a, const MemoryBlock *b) {
+			return a->getUsage() > b->getUsage();
+		});
+
+		vk::MemoryRequirements blockRequirements = getBlockRequirements(source->memoryType, requirements);
+		for (MemoryBlock *target : targets) {
+			uint32_t node = target->metadata.allocate(blockRequirements.size, blockRequirements.alignment, linear,
+			                                          bufferImageGranularity);
+			if (node != NullNode) {
+				initAllocation(compacted, target, node, requirements.size, allocation.category);
+				break;
+			}
+		}
+		return compacted;
+	}
+
+	float MemoryAllocator::getBlockUsage(const MemoryAllocation &allocation)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		return allocation.block != nullptr ? allocation.block->getUsage() : 1.0f;
+	}
+
+	std::vector<MemoryHeapStatistics> MemoryAllocator::getStatistics()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		std::vector<MemoryHeapStatistics> statistics(memoryProperties.memoryHeapCount);
+		std::vector<vk::DeviceSize> freeBytes(memoryProperties.memoryHeapCount, 0u);
+		for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+			statistics[i] = {memoryProperties.memoryHeaps[i].size, 0u, 0u, 0u, 0u, 0u, 0.0f};
+		}
+
+		for (uint32_t type = 0; type < memoryProperties.memoryTypeCount; type++) {
+			uint32_t heap = memoryProperties.memoryTypes[type].heapIndex;
+			for (auto &block : blocks[type]) {
+				auto &metadata = block->metadata;
+				statistics[heap].blockCount++;
+				statistics[heap].allocationCount += metadata.getAllocationCount();
+				statistics[heap].blockBytes += metadata.getSize();
+				statistics[heap].usedBytes += metadata.getUsedBytes();
+				statistics[heap].largestFreeRange = std::max(statistics[heap].largestFreeRange,
+				                                             metadata.getLargestFreeRange());
+				freeBytes[heap] += metadata.getSize() - metadata.getUsedBytes();
+			}
+		}
+
+		for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+			if (freeBytes[i] > 0u) {
+				statistics[i].fragmentation = 1.0f - static_cast<float>(statistics[i].largestFreeRange) /
+				                                     static_cast<float>(freeBytes[i]);
+			}
+		}
+		return statistics;
+	}
+
+	std::array<MemoryCategoryStatistics, MemoryCategoryCount> MemoryAllocator::getCategoryStatistics()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		return categories;
+	}
+
+	bool MemoryAllocator::tryAllocate(uint32_t memoryType, const vk::MemoryRequirements &resourceRequirements,
+	                                  bool linear, MemoryCategory category, bool persistentlyMapped,
+	                                  MemoryAllocation &allocation)
+	{
+		vk::MemoryRequirements requirements = getBlockRequirements(memoryType, resourceRequirements);
+
+		auto &typeBlocks = blocks[memoryType];
+		vk::DeviceSize blockSize = blockSizes[memoryType];
+		MemoryBlock *block = nullptr;
+		uint32_t node = NullNode;
+
+		if (requirements.size > blockSize / 2u || !persistentlyMapped) {
+			auto dedicatedBlock = createBlock(memoryType, requirements.size, true, persistentlyMapped);
+			if (!dedicatedBlock) {
+				return false;
+			}
+			block = dedicatedBlock.get();
+			node = block->metadata.allocate(requirements.size, requirements.alignment, linear, bufferImageGranularity);
+			typeBlocks.push_back(std::move(dedicatedBlock));
+		} else {
+			for (auto &candidate : typeBlocks) {
+				if (!candidate->dedicated) {
+					node = candidate->metadata.allocate(requirements.size, requirements.alignment, linear,
+					                                    bufferImageGranularity);
+					if (node != NullNode) {
+						block = candidate.get();
+						break;
+					}
+				}
+			}
+
+			if (node == NullNode) {
+				// Smaller blocks may still fit when the heap is almost full
+				std::unique_ptr<MemoryBlock> newBlock;
+				for (vk::DeviceSize size = blockSize; !newBlock && size >= requirements.size; size /= 2u) {
+					newBlock = createBlock(memoryType, size, false);
+				}
+				if (!newBlock) {
+					return false;
+				}
+				block = newBlock.get();
+				node = block->metadata.allocate(requirements.size, requirements.alignment, linear,
+				                                bufferImageGranularity);
+				typeBlocks.push_back(std::move(newBlock));
+			}
+		}
+
+		initAllocation(allocation, block, node, resourceRequirements.size, category);
+		return true;
+	}
+
+	vk::MemoryRequirements MemoryAllocator::getBlockRequirements(uint32_t memoryType,
+	                                                             const vk::MemoryRequirements &requirements)
+	{
+		auto propertyFlags = memoryProperties.memoryTypes[memoryType].propertyFlags;
+		vk::MemoryRequirements blockRequirements = requirements;
+		if ((propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible) &&
+		    !(propertyFlags & vk::MemoryPropertyFlagBits::eHostCoherent)) {
+			blockRequirements.alignment = std::max(requirements.alignment, nonCoherentAtomSize);
+			blockRequirements.size = alignUp(requirements.size, nonCoherentAtomSize);
+		}
+		return blockRequirements;
+	}
+
+	void MemoryAllocator::initAllocation(MemoryAllocation &allocation, MemoryBlock *block, uint32_t node,
+	                                     vk::DeviceSize size, MemoryCategory category)
+	{
+		allocation.allocator = this;
+		allocation.block = block;
+		allocation.node = node;
+		allocation.memory = *block->memory;
+		allocation.offset = block->metadata.getOffset(node);
+		allocation.size = size;
+		allocation.coherent = block->coherent;
+		allocation.mappedData = block->mappedData != nullptr
+		                        ? static_cast<char *>(block->mappedData) + allocation.offset
+		                        : nullptr;
+		allocation.category = category;
+
+		// Counted with the padding to nonCoherentAtomSize, like the block's used bytes
+		auto &statistics = categories[static_cast<size_t>(category)];
+		statistics.bytes += block->metadata.getSize(node);
+		statistics.peakBytes = std::max(statistics.peakBytes, statistics.bytes);
+		statistics.allocationCount++;
+	}
+
+	std::unique_ptr<MemoryBlock> MemoryAllocator::createBlock(uint32_t memoryType, vk::DeviceSize size, bool dedicated,
+	                                                          bool persistentlyMapped)
+	{
+		vk::UniqueDeviceMemory memory;
+		try {
+			memory = device.allocateMemoryUnique(vk::MemoryAllocateInfo(size, memoryType), allocationCallbacks);
+		} catch (vk::OutOfDeviceMemoryError &) {
+			return nullptr;
+		} catch (vk::OutOfHostMemoryError &) {
+			return nullptr;
+		}
+
+		auto propertyFlags = memoryProperties.memoryTypes[memoryType].propertyFlags;
+		bool hostVisible = static_cast<bool>(propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible);
+		void *mappedData = nullptr;
+		if (hostVisible && persistentlyMapped) {
+			mappedData = device.mapMemory(*memory, 0u, VK_WHOLE_SIZE);
+		}
+
+		// Memory the host can't see needs no flushing either
+		return std::make_unique<MemoryBlock>(std::move(memory), size, memoryType, mappedData,
+		                                     !hostVisible ||
+		                                     static_cast<bool>(propertyFlags & vk::MemoryPropertyFlagBits::eHostCoherent),
+		                                     dedicated);
+	}
+
+	void MemoryAllocator::free(MemoryBlock *block, uint32_t node, MemoryCategory category)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto &statistics = categories[static_cast<size_t>(category)];
+		statistics.bytes -= block->metadata.getSize(node);
+		statistics.allocationCount--;
+
+		block->metadata.free(node);
+		if (!block->metadata.isEmpty()) {
+			return;
+		}
+
+		// Keep one empty block per memory type around so that a resource recreated every frame or on
+		// resize doesn't allocate device memory every time
+		auto &typeBlocks = blocks[block->memoryType];
+		bool keep = !block->dedicated &&
+		            std::none_of(typeBlocks.begin(), typeBlocks.end(), [block](const std::unique_ptr<MemoryBlock> &other) {
+			            return other.get() != block && !other->dedicated && other->metadata.isEmpty();
+		            });
+		if (!keep) {
+			typeBlocks.erase(std::find_if(typeBlocks.begin(), typeBlocks.end(),
+			                              [block](const std::unique_ptr<MemoryBlock> &other) {
+				                              return other.get() == block;
+			                              }));
+		}
+	}
+
+	vk::MappedMemoryRange MemoryAllocator::getMappedRange(MemoryBlock *block, vk::DeviceSize offset, vk::DeviceSize size)
+	{
+		vk::DeviceSize begin = offset / nonCoherentAtomSize * nonCoherentAtomSize;
+		vk::DeviceSize end = std::min(alignUp(offset + size, nonCoherentAtomSize), block->metadata.getSize());
+		return vk::MappedMemoryRange(*block->memory, begin, end - begin);
+	}
+}
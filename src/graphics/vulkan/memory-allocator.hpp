@@ -0,0 +1,167 @@
+#ifndef OBTAIN_GRAPHICS_VULKAN_MEMORY_ALLOCATOR_HPP
+#define OBTAIN_GRAPHICS_VULKAN_MEMORY_ALLOCATOR_HPP
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace Obtain::Graphics::Vulkan {
+	class MemoryAllocator;
+	class MemoryBlock; // Defined in memory-allocator.cpp
+
+	// What an allocation is used for, tracked separately to set streaming budgets and spot leaks
+	enum class MemoryCategory {
+		Geometry, // vertices, indices, meshlets and indirect draws
+		Textures,
+		Attachments,
+		Uniforms,
+		Staging
+	};
+
+	static constexpr size_t MemoryCategoryCount = 5;
+
+	struct MemoryCategoryStatistics {
+		vk::DeviceSize bytes; // of live allocations, padded like the blocks count them
+		vk::DeviceSize peakBytes;
+		uint32_t allocationCount;
+	};
+
+	struct MemoryHeapBudget {
+		vk::DeviceSize budget; // what the process can use before allocations fail or degrade performance
+		vk::DeviceSize usage; // by the whole process, including memory not allocated through the allocator
+	};
+
+	struct MemoryHeapStatistics {
+		vk::DeviceSize heapSize;
+		uint32_t blockCount;
+		uint32_t allocationCount;
+		vk::DeviceSize blockBytes; // allocated from the driver
+		vk::DeviceSize usedBytes; // handed out to resources
+		vk::DeviceSize largestFreeRange;
+		float fragmentation; // 1 - largest free range / free bytes, 0 when all free space is in one piece
+	};
+
+	/*
+	 * A range of a device memory block owned by one buffer or image. Returns the range to its
+	 * allocator when destroyed, so the resource bound to it has to be destroyed first.
+	 */
+	class MemoryAllocation {
+	public:
+		MemoryAllocation();
+		MemoryAllocation(MemoryAllocation &&other) noexcept;
+		MemoryAllocation &operator=(MemoryAllocation &&other) noexcept;
+		MemoryAllocation(const MemoryAllocation &) = delete;
+		MemoryAllocation &operator=(const MemoryAllocation &) = delete;
+		~MemoryAllocation();
+
+		vk::DeviceMemory getMemory() const;
+		vk::DeviceSize getOffset() const;
+		vk::DeviceSize getSize() const;
+
+		MemoryCategory getCategory() const;
+
+		// Start of the range in host address space, nullptr unless the memory type is host visible and the
+		// allocation persistently mapped. Stays valid for the lifetime of the allocation.
+		void *getMappedData() const;
+
+		// Map and unmap an allocation made without a persistent mapping, which has a block of its own
+		void *map();
+		void unmap();
+
+		bool isCoherent() const;
+
+		// Make host writes to [offset, offset + size) of the range visible to the device, and device writes
+		// visible to the host. Needed only for memory that is not host coherent, no-ops otherwise.
+		void flush(vk::DeviceSize rangeOffset = 0u, vk::DeviceSize rangeSize = VK_WHOLE_SIZE);
+		void invalidate(vk::DeviceSize rangeOffset = 0u, vk::DeviceSize rangeSize = VK_WHOLE_SIZE);
+
+	private:
+		friend class MemoryAllocator;
+
+		MemoryAllocator *allocator;
+		MemoryBlock *block;
+		uint32_t node;
+		vk::DeviceMemory memory;
+		vk::DeviceSize offset;
+		vk::DeviceSize size;
+		void *mappedData;
+		bool coherent;
+		MemoryCategory category;
+
+		void release();
+	};
+
+	/*
+	 * Sub-allocates buffers and images from large vk::DeviceMemory blocks, one list of blocks per
+	 * memory type, instead of one vkAllocateMemory per resource. Each block is managed by a two level
+	 * segregated fit allocator (Masmano et al., "TLSF: a New Dynamic Memory Allocator for Real-Time
+	 * Systems"), so allocating and freeing take constant time and free neighbours are merged right
+	 * away. Linear resources (buffers, linear images) and optimal tiling images are kept
+	 * bufferImageGranularity apart wherever they would otherwise share a page. Host visible blocks are
+	 * mapped once for their whole lifetime, unless asked not to; in memory types that are not host coherent allocations are
+	 * aligned to nonCoherentAtomSize, so flushing one never touches the atoms of another.
+	 */
+	class MemoryAllocator {
+	public:
+		// Upper bound for block size, heaps smaller than 8 blocks get smaller blocks
+		static constexpr vk::DeviceSize MaxBlockSize = 64u * 1024u * 1024u;
+
+		// allocationCallbacks, which may be nullptr, are used for the host memory of every block
+		MemoryAllocator(vk::Device device, const vk::PhysicalDeviceMemoryProperties &memoryProperties,
+		                vk::DeviceSize bufferImageGranularity, vk::DeviceSize nonCoherentAtomSize,
+		                const vk::AllocationCallbacks *allocationCallbacks);
+
+		~MemoryAllocator();
+
+		// Allocates from the first memory type allowed by requirements that has all of properties, and
+		// falls back to the next one when its heap is out of memory. Types that also have all of
+		// preferredProperties are tried first. Requests larger than half a block get a block of their own,
+		// and so do requests that must not be persistently mapped, for map to have the block to itself.
+		MemoryAllocation allocate(const vk::MemoryRequirements &requirements,
+		                          const vk::MemoryPropertyFlags &properties, bool linear, MemoryCategory category,
+		                          const vk::MemoryPropertyFlags &preferredProperties = {},
+		                          bool persistentlyMapped = true);
+
+		// Room for a copy of allocation's resource, in the same category, in a fuller block of its memory
+		// type; empty when no fuller block has room, this never creates blocks
+		MemoryAllocation allocateCompacted(const MemoryAllocation &allocation,
+		                                   const vk::MemoryRequirements &requirements, bool linear);
+
+		// Used fraction of the block allocation lies in, 1 for dedicated blocks
+		float getBlockUsage(const MemoryAllocation &allocation);
+
+		std::vector<MemoryHeapStatistics> getStatistics();
+
+		std::array<MemoryCategoryStatistics, MemoryCategoryCount> getCategoryStatistics();
+
+	private:
+		friend class MemoryAllocation;
+
+		vk::Device device;
+		vk::PhysicalDeviceMemoryProperties memoryProperties;
+		vk::DeviceSize bufferImageGranularity;
+		vk::DeviceSize nonCoherentAtomSize;
+		const vk::AllocationCallbacks *allocationCallbacks;
+		std::vector<vk::DeviceSize> blockSizes; // per memory type
+		std::vector<std::vector<std::unique_ptr<MemoryBlock>>> blocks; // per memory type
+		std::array<MemoryCategoryStatistics, MemoryCategoryCount> categories;
+		std::mutex mutex;
+
+		bool tryAllocate(uint32_t memoryType, const vk::MemoryRequirements &resourceRequirements, bool linear,
+		                 MemoryCategory category, bool persistentlyMapped, MemoryAllocation &allocation);
+		// Requirements within blocks of memoryType, padded to whole atoms where it's not host coherent
+		vk::MemoryRequirements getBlockRequirements(uint32_t memoryType, const vk::MemoryRequirements &requirements);
+		void initAllocation(MemoryAllocation &allocation, MemoryBlock *block, uint32_t node, vk::DeviceSize size,
+		                    MemoryCategory category);
+		std::unique_ptr<MemoryBlock> createBlock(uint32_t memoryType, vk::DeviceSize size, bool dedicated,
+		                                         bool persistentlyMapped = true);
+		void free(MemoryBlock *block, uint32_t node, MemoryCategory category);
+		// Expands [offset, offset + size) of block to whole atoms, as flush and invalidate require
+		vk::MappedMemoryRange getMappedRange(MemoryBlock *block, vk::DeviceSize offset, vk::DeviceSize size);
+	};
+}
+
+#endif // OBTAIN_GRAPHICS_VULKAN_MEMORY_ALLOCATOR_HPP
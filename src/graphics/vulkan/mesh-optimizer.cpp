@@ -0,0 +1,435 @@
+#include "mesh-optimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Obtain::Graphics::Vulkan {
+	namespace {
+		// Simulated LRU cache used for scoring; larger than real hardware caches on purpose, see Forsyth
+		const uint32_t ScoringCacheSize = 32u;
+		const uint32_t MaxValence = 32u;
+
+		const float CacheDecayPower = 1.5f;
+		const float LastTriangleScore = 0.75f;
+		const float ValenceBoostScale = 2.0f;
+		const float ValenceBoostPower = 0.5f;
+
+		struct ScoreTable {
+			float cache[ScoringCacheSize];
+			float valence[MaxValence + 1];
+
+			ScoreTable()
+				: cache(), valence()
+			{
+				for (uint32_t position = 0; position < ScoringCacheSize; position++) {
+					if (position < 3u) {
+						// The last triangle's vertices get a fixed score so it is not simply repeated
+						cache[position] = LastTriangleScore;
+					} else {
+						float scaler = 1.0f / static_cast<float>(ScoringCacheSize - 3u);
+						cache[position] = std::pow(1.0f - static_cast<float>(position - 3u) * scaler,
+						                           CacheDecayPower);
+					}
+				}
+
+				for (uint32_t count = 1; count <= MaxValence; count++) {
+					valence[count] = ValenceBoostScale * std::pow(static_cast<float>(count), -ValenceBoostPower);
+				}
+			}
+
+			// Vertices with few remaining triangles score higher so lone triangles are not left behind
+			float score(int32_t cachePosition, uint32_t liveTriangles) const
+			{
+				if (liveTriangles == 0) {
+					return -1.0f;
+				}
+
+				float result = cachePosition >= 0 ? cache[cachePosition] : 0.0f;
+				result += liveTriangles <= MaxValence
+				          ? valence[liveTriangles]
+				          : ValenceBoostScale * std::pow(static_cast<float>(liveTriangles), -ValenceBoostPower);
+				return result;
+			}
+		};
+
+		// FIFO cache simulation; a vertex is cached if fewer than cacheSize misses happened since its load
+		struct FifoCache {
+			std::vector<uint32_t> loadedAt;
+			uint32_t misses;
+			uint32_t cacheSize;
+
+			FifoCache(size_t vertexCount, uint32_t cacheSize)
+				: loadedAt(vertexCount, 0u), misses(0u), cacheSize(cacheSize)
+			{}
+
+			// Returns whether the vertex had to be loaded
+			bool access(uint32_t vertex)
+			{
+				uint32_t &loaded = loadedAt[vertex];
+				if (loaded != 0u && misses - loaded < cacheSize) {
+					return false;
+				}
+				loaded = ++misses;
+				return true;
+			}
+
+			uint32_t accessTriangle(const uint32_t *corners)
+			{
+				return static_cast<uint32_t>(access(corners[0])) + access(corners[1]) + access(corners[2]);
+			}
+
+			void flush()
+			{
+				misses += cacheSize;
+			}
+		};
+	}
+
+	void MeshOptimizer::optimizeVertexCache(uint32_t *indices, size_t indexCount, size_t vertexCount)
+	{
+		static const ScoreTable scores;
+		size_t triangleCount = indexCount / 3u;
+		if (triangleCount == 0) {
+			return;
+		}
+
+		// Triangles using every vertex; the first liveTriangles entries of each list are not emitted yet
+		std::vector<uint32_t> liveTriangles(vertexCount, 0u);
+		for (size_t i = 0; i < triangleCount * 3u; i++) {
+			liveTriangles[indices[i]]++;
+		}
+
+		std::vector<uint32_t> adjacencyOffsets(vertexCount + 1u, 0u);
+		for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+			adjacencyOffsets[vertex + 1u] = adjacencyOffsets[vertex] + liveTriangles[vertex];
+		}
+
+		std::vector<uint32_t> adjacency(triangleCount * 3u);
+		std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < triangleCount * 3u; i++) {
+			adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3u);
+		}
+
+		std::vector<int32_t> cachePosition(vertexCount, -1);
+		std::vector<float> vertexScore(vertexCount);
+		for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+			vertexScore[vertex] = scores.score(-1, liveTriangles[vertex]);
+		}
+
+		std::vector<float> triangleScore(triangleCount);
+		std::vector<bool> emitted(triangleCount, false);
+		size_t bestTriangle = 0u;
+		for (size_t triangle = 0; triangle < triangleCount; triangle++) {
+			const uint32_t *corners = indices + triangle * 3u;
+			triangleScore[triangle] = vertexScore[corners[0]] + vertexScore[corners[1]] + vertexScore[corners[2]];
+			if (triangleScore[triangle] > triangleScore[bestTriangle]) {
+				bestTriangle = triangle;
+			}
+		}
+
+		std::vector<uint32_t> output;
+		output.reserve(triangleCount * 3u);
+
+		uint32_t cache[ScoringCacheSize + 3u];
+		uint32_t cacheCount = 0u;
+		size_t scanCursor = 0u;
+
+		while (true) {
+			const uint32_t *corners = indices + bestTriangle * 3u;
+			emitted[bestTriangle] = true;
+			output.insert(output.end(), corners, corners + 3);
+
+			// The emitted triangle's vertices move to the front of the LRU cache
+			uint32_t newCache[ScoringCacheSize + 3u];
+			uint32_t newCacheCount = 0u;
+
+			for (int corner = 0; corner < 3; corner++) {
+				uint32_t vertex = corners[corner];
+
+				uint32_t *begin = adjacency.data() + adjacencyOffsets[vertex];
+				uint32_t *last = begin + liveTriangles[vertex] - 1u;
+				std::iter_swap(std::find(begin, last, static_cast<uint32_t>(bestTriangle)), last);
+				liveTriangles[vertex]--;
+
+				if (std::find(newCache, newCache + newCacheCount, vertex) == newCache + newCacheCount) {
+					newCache[newCacheCount++] = vertex;
+				}
+			}
+
+			for (uint32_t i = 0; i < cacheCount; i++) {
+				if (std::find(corners, corners + 3, cache[i]) == corners + 3) {
+					newCache[newCacheCount++] = cache[i];
+				}
+			}
+
+			// Rescore everything that entered, moved within or fell out of the cache
+			for (uint32_t i = 0; i < newCacheCount; i++) {
+				uint32_t vertex = newCache[i];
+				cachePosition[vertex] = i < ScoringCacheSize ? static_cast<int32_t>(i) : -1;
+
+				float score = scores.score(cachePosition[vertex], liveTriangles[vertex]);
+				float delta = score - vertexScore[vertex];
+				vertexScore[vertex] = score;
+
+				const uint32_t *begin = adjacency.data() + adjacencyOffsets[vertex];
+				for (const uint32_t *triangle = begin; triangle < begin + liveTriangles[vertex]; triangle++) {
+					triangleScore[*triangle] += delta;
+				}
+			}
+
+			// Pick the best triangle among the ones touching the cache only once all of their corners
+			// are rescored, a triangle seen through its first corner may still lose score from the others
+			float bestScore = -1.0f;
+			bool found = false;
+
+			for (uint32_t i = 0; i < newCacheCount; i++) {
+				uint32_t vertex = newCache[i];
+				const uint32_t *begin = adjacency.data() + adjacencyOffsets[vertex];
+				for (const uint32_t *triangle = begin; triangle < begin + liveTriangles[vertex]; triangle++) {
+					if (triangleScore[*triangle] > bestScore) {
+						bestScore = triangleScore[*triangle];
+						bestTriangle = *triangle;
+						found = true;
+					}
+				}
+			}
+
+			cacheCount = std::min(newCacheCount, ScoringCacheSize);
+			std::copy(newCache, newCache + cacheCount, cache);
+
+			if (!found) {
+				// Nothing left near the cache; continue with the next triangle in input order
+				while (scanCursor < triangleCount && emitted[scanCursor]) {
+					scanCursor++;
+				}
+				if (scanCursor == triangleCount) {
+					break;
+				}
+				bestTriangle = scanCursor;
+			}
+		}
+
+		std::copy(output.begin(), output.end(), indices);
+	}
+
+	void MeshOptimizer::optimizeOverdraw(uint32_t *indices, size_t indexCount, const Vertex *vertices,
+	                                     size_t vertexCount, float threshold)
+	{
+		size_t triangleCount = indexCount / 3u;
+		if (triangleCount == 0) {
+			return;
+		}
+
+		// Hard boundaries: a triangle missing the cache on all three vertices starts a new patch
+		std::vector<size_t> hardBoundaries;
+		FifoCache cache(vertexCount, AnalysisCacheSize);
+		for (size_t triangle = 0; triangle < triangleCount; triangle++) {
+			if (cache.accessTriangle(indices + triangle * 3u) == 3u || triangle == 0) {
+				hardBoundaries.emplace_back(triangle);
+			}
+		}
+		hardBoundaries.emplace_back(triangleCount);
+
+		// Soft boundaries: split patches further wherever the part so far is no worse than threshold
+		// times the whole patch when rendered with a cold cache
+		std::vector<size_t> clusters;
+		for (size_t patch = 0; patch + 1u < hardBoundaries.size(); patch++) {
+			size_t begin = hardBoundaries[patch];
+			size_t end = hardBoundaries[patch + 1u];
+
+			cache.flush();
+			uint32_t patchMisses = 0u;
+			for (size_t triangle = begin; triangle < end; triangle++) {
+				patchMisses += cache.accessTriangle(indices + triangle * 3u);
+			}
+			float patchThreshold = threshold * static_cast<float>(patchMisses) / static_cast<float>(end - begin);
+
+			clusters.emplace_back(begin);
+			cache.flush();
+			uint32_t misses = 0u;
+			size_t clusterBegin = begin;
+			for (size_t triangle = begin; triangle < end; triangle++) {
+				misses += cache.accessTriangle(indices + triangle * 3u);
+
+				bool cut = static_cast<float>(misses) <= patchThreshold * static_cast<float>(triangle + 1u - clusterBegin);
+				if (cut && triangle + 1u < end) {
+					clusters.emplace_back(triangle + 1u);
+					clusterBegin = triangle + 1u;
+					misses = 0u;
+					cache.flush();
+				}
+			}
+		}
+		clusters.emplace_back(triangleCount);
+
+		// Sort key: how far out the cluster sits along its own average normal
+		auto corner = [&](size_t triangle, int k) {
+			return vertices[indices[triangle * 3u + k]].pos;
+		};
+
+		glm::vec3 meshCentroid(0.0f);
+		float meshArea = 0.0f;
+		std::vector<glm::vec3> clusterCentroids(clusters.size() - 1u, glm::vec3(0.0f));
+		std::vector<glm::vec3> clusterNormals(clusters.size() - 1u, glm::vec3(0.0f));
+		std::vector<float> clusterAreas(clusters.size() - 1u, 0.0f);
+
+		for (size_t cluster = 0; cluster + 1u < clusters.size(); cluster++) {
+			for (size_t triangle = clusters[cluster]; triangle < clusters[cluster + 1u]; triangle++) {
+				glm::vec3 a = corner(triangle, 0), b = corner(triangle, 1), c = corner(triangle, 2);
+				glm::vec3 normal = glm::cross(b - a, c - a); // length is twice the area
+				float area = glm::length(normal);
+
+				clusterCentroids[cluster] += (a + b + c) * (area / 3.0f);
+				clusterNormals[cluster] += normal;
+				clusterAreas[cluster] += area;
+			}
+			meshCentroid += clusterCentroids[cluster];
+			meshArea += clusterAreas[cluster];
+		}
+		meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : meshCentroid;
+
+		std::vector<float> keys(clusters.size() - 1u);
+		for (size_t cluster = 0; cluster < keys.size(); cluster++) {
+			glm::vec3 centroid = clusterAreas[cluster] > 0.0f
+			                     ? clusterCentroids[cluster] / clusterAreas[cluster]
+			                     : corner(clusters[cluster], 0);
+			float length = glm::length(clusterNormals[cluster]);
+			glm::vec3 normal = length > 0.0f ? clusterNormals[cluster] / length : glm::vec3(0.0f);
+			keys[cluster] = glm::dot(centroid - meshCentroid, normal);
+		}
+
+		std::vector<size_t> order(keys.size());
+		for (size_t cluster = 0; cluster < order.size(); cluster++) {
+			order[cluster] = cluster;
+		}
+		std::stable_sort(order.begin(), order.end(), [&keys](size_t a, size_t b) {
+			return keys[a] > keys[b];
+		});
+
+		std::vector<uint32_t> output;
+		output.reserve(triangleCount * 3u);
+		for (size_t cluster : order) {
+			output.insert(output.end(), indices + clusters[cluster] * 3u, indices + clusters[cluster + 1u] * 3u);
+		}
+		std::copy(output.begin(), output.end(), indices);
+	}
+
+	void MeshOptimizer::buildMeshlets(const uint32_t *indices, size_t indexCount, const Vertex *vertices,
+	                                  std::vector<ModelMeshlet> &meshlets, uint32_t maxVertices, uint32_t maxTriangles)
+	{
+		std::vector<uint32_t> meshletVertices;
+		meshletVertices.reserve(maxVertices);
+
+		auto finish = [&](size_t begin, size_t end) {
+			ModelMeshlet meshlet = {};
+			meshlet.firstIndex = static_cast<uint32_t>(begin);
+			meshlet.indexCount = static_cast<uint32_t>(end - begin);
+
+			glm::vec3 minimum = vertices[meshletVertices[0]].pos;
+			glm::vec3 maximum = minimum;
+			for (uint32_t vertex : meshletVertices) {
+				minimum = glm::min(minimum, vertices[vertex].pos);
+				maximum = glm::max(maximum, vertices[vertex].pos);
+			}
+			glm::vec3 center = (minimum + maximum) * 0.5f;
+			float radius = 0.0f;
+			for (uint32_t vertex : meshletVertices) {
+				radius = std::max(radius, glm::distance(center, vertices[vertex].pos));
+			}
+
+			// Axis is the area weighted average normal, the cutoff covers the widest normal around it
+			std::vector<glm::vec3> normals;
+			glm::vec3 axis(0.0f);
+			for (size_t index = begin; index < end; index += 3u) {
+				glm::vec3 a = vertices[indices[index]].pos;
+				glm::vec3 normal = glm::cross(vertices[indices[index + 1u]].pos - a, vertices[indices[index + 2u]].pos - a);
+				float length = glm::length(normal);
+				if (length > 0.0f) {
+					axis += normal;
+					normals.emplace_back(normal / length);
+				}
+			}
+
+			float axisLength = glm::length(axis);
+			float minimumDot = 1.0f;
+			if (axisLength > 0.0f) {
+				axis = axis / axisLength;
+				for (const auto &normal : normals) {
+					minimumDot = std::min(minimumDot, glm::dot(axis, normal));
+				}
+			}
+
+			for (int component = 0; component < 3; component++) {
+				meshlet.center[component] = center[component];
+				meshlet.coneAxis[component] = axisLength > 0.0f ? axis[component] : 0.0f;
+			}
+			meshlet.radius = radius;
+			meshlet.coneCutoff = axisLength > 0.0f && minimumDot > 0.0f ? std::sqrt(1.0f - minimumDot * minimumDot) : 1.0f;
+			meshlets.emplace_back(meshlet);
+		};
+
+		size_t begin = 0u;
+		for (size_t index = 0; index + 2u < indexCount; index += 3u) {
+			uint32_t added = 0u;
+			for (size_t corner = 0; corner < 3u; corner++) {
+				uint32_t vertex = indices[index + corner];
+				bool known = std::find(meshletVertices.begin(), meshletVertices.end(), vertex) != meshletVertices.end() ||
+				             std::find(indices + index, indices + index + corner, vertex) != indices + index + corner;
+				added += known ? 0u : 1u;
+			}
+
+			if (index > begin && (meshletVertices.size() + added > maxVertices || (index - begin) / 3u == maxTriangles)) {
+				finish(begin, index);
+				begin = index;
+				meshletVertices.clear();
+			}
+
+			for (size_t corner = 0; corner < 3u; corner++) {
+				uint32_t vertex = indices[index + corner];
+				if (std::find(meshletVertices.begin(), meshletVertices.end(), vertex) == meshletVertices.end()) {
+					meshletVertices.emplace_back(vertex);
+				}
+			}
+		}
+
+		if (indexCount >= 3u) {
+			finish(begin, indexCount - indexCount % 3u);
+		}
+	}
+
+	void MeshOptimizer::optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)
+	{
+		const uint32_t Unused = 0xFFFFFFFFu;
+		std::vector<uint32_t> remap(vertices.size(), Unused);
+		std::vector<Vertex> reordered;
+		reordered.reserve(vertices.size());
+
+		for (auto &index : indices) {
+			if (remap[index] == Unused) {
+				remap[index] = static_cast<uint32_t>(reordered.size());
+				reordered.emplace_back(vertices[index]);
+			}
+			index = remap[index];
+		}
+
+		vertices.swap(reordered);
+	}
+
+	VertexCacheStatistics MeshOptimizer::analyzeVertexCache(const uint32_t *indices, size_t indexCount,
+	                                                        size_t vertexCount, uint32_t cacheSize)
+	{
+		FifoCache cache(vertexCount, cacheSize);
+		size_t referenced = 0u;
+
+		for (size_t i = 0; i < indexCount; i++) {
+			referenced += cache.loadedAt[indices[i]] == 0u ? 1u : 0u;
+			cache.access(indices[i]);
+		}
+		uint32_t misses = cache.misses;
+
+		VertexCacheStatistics statistics = {};
+		statistics.acmr = indexCount < 3u ? 0.0f : static_cast<float>(misses) / static_cast<float>(indexCount / 3u);
+		statistics.atvr = referenced == 0u ? 0.0f : static_cast<float>(misses) / static_cast<float>(referenced);
+		return statistics;
+	}
+}
@@ -0,0 +1,59 @@
+#ifndef OBTAIN_GRAPHICS_VULKAN_MESH_OPTIMIZER_HPP
+#define OBTAIN_GRAPHICS_VULKAN_MESH_OPTIMIZER_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "vertex.hpp"
+#include "cooked-model.hpp"
+
+namespace Obtain::Graphics::Vulkan {
+	struct VertexCacheStatistics {
+		float acmr; // vertex shader invocations per triangle, 0.5 at best on a regular grid, 3 at worst
+		float atvr; // vertex shader invocations per referenced vertex, 1 at best
+	};
+
+	/*
+	 * Reorders indexed triangle lists for the GPU. Triangle order is optimized for the post-transform
+	 * vertex cache, then clusters of those triangles are reordered to reduce overdraw, then vertices
+	 * are renumbered in order of first use so the vertex fetch walks the vertex buffer mostly
+	 * sequentially. None of the passes changes what is drawn.
+	 */
+	class MeshOptimizer {
+	public:
+		// Size of the FIFO cache used to estimate ACMR/ATVR; close to what desktop GPUs behave like
+		static const uint32_t AnalysisCacheSize = 16u;
+
+		// Meshlet limits that also fit mesh shader hardware, should we ever use it
+		static const uint32_t MeshletVertices = 64u;
+		static const uint32_t MeshletTriangles = 124u;
+
+		// Reorders the triangles of indices[0, indexCount) in place (Forsyth's linear-speed algorithm)
+		static void optimizeVertexCache(uint32_t *indices, size_t indexCount, size_t vertexCount);
+
+		// Splits cache optimized indices[0, indexCount) into clusters and sorts those so that outward
+		// facing clusters on the hull come first, which approximates front-to-back order from most view
+		// directions (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw").
+		// Cluster boundaries are only placed where the cluster ACMR stays within threshold of the
+		// original, so a threshold of 1.05 keeps all but 5% of the vertex cache gains.
+		static void optimizeOverdraw(uint32_t *indices, size_t indexCount, const Vertex *vertices,
+		                             size_t vertexCount, float threshold = 1.05f);
+
+		// Cuts indices[0, indexCount) into runs of consecutive triangles using at most maxVertices
+		// distinct vertices and maxTriangles triangles, and computes their bounds. Works best on cache
+		// optimized input, where consecutive triangles are neighbours. firstIndex of the meshlets is
+		// relative to indices.
+		static void buildMeshlets(const uint32_t *indices, size_t indexCount, const Vertex *vertices,
+		                          std::vector<ModelMeshlet> &meshlets,
+		                          uint32_t maxVertices = MeshletVertices, uint32_t maxTriangles = MeshletTriangles);
+
+		// Renumbers vertices in order of first use by indices, dropping vertices that are never used
+		static void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+
+		static VertexCacheStatistics analyzeVertexCache(const uint32_t *indices, size_t indexCount,
+		                                                size_t vertexCount,
+		                                                uint32_t cacheSize = AnalysisCacheSize);
+	};
+}
+
+#endif // OBTAIN_GRAPHICS_VULKAN_MESH_OPTIMIZER_HPP
@@ -0,0 +1,410 @@
+#include "mesh-simplifier.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "vertex-table.hpp"
+
+namespace Obtain::Graphics::Vulkan {
+	namespace {
+		const uint32_t None = 0xFFFFFFFFu;
+		const uint32_t Multiple = 0xFFFFFFFEu;
+
+		// Open edges are kept in place by planes through them perpendicular to their triangle
+		const double BorderWeight = 10.0;
+
+		enum class VertexKind : uint8_t {
+			Manifold, // interior vertex with a position of its own, may collapse onto any neighbour
+			Border,   // on a single open border, may only collapse onto the next border vertex
+			Seam,     // one side of a UV seam, collapses along the seam together with its other side
+			Locked
+		};
+
+		// Weighted sum of squared distances to planes, as the symmetric matrix [A b; b^T c]
+		struct Quadric {
+			double a00, a11, a22, a01, a02, a12;
+			double b0, b1, b2;
+			double c;
+			double weight;
+
+			void addPlane(const glm::vec3 &normal, const glm::vec3 &point, double planeWeight)
+			{
+				double x = normal.x, y = normal.y, z = normal.z;
+				double d = -(x * point.x + y * point.y + z * point.z);
+
+				a00 += planeWeight * x * x;
+				a11 += planeWeight * y * y;
+				a22 += planeWeight * z * z;
+				a01 += planeWeight * x * y;
+				a02 += planeWeight * x * z;
+				a12 += planeWeight * y * z;
+				b0 += planeWeight * x * d;
+				b1 += planeWeight * y * d;
+				b2 += planeWeight * z * d;
+				c += planeWeight * d * d;
+				weight += planeWeight;
+			}
+
+			void add(const Quadric &other)
+			{
+				a00 += other.a00;
+				a11 += other.a11;
+				a22 += other.a22;
+				a01 += other.a01;
+				a02 += other.a02;
+				a12 += other.a12;
+				b0 += other.b0;
+				b1 += other.b1;
+				b2 += other.b2;
+				c += other.c;
+				weight += other.weight;
+			}
+
+			// Average squared distance of p to the planes
+			double error(const glm::vec3 &p) const
+			{
+				double x = p.x, y = p.y, z = p.z;
+				double result = a00 * x * x + a11 * y * y + a22 * z * z +
+				                2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+				                2.0 * (b0 * x + b1 * y + b2 * z) + c;
+				return weight > 0.0 ? std::fabs(result) / weight : 0.0;
+			}
+		};
+
+		struct Collapse {
+			uint32_t vertex;
+			uint32_t target;
+			double error;
+		};
+
+		// Compressed per key lists, filled by counting first
+		struct Adjacency {
+			std::vector<uint32_t> offsets;
+			std::vector<uint32_t> data;
+
+			void reset(size_t keyCount)
+			{
+				offsets.assign(keyCount + 1u, 0u);
+			}
+
+			void count(uint32_t key)
+			{
+				offsets[key + 1u]++;
+			}
+
+			void allocate()
+			{
+				for (size_t key = 1; key < offsets.size(); key++) {
+					offsets[key] += offsets[key - 1u];
+				}
+				data.resize(offsets.back());
+				cursors.assign(offsets.begin(), offsets.end() - 1);
+			}
+
+			void add(uint32_t key, uint32_t value)
+			{
+				data[cursors[key]++] = value;
+			}
+
+			const uint32_t *begin(uint32_t key) const
+			{
+				return data.data() + offsets[key];
+			}
+
+			const uint32_t *end(uint32_t key) const
+			{
+				return data.data() + offsets[key + 1u];
+			}
+
+		private:
+			std::vector<uint32_t> cursors;
+		};
+	}
+
+	float MeshSimplifier::simplify(const uint32_t *indices, size_t indexCount, const Vertex *vertices,
+	                               size_t vertexCount, size_t targetIndexCount, float targetError,
+	                               std::vector<uint32_t> &result)
+	{
+		result.assign(indices, indices + (indexCount - indexCount % 3u));
+		if (result.empty() || vertexCount == 0) {
+			return 0.0f;
+		}
+
+		// Positions scaled into the unit cube so errors come out relative to the extent
+		glm::vec3 minimum = vertices[0].pos;
+		glm::vec3 maximum = minimum;
+		for (size_t vertex = 1; vertex < vertexCount; vertex++) {
+			minimum = glm::min(minimum, vertices[vertex].pos);
+			maximum = glm::max(maximum, vertices[vertex].pos);
+		}
+		float extent = std::max(maximum.x - minimum.x, std::max(maximum.y - minimum.y, maximum.z - minimum.z));
+		float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+
+		std::vector<glm::vec3> positions(vertexCount);
+		for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+			positions[vertex] = (vertices[vertex].pos - minimum) * scale;
+		}
+
+		// Vertices that differ only in their attributes share a position id; wedge links each vertex to
+		// the next one with the same position, in a cycle
+		std::vector<glm::vec3> uniquePositions;
+		VertexTable<glm::vec3> positionTable(vertexCount);
+		std::vector<uint32_t> positionIds(vertexCount);
+		for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+			positionIds[vertex] = positionTable.insert(vertices[vertex].pos, uniquePositions);
+		}
+
+		std::vector<uint32_t> wedge(vertexCount);
+		std::vector<uint32_t> wedgeCount(uniquePositions.size(), 0u);
+		{
+			std::vector<uint32_t> first(uniquePositions.size(), None);
+			std::vector<uint32_t> last(uniquePositions.size(), None);
+			for (uint32_t vertex = 0; vertex < vertexCount; vertex++) {
+				uint32_t position = positionIds[vertex];
+				if (last[position] == None) {
+					first[position] = vertex;
+				} else {
+					wedge[last[position]] = vertex;
+				}
+				last[position] = vertex;
+				wedgeCount[position]++;
+			}
+			for (uint32_t position = 0; position < uniquePositions.size(); position++) {
+				wedge[last[position]] = first[position];
+			}
+		}
+
+		Adjacency outgoing;
+		auto hasEdge = [&outgoing](uint32_t from, uint32_t to) {
+			return std::find(outgoing.begin(from), outgoing.end(from), to) != outgoing.end(from);
+		};
+		auto buildOutgoing = [&]() {
+			outgoing.reset(vertexCount);
+			for (uint32_t index : result) {
+				outgoing.count(index);
+			}
+			outgoing.allocate();
+			for (size_t index = 0; index < result.size(); index += 3u) {
+				for (size_t corner = 0; corner < 3u; corner++) {
+					outgoing.add(result[index + corner], result[index + (corner + 1u) % 3u]);
+				}
+			}
+		};
+
+		// Quadrics of the original surface, accumulated per position as vertices collapse
+		std::vector<Quadric> quadrics(uniquePositions.size(), Quadric{});
+		buildOutgoing();
+		for (size_t index = 0; index < result.size(); index += 3u) {
+			const glm::vec3 &a = positions[result[index]];
+			const glm::vec3 &b = positions[result[index + 1u]];
+			const glm::vec3 &c = positions[result[index + 2u]];
+			glm::vec3 normal = glm::cross(b - a, c - a);
+			float area = glm::length(normal);
+			if (area == 0.0f) {
+				continue;
+			}
+			normal = normal / area;
+
+			for (size_t corner = 0; corner < 3u; corner++) {
+				quadrics[positionIds[result[index + corner]]].addPlane(normal, a, area);
+			}
+
+			for (size_t corner = 0; corner < 3u; corner++) {
+				uint32_t from = result[index + corner];
+				uint32_t to = result[index + (corner + 1u) % 3u];
+				if (hasEdge(to, from)) {
+					continue;
+				}
+				glm::vec3 edge = positions[to] - positions[from];
+				glm::vec3 edgeNormal = glm::cross(edge, normal);
+				float length = glm::length(edgeNormal);
+				if (length > 0.0f) {
+					double weight = BorderWeight * glm::dot(edge, edge);
+					quadrics[positionIds[from]].addPlane(edgeNormal / length, positions[from], weight);
+					quadrics[positionIds[to]].addPlane(edgeNormal / length, positions[from], weight);
+				}
+			}
+		}
+
+		std::vector<uint32_t> openOut(vertexCount);
+		std::vector<uint32_t> openIn(vertexCount);
+		std::vector<VertexKind> kinds(vertexCount);
+		std::vector<uint32_t> collapseRemap(vertexCount);
+		std::vector<bool> locked(uniquePositions.size());
+		std::vector<Collapse> collapses;
+		Adjacency triangles;
+
+		double errorLimit = static_cast<double>(targetError) * targetError;
+		double reachedError = 0.0;
+
+		while (result.size() > targetIndexCount) {
+			buildOutgoing();
+
+			// Classify vertices by their open edges, those without a twin in the opposite direction
+			std::fill(openOut.begin(), openOut.end(), None);
+			std::fill(openIn.begin(), openIn.end(), None);
+			for (size_t index = 0; index < result.size(); index += 3u) {
+				for (size_t corner = 0; corner < 3u; corner++) {
+					uint32_t from = result[index + corner];
+					uint32_t to = result[index + (corner + 1u) % 3u];
+					if (!hasEdge(to, from)) {
+						openOut[from] = openOut[from] == None ? to : Multiple;
+						openIn[to] = openIn[to] == None ? from : Multiple;
+					}
+				}
+			}
+
+			auto single = [](uint32_t vertex) {
+				return vertex != None && vertex != Multiple;
+			};
+			for (uint32_t vertex = 0; vertex < vertexCount; vertex++) {
+				uint32_t copies = wedgeCount[positionIds[vertex]];
+				uint32_t other = wedge[vertex];
+				if (copies == 1u && openOut[vertex] == None && openIn[vertex] == None) {
+					kinds[vertex] = VertexKind::Manifold;
+				} else if (copies == 1u && single(openOut[vertex]) && single(openIn[vertex])) {
+					kinds[vertex] = VertexKind::Border;
+				} else if (copies == 2u && single(openOut[vertex]) && single(openIn[vertex]) &&
+				           single(openOut[other]) && single(openIn[other]) &&
+				           positionIds[openOut[vertex]] == positionIds[openIn[other]] &&
+				           positionIds[openIn[vertex]] == positionIds[openOut[other]]) {
+					// Both sides run along the same edges, so the seam is closed in position space
+					kinds[vertex] = VertexKind::Seam;
+				} else {
+					kinds[vertex] = VertexKind::Locked;
+				}
+			}
+
+			auto canCollapse = [&](uint32_t vertex, uint32_t target) {
+				switch (kinds[vertex]) {
+					case VertexKind::Manifold:
+						return true;
+					case VertexKind::Border:
+						return kinds[target] == VertexKind::Border &&
+						       (openOut[vertex] == target || openIn[vertex] == target);
+					case VertexKind::Seam:
+						return kinds[target] == VertexKind::Seam &&
+						       (openOut[vertex] == target || openIn[vertex] == target) &&
+						       (openOut[wedge[vertex]] == wedge[target] || openIn[wedge[vertex]] == wedge[target]);
+					default:
+						return false;
+				}
+			};
+
+			collapses.clear();
+			for (size_t index = 0; index < result.size(); index += 3u) {
+				for (size_t corner = 0; corner < 3u; corner++) {
+					uint32_t a = result[index + corner];
+					uint32_t b = result[index + (corner + 1u) % 3u];
+					if (positionIds[a] == positionIds[b]) {
+						continue;
+					}
+
+					Collapse collapse = {None, None, std::numeric_limits<double>::max()};
+					if (canCollapse(a, b)) {
+						collapse = {a, b, quadrics[positionIds[a]].error(positions[b])};
+					}
+					if (canCollapse(b, a)) {
+						double error = quadrics[positionIds[b]].error(positions[a]);
+						if (error < collapse.error) {
+							collapse = {b, a, error};
+						}
+					}
+					if (collapse.vertex != None && collapse.error <= errorLimit) {
+						collapses.emplace_back(collapse);
+					}
+				}
+			}
+			if (collapses.empty()) {
+				break;
+			}
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) {
+				return a.error < b.error;
+			});
+
+			// Triangles around every position, to reject collapses that would flip one of them
+			triangles.reset(uniquePositions.size());
+			for (uint32_t index : result) {
+				triangles.count(positionIds[index]);
+			}
+			triangles.allocate();
+			for (size_t index = 0; index < result.size(); index++) {
+				triangles.add(positionIds[result[index]], static_cast<uint32_t>(index / 3u));
+			}
+
+			for (uint32_t vertex = 0; vertex < vertexCount; vertex++) {
+				collapseRemap[vertex] = vertex;
+			}
+			std::fill(locked.begin(), locked.end(), false);
+
+			auto flips = [&](uint32_t vertex, uint32_t target) {
+				uint32_t position = positionIds[vertex];
+				for (auto triangle = triangles.begin(position); triangle != triangles.end(position); triangle++) {
+					const uint32_t *corners = result.data() + *triangle * 3u;
+					glm::vec3 before[3], after[3];
+					bool degenerates = false;
+					for (size_t corner = 0; corner < 3u; corner++) {
+						uint32_t current = collapseRemap[corners[corner]];
+						degenerates = degenerates || positionIds[current] == positionIds[target];
+						before[corner] = positions[current];
+						after[corner] = positionIds[current] == position ? positions[target] : before[corner];
+					}
+					if (degenerates) {
+						continue;
+					}
+					glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+					glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+					if (glm::dot(normalBefore, normalAfter) <= 0.0f) {
+						return true;
+					}
+				}
+				return false;
+			};
+
+			// Every edge collapse removes two triangles, one on borders
+			size_t triangleGoal = (result.size() - targetIndexCount + 2u) / 3u;
+			size_t removedTriangles = 0u;
+			for (const auto &collapse : collapses) {
+				if (removedTriangles >= triangleGoal) {
+					break;
+				}
+				uint32_t position = positionIds[collapse.vertex];
+				uint32_t targetPosition = positionIds[collapse.target];
+				if (locked[position] || locked[targetPosition] || flips(collapse.vertex, collapse.target)) {
+					continue;
+				}
+
+				collapseRemap[collapse.vertex] = collapse.target;
+				if (kinds[collapse.vertex] == VertexKind::Seam) {
+					collapseRemap[wedge[collapse.vertex]] = wedge[collapse.target];
+				}
+				quadrics[targetPosition].add(quadrics[position]);
+				locked[position] = true;
+				locked[targetPosition] = true;
+				removedTriangles += kinds[collapse.vertex] == VertexKind::Border ? 1u : 2u;
+				reachedError = std::max(reachedError, collapse.error);
+			}
+			if (removedTriangles == 0u) {
+				break;
+			}
+
+			// Drop the triangles that collapsed to a line or a point
+			size_t kept = 0u;
+			for (size_t index = 0; index < result.size(); index += 3u) {
+				uint32_t a = collapseRemap[result[index]];
+				uint32_t b = collapseRemap[result[index + 1u]];
+				uint32_t c = collapseRemap[result[index + 2u]];
+				if (positionIds[a] != positionIds[b] && positionIds[b] != positionIds[c] &&
+				    positionIds[c] != positionIds[a]) {
+					result[kept++] = a;
+					result[kept++] = b;
+					result[kept++] = c;
+				}
+			}
+			result.resize(kept);
+		}
+
+		return static_cast<float>(std::sqrt(reachedError));
+	}
+}
@@ -0,0 +1,30 @@
+#ifndef OBTAIN_GRAPHICS_VULKAN_MESH_SIMPLIFIER_HPP
+#define OBTAIN_GRAPHICS_VULKAN_MESH_SIMPLIFIER_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "vertex.hpp"
+
+namespace Obtain::Graphics::Vulkan {
+	/*
+	 * Quadric error metric simplifier (Garland and Heckbert, "Surface Simplification Using Quadric
+	 * Error Metrics"). Edges are collapsed onto one of their end points, cheapest first, so the result
+	 * only references existing vertices and can share the vertex buffer with the full detail mesh.
+	 * Vertices on open borders only slide along the border, and UV seams, positions shared by two
+	 * vertices with different attributes, only collapse along the seam with both sides at once, so
+	 * texture coordinates never tear. Positions shared by more than two vertices are left in place.
+	 */
+	class MeshSimplifier {
+	public:
+		// Collapses edges of indices[0, indexCount) until at most targetIndexCount indices are left or
+		// the next collapse would move the surface by more than targetError, then writes the remaining
+		// triangles to result. Errors are relative to the extent of vertices[0, vertexCount), the
+		// longest side of their bounding box; returns the error of the result.
+		static float simplify(const uint32_t *indices, size_t indexCount, const Vertex *vertices,
+		                      size_t vertexCount, size_t targetIndexCount, float targetError,
+		                      std::vector<uint32_t> &result);
+	};
+}
+
+#endif // OBTAIN_GRAPHICS_VULKAN_MESH_SIMPLIFIER_HPP
@@ -3,61 +3,490 @@
 //
 
 #include <memory>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <limits>
+#include <chrono>
 #include "model.hpp"
-
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.h>
+#include "mesh-optimizer.hpp"
+#include "mesh-simplifier.hpp"
+#include "obj-parser.hpp"
+#include "vertex-table.hpp"
 
 #define MODEL_LOCATION "assets/models/"
+#define COOKED_MODEL_EXTENSION ".obm"
 
 namespace Obtain::Graphics::Vulkan {
+	// Whether count elements of elementSize bytes at offset lie within a file of size bytes, aligned for
+	// the element type; written so that no corrupt count or offset can overflow
+	static bool isSectionValid(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t alignment,
+	                           uint64_t size)
+	{
+		return offset % alignment == 0u && offset <= size && count <= (size - offset) / elementSize;
+	}
+
+	// Five levels; the last keeps the silhouette of most models within a few pixels at thumbnail size
+	const std::vector<float> Model::DefaultLodErrors = {0.002f, 0.008f, 0.025f, 0.08f};
+
 	Model::Model(const std::string &source)
+		: Model()
 	{
 		auto filename = MODEL_LOCATION + source;
-		std::string warn, err;
+		auto cookedFilename = filename.substr(0, filename.find_last_of('.')) + COOKED_MODEL_EXTENSION;
 
-		if (!tinyobj::LoadObj(&attributes, &shapes, &materials, &warn, &err,
-		                      filename.c_str())) {
-			throw std::runtime_error(warn + err);
+		if (MappedFile::exists(cookedFilename) && loadCooked(cookedFilename)) {
+			return;
 		}
 
-		std::unordered_map<Vertex, uint32_t> uniqueVertices;
+		loadObj(filename, DefaultLodErrors);
+	}
 
-		for (const auto &shape : shapes) {
-			for (const auto& index : shape.mesh.indices) {
+	std::unique_ptr<Model> Model::unique(const std::string &source)
+	{
+		return std::make_unique<Model>(source);
+	}
+
+	std::unique_ptr<Model> Model::cook(const std::string &objFile, const std::string &cookedFile,
+	                                   const std::vector<float> &lodErrors)
+	{
+		std::unique_ptr<Model> model(new Model());
+		model->loadObj(objFile, lodErrors);
+		model->writeCooked(cookedFile);
+		return model;
+	}
+
+	const Vertex *Model::getVertexData()
+	{
+		return vertexData;
+	}
+
+	uint32_t Model::getVertexCount()
+	{
+		return vertexCount;
+	}
+
+	const void *Model::getIndexData()
+	{
+		return indexData;
+	}
+
+	uint32_t Model::getIndexCount()
+	{
+		return indexCount;
+	}
+
+	vk::IndexType Model::getIndexType()
+	{
+		return indexSize == sizeof(uint16_t) ? vk::IndexType::eUint16 : vk::IndexType::eUint32;
+	}
+
+	uint32_t Model::getIndexSize()
+	{
+		return indexSize;
+	}
+
+	const ModelShape *Model::getShapeData()
+	{
+		return shapeData;
+	}
+
+	uint32_t Model::getShapeCount()
+	{
+		return shapeCount;
+	}
+
+	const ModelLod *Model::getLodData()
+	{
+		return lodData;
+	}
+
+	uint32_t Model::getLodCount()
+	{
+		return lodCount;
+	}
+
+	const ModelPartition *Model::getPartitionData()
+	{
+		return partitionData;
+	}
+
+	uint32_t Model::getPartitionCount()
+	{
+		return partitionCount;
+	}
+
+	const ModelMeshlet *Model::getMeshletData()
+	{
+		return meshletData;
+	}
+
+	uint32_t Model::getMeshletCount()
+	{
+		return meshletCount;
+	}
+
+	const ModelBounds &Model::getBounds()
+	{
+		return bounds;
+	}
+
+	const ModelStatistics &Model::getStatistics()
+	{
+		return statistics;
+	}
+
+	/******************************************************
+	 ******************* private **************************
+	 *****************************************************/
+
+	Model::Model()
+		: vertexData(nullptr), vertexCount(0u), indexData(nullptr), indexCount(0u), indexSize(sizeof(uint32_t)),
+		  shapeData(nullptr), shapeCount(0u), lodData(nullptr), lodCount(0u), partitionData(nullptr), partitionCount(0u),
+		  meshletData(nullptr), meshletCount(0u), bounds(), statistics()
+	{}
+
+	bool Model::loadCooked(const std::string &filename)
+	{
+		auto file = MappedFile::unique(filename);
+		const char *data = file->getData();
+		size_t size = file->getSize();
+
+		if (size < sizeof(CookedModelHeader)) {
+			std::cerr << "ignoring truncated cooked model " << filename << std::endl;
+			return false;
+		}
+
+		CookedModelHeader header = {};
+		memcpy(&header, data, sizeof(header));
+
+		if (memcmp(header.magic, CookedModelMagic, sizeof(header.magic)) != 0 ||
+		    header.version != CookedModelVersion ||
+		    header.vertexStride != sizeof(Vertex) ||
+		    (header.indexSize != sizeof(uint16_t) && header.indexSize != sizeof(uint32_t))) {
+			std::cerr << "ignoring incompatible cooked model " << filename << std::endl;
+			return false;
+		}
+
+		// The mapping starts on a page boundary, so aligned offsets give aligned pointers
+		if (!isSectionValid(header.shapeOffset, header.shapeCount, sizeof(ModelShape), alignof(ModelShape), size) ||
+		    !isSectionValid(header.lodOffset, header.lodCount, sizeof(ModelLod), alignof(ModelLod), size) ||
+		    !isSectionValid(header.partitionOffset, header.partitionCount, sizeof(ModelPartition),
+		                    alignof(ModelPartition), size) ||
+		    !isSectionValid(header.meshletOffset, header.meshletCount, sizeof(ModelMeshlet), alignof(ModelMeshlet),
+		                    size) ||
+		    !isSectionValid(header.vertexOffset, header.vertexCount, sizeof(Vertex), alignof(Vertex), size) ||
+		    !isSectionValid(header.indexOffset, header.indexCount, header.indexSize, header.indexSize, size)) {
+			std::cerr << "ignoring truncated cooked model " << filename << std::endl;
+			return false;
+		}
+
+		vertexData = reinterpret_cast<const Vertex *>(data + header.vertexOffset);
+		vertexCount = header.vertexCount;
+		indexData = data + header.indexOffset;
+		indexCount = header.indexCount;
+		indexSize = header.indexSize;
+		shapeData = reinterpret_cast<const ModelShape *>(data + header.shapeOffset);
+		shapeCount = header.shapeCount;
+		lodData = reinterpret_cast<const ModelLod *>(data + header.lodOffset);
+		lodCount = header.lodCount;
+		partitionData = reinterpret_cast<const ModelPartition *>(data + header.partitionOffset);
+		partitionCount = header.partitionCount;
+		meshletData = reinterpret_cast<const ModelMeshlet *>(data + header.meshletOffset);
+		meshletCount = header.meshletCount;
+		bounds = header.bounds;
+
+		cookedFile = std::move(file);
+		return true;
+	}
+
+	void Model::loadObj(const std::string &filename, const std::vector<float> &lodErrors)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		MappedFile file(filename);
+		ObjData obj = ObjParser::parse(file.getData(), file.getSize());
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+		statistics.fileBytes = file.getSize();
+		statistics.parseSeconds = elapsed.count();
+
+		size_t cornerCount = 0u;
+		for (const auto &shape : obj.shapes) {
+			cornerCount += shape.indices.size();
+		}
+
+		VertexTable<Vertex> uniqueVertices(cornerCount);
+		indices.reserve(cornerCount);
+
+		for (const auto &shape : obj.shapes) {
+			ModelShape range = {static_cast<uint32_t>(indices.size()),
+			                    static_cast<uint32_t>(shape.indices.size())};
+			shapes.emplace_back(range);
+
+			for (const auto& index : shape.indices) {
 				Vertex vertex = {};
 				vertex.pos = {
-					attributes.vertices[3 * index.vertex_index],
-					attributes.vertices[3 * index.vertex_index + 1],
-					attributes.vertices[3 * index.vertex_index + 2]
-				};
-				vertex.texCoord = {
-					attributes.texcoords[2 * index.texcoord_index],
-					1.0f - attributes.texcoords[2 * index.texcoord_index + 1]
+					obj.vertices[3 * index.vertex],
+					obj.vertices[3 * index.vertex + 1],
+					obj.vertices[3 * index.vertex + 2]
 				};
+				if (index.texcoord >= 0) {
+					vertex.texCoord = {
+						obj.texcoords[2 * index.texcoord],
+						1.0f - obj.texcoords[2 * index.texcoord + 1]
+					};
+				}
 				vertex.color = {1.0f, 1.0f, 1.0f};
 
-				if (uniqueVertices.count(vertex) == 0) {
-					uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-					vertices.emplace_back(vertex);
-				}
+				indices.emplace_back(uniqueVertices.insert(vertex, vertices));
+			}
+		}
+
+		statistics.cornerCount = cornerCount;
+		statistics.collisionCount = uniqueVertices.getCollisionCount();
+		statistics.uniqueVertexCount = vertices.size();
 
-				indices.emplace_back(uniqueVertices[vertex]);
+		optimize();
+
+		for (int axis = 0; axis < 3; axis++) {
+			bounds.min[axis] = vertices.empty() ? 0.0f : std::numeric_limits<float>::max();
+			bounds.max[axis] = vertices.empty() ? 0.0f : std::numeric_limits<float>::lowest();
+		}
+		for (const auto &vertex : vertices) {
+			for (int axis = 0; axis < 3; axis++) {
+				bounds.min[axis] = std::min(bounds.min[axis], vertex.pos[axis]);
+				bounds.max[axis] = std::max(bounds.max[axis], vertex.pos[axis]);
 			}
 		}
+
+		buildLods(lodErrors);
+		indexCount = static_cast<uint32_t>(indices.size());
+		partition();
+		buildMeshlets();
+
+		vertexData = vertices.data();
+		vertexCount = static_cast<uint32_t>(vertices.size());
+		shapeData = shapes.data();
+		shapeCount = static_cast<uint32_t>(shapes.size());
+		lodData = lods.data();
+		lodCount = static_cast<uint32_t>(lods.size());
+		partitionData = partitions.data();
+		partitionCount = static_cast<uint32_t>(partitions.size());
+		meshletData = meshlets.data();
+		meshletCount = static_cast<uint32_t>(meshlets.size());
 	}
 
-	std::unique_ptr<Model> Model::unique(const std::string &source)
+	void Model::optimize()
 	{
-		return std::make_unique<Model>(Model(source));
+		statistics.unoptimized = MeshOptimizer::analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+
+		// Shapes keep their index ranges, triangles are only reordered within them
+		for (const auto &shape : shapes) {
+			MeshOptimizer::optimizeVertexCache(indices.data() + shape.firstIndex, shape.indexCount, vertices.size());
+		}
+		statistics.cacheOptimized = MeshOptimizer::analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+
+		// Meshes are drawn opaque with depth testing, so cheaper overdraw is worth a few cache misses
+		for (const auto &shape : shapes) {
+			MeshOptimizer::optimizeOverdraw(indices.data() + shape.firstIndex, shape.indexCount,
+			                                vertices.data(), vertices.size());
+		}
+		MeshOptimizer::optimizeVertexFetch(vertices, indices);
+
+		statistics.optimized = MeshOptimizer::analyzeVertexCache(indices.data(), indices.size(), vertices.size());
 	}
 
-	std::vector<Vertex> &Model::getVertices()
+	void Model::buildLods(const std::vector<float> &lodErrors)
 	{
-		return vertices;
+		// Levels below this share of the previous level's triangles are not worth their index memory
+		const float MaxLodRatio = 0.75f;
+
+		lods.push_back({0.0f, 0u, static_cast<uint32_t>(indices.size()), 0u, 0u, 0u, 0u});
+
+		// Every level is simplified from the full detail mesh, one shape at a time so triangles never
+		// merge across shapes, and optimized for the vertex cache like the full detail one
+		float extent = std::max(bounds.max[0] - bounds.min[0],
+		                        std::max(bounds.max[1] - bounds.min[1], bounds.max[2] - bounds.min[2]));
+		std::vector<uint32_t> simplified;
+		for (float targetError : lodErrors) {
+			ModelLod lod = {0.0f, static_cast<uint32_t>(indices.size()), 0u, 0u, 0u, 0u, 0u};
+			float error = 0.0f;
+
+			for (const auto &shape : shapes) {
+				error = std::max(error, MeshSimplifier::simplify(indices.data() + shape.firstIndex, shape.indexCount,
+				                                                 vertices.data(), vertices.size(), 0u, targetError,
+				                                                 simplified));
+				MeshOptimizer::optimizeVertexCache(simplified.data(), simplified.size(), vertices.size());
+				indices.insert(indices.end(), simplified.begin(), simplified.end());
+			}
+			lod.indexCount = static_cast<uint32_t>(indices.size()) - lod.firstIndex;
+			lod.error = error * extent;
+
+			if (lod.indexCount == 0u ||
+			    static_cast<float>(lod.indexCount) > MaxLodRatio * static_cast<float>(lods.back().indexCount)) {
+				indices.resize(lod.firstIndex);
+				continue;
+			}
+			lods.push_back(lod);
+		}
 	}
-	std::vector<uint32_t> &Model::getIndices()
+
+	void Model::partition()
 	{
-		return indices;
+		const uint32_t MaxShortVertices = 0x10000u;
+		const uint32_t Unassigned = std::numeric_limits<uint32_t>::max();
+
+		// Cut the index buffer into runs of triangles that use at most 65536 distinct vertices and give
+		// each run its own copy of those vertices, in order of first use. Only vertices on the seams
+		// between runs are duplicated. Levels of detail get partitions of their own, which keep using
+		// the vertex window of the previous partition while it has room.
+		std::vector<Vertex> partitionedVertices;
+		std::vector<ModelPartition> shortPartitions;
+		std::vector<uint16_t> partitionedIndices(indices.size());
+		std::vector<uint32_t> owner(vertices.size(), Unassigned);
+		std::vector<uint16_t> local(vertices.size());
+		std::vector<uint32_t> firstShortPartitions;
+		uint32_t window = Unassigned;
+
+		for (const auto &lod : lods) {
+			firstShortPartitions.push_back(static_cast<uint32_t>(shortPartitions.size()));
+
+			for (uint32_t index = lod.firstIndex; index < lod.firstIndex + lod.indexCount; index += 3u) {
+				const uint32_t *corners = indices.data() + index;
+				uint32_t added = 0u;
+				for (uint32_t corner = 0; corner < 3u; corner++) {
+					bool repeated = std::find(corners, corners + corner, corners[corner]) != corners + corner;
+					added += owner[corners[corner]] != window && !repeated ? 1u : 0u;
+				}
+
+				if (window == Unassigned ||
+				    partitionedVertices.size() + added > shortPartitions.back().vertexOffset + MaxShortVertices) {
+					window = static_cast<uint32_t>(shortPartitions.size());
+					shortPartitions.push_back({index, 0u, static_cast<uint32_t>(partitionedVertices.size())});
+				} else if (index == lod.firstIndex) {
+					shortPartitions.push_back({index, 0u, shortPartitions.back().vertexOffset});
+				}
+
+				ModelPartition &range = shortPartitions.back();
+				for (uint32_t corner = 0; corner < 3u; corner++) {
+					uint32_t vertex = corners[corner];
+					if (owner[vertex] != window) {
+						owner[vertex] = window;
+						local[vertex] = static_cast<uint16_t>(partitionedVertices.size() - range.vertexOffset);
+						partitionedVertices.emplace_back(vertices[vertex]);
+					}
+					partitionedIndices[index + corner] = local[vertex];
+				}
+				range.indexCount += 3u;
+			}
+		}
+
+		// Duplicated seam vertices have to cost less than the index bytes 16 bit indices save
+		uint64_t addedBytes = (partitionedVertices.size() - vertices.size()) * sizeof(Vertex);
+		uint64_t savedBytes = indices.size() * (sizeof(uint32_t) - sizeof(uint16_t));
+
+		if (addedBytes < savedBytes) {
+			statistics.duplicatedVertexCount = partitionedVertices.size() - vertices.size();
+
+			for (size_t lod = 0; lod < lods.size(); lod++) {
+				uint32_t end = lod + 1u < lods.size() ? firstShortPartitions[lod + 1u]
+				                                     : static_cast<uint32_t>(shortPartitions.size());
+				lods[lod].firstPartition = firstShortPartitions[lod];
+				lods[lod].partitionCount = end - firstShortPartitions[lod];
+			}
+			vertices.swap(partitionedVertices);
+			partitions = std::move(shortPartitions);
+			shortIndices = std::move(partitionedIndices);
+			std::vector<uint32_t>().swap(indices);
+			indexData = shortIndices.data();
+			indexSize = sizeof(uint16_t);
+		} else {
+			partitions.clear();
+			for (auto &lod : lods) {
+				lod.firstPartition = static_cast<uint32_t>(partitions.size());
+				lod.partitionCount = 1u;
+				partitions.push_back({lod.firstIndex, lod.indexCount, 0u});
+			}
+			indexData = indices.data();
+			indexSize = sizeof(uint32_t);
+		}
+	}
+
+	void Model::buildMeshlets()
+	{
+		std::vector<uint32_t> partitionIndices;
+
+		// Partitions are in order of their level of detail, so each level's meshlets are contiguous
+		for (auto &lod : lods) {
+			lod.firstMeshlet = static_cast<uint32_t>(meshlets.size());
+			for (uint32_t partition = lod.firstPartition; partition < lod.firstPartition + lod.partitionCount; partition++) {
+				const ModelPartition &range = partitions[partition];
+				partitionIndices.resize(range.indexCount);
+				for (uint32_t index = 0; index < range.indexCount; index++) {
+					uint32_t local = indexSize == sizeof(uint16_t) ? shortIndices[range.firstIndex + index]
+					                                               : indices[range.firstIndex + index];
+					partitionIndices[index] = range.vertexOffset + local;
+				}
+
+				size_t first = meshlets.size();
+				MeshOptimizer::buildMeshlets(partitionIndices.data(), partitionIndices.size(), vertices.data(), meshlets);
+				for (size_t meshlet = first; meshlet < meshlets.size(); meshlet++) {
+					meshlets[meshlet].firstIndex += range.firstIndex;
+					meshlets[meshlet].vertexOffset = range.vertexOffset;
+					meshlets[meshlet].partition = partition;
+				}
+			}
+			lod.meshletCount = static_cast<uint32_t>(meshlets.size()) - lod.firstMeshlet;
+		}
+	}
+
+	void Model::writeCooked(const std::string &filename)
+	{
+		auto align = [](uint64_t offset) {
+			return (offset + CookedModelAlignment - 1) & ~(CookedModelAlignment - 1);
+		};
+
+		CookedModelHeader header = {};
+		memcpy(header.magic, CookedModelMagic, sizeof(header.magic));
+		header.version = CookedModelVersion;
+		header.vertexStride = sizeof(Vertex);
+		header.vertexCount = vertexCount;
+		header.indexCount = indexCount;
+		header.indexSize = indexSize;
+		header.shapeCount = shapeCount;
+		header.partitionCount = partitionCount;
+		header.meshletCount = meshletCount;
+		header.lodCount = lodCount;
+		header.bounds = bounds;
+		header.shapeOffset = align(sizeof(CookedModelHeader));
+		header.lodOffset = align(header.shapeOffset + shapeCount * sizeof(ModelShape));
+		header.partitionOffset = align(header.lodOffset + lodCount * sizeof(ModelLod));
+		header.meshletOffset = align(header.partitionOffset + partitionCount * sizeof(ModelPartition));
+		header.vertexOffset = align(header.meshletOffset + meshletCount * sizeof(ModelMeshlet));
+		header.indexOffset = align(header.vertexOffset + vertexCount * static_cast<uint64_t>(sizeof(Vertex)));
+
+		std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			throw std::runtime_error("failed to open " + filename + " for writing");
+		}
+
+		const char padding[CookedModelAlignment] = {};
+		auto writeSection = [&file, &padding](uint64_t offset, const void *data, uint64_t size) {
+			auto position = static_cast<uint64_t>(file.tellp());
+			file.write(padding, static_cast<std::streamsize>(offset - position));
+			file.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+		};
+
+		file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		writeSection(header.shapeOffset, shapeData, shapeCount * sizeof(ModelShape));
+		writeSection(header.lodOffset, lodData, lodCount * sizeof(ModelLod));
+		writeSection(header.partitionOffset, partitionData, partitionCount * sizeof(ModelPartition));
+		writeSection(header.meshletOffset, meshletData, meshletCount * sizeof(ModelMeshlet));
+		writeSection(header.vertexOffset, vertexData, vertexCount * static_cast<uint64_t>(sizeof(Vertex)));
+		writeSection(header.indexOffset, indexData, indexCount * static_cast<uint64_t>(indexSize));
+
+		if (!file.good()) {
+			throw std::runtime_error("failed to write cooked model " + filename);
+		}
 	}
-}
\ No newline at end of file
+}
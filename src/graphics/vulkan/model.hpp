@@ -6,25 +6,92 @@
 #define OBTAIN_GRAPHICS_VULKAN_MODEL_HPP
 
 #include "vertex.hpp"
-
-#include <tiny_obj_loader.h>
+#include "cooked-model.hpp"
+#include "mesh-optimizer.hpp"
+#include "../../utils/mapped-file.hpp"
 
 namespace Obtain::Graphics::Vulkan {
+	// What building a model from an OBJ file took, for the cook tool to report; zero for cooked models
+	struct ModelStatistics {
+		uint64_t fileBytes;
+		double parseSeconds;
+		uint64_t cornerCount;
+		uint64_t collisionCount; // of deduplicating the corners into vertices
+		uint64_t uniqueVertexCount;
+		VertexCacheStatistics unoptimized;
+		VertexCacheStatistics cacheOptimized;
+		VertexCacheStatistics optimized; // for the vertex cache and then overdraw
+		uint64_t duplicatedVertexCount; // seam vertices copied so partitions can use 16 bit indices
+	};
+
 	class Model {
 	public:
+		// Relative errors (see MeshSimplifier) the levels of detail after the first are simplified to
+		static const std::vector<float> DefaultLodErrors;
+
 		explicit Model(const std::string &source);
 		static std::unique_ptr<Model> unique(const std::string &source);
 
-		std::vector<Vertex> &getVertices();
-		std::vector<uint32_t> &getIndices();
+		// Parses an OBJ file and writes the cooked (.obm) form of it; returns the model that was written
+		static std::unique_ptr<Model> cook(const std::string &objFile, const std::string &cookedFile,
+		                                   const std::vector<float> &lodErrors = DefaultLodErrors);
+
+		const Vertex *getVertexData();
+		uint32_t getVertexCount();
+		// uint16_t or uint32_t indices, see getIndexType
+		const void *getIndexData();
+		uint32_t getIndexCount();
+		vk::IndexType getIndexType();
+		uint32_t getIndexSize();
+		const ModelShape *getShapeData();
+		uint32_t getShapeCount();
+		const ModelLod *getLodData();
+		uint32_t getLodCount();
+		const ModelPartition *getPartitionData();
+		uint32_t getPartitionCount();
+		const ModelMeshlet *getMeshletData();
+		uint32_t getMeshletCount();
+		const ModelBounds &getBounds();
+		const ModelStatistics &getStatistics();
 
 	private:
-		tinyobj::attrib_t attributes;
-		std::vector<tinyobj::shape_t> shapes;
-		std::vector<tinyobj::material_t> materials;
+		// Backing storage when the model was parsed from an OBJ file
 		std::vector<Vertex> vertices;
 		std::vector<uint32_t> indices;
+		std::vector<uint16_t> shortIndices;
+		std::vector<ModelShape> shapes;
+		std::vector<ModelLod> lods;
+		std::vector<ModelPartition> partitions;
+		std::vector<ModelMeshlet> meshlets;
+
+		// Backing storage when the model was loaded from a cooked file
+		std::unique_ptr<MappedFile> cookedFile;
+
+		const Vertex *vertexData;
+		uint32_t vertexCount;
+		const void *indexData;
+		uint32_t indexCount;
+		uint32_t indexSize;
+		const ModelShape *shapeData;
+		uint32_t shapeCount;
+		const ModelLod *lodData;
+		uint32_t lodCount;
+		const ModelPartition *partitionData;
+		uint32_t partitionCount;
+		const ModelMeshlet *meshletData;
+		uint32_t meshletCount;
+		ModelBounds bounds;
+		ModelStatistics statistics;
+
+		Model();
 
+		bool loadCooked(const std::string &filename);
+		void loadObj(const std::string &filename, const std::vector<float> &lodErrors);
+		void optimize();
+		void buildLods(const std::vector<float> &lodErrors);
+		void partition();
+		void buildMeshlets();
+		void writeCooked(const std::string &filename);
 	};
 }
 
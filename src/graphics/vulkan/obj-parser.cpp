@@ -0,0 +1,583 @@
+#include "obj-parser.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+#include "../../utils/mapped-file.hpp"
+
+namespace Obtain::Graphics::Vulkan {
+	namespace {
+		// Files smaller than this per thread are not worth splitting up further
+		const size_t MinimumChunkSize = 1u << 20u;
+
+		struct ShapeMarker {
+			size_t face;
+			std::string name;
+			size_t triangleOffset;
+		};
+
+		struct Chunk {
+			const char *begin;
+			const char *end;
+
+			std::vector<float> vertices;
+			std::vector<float> texcoords;
+			std::vector<float> normals;
+
+			// Face corners as vertex/texcoord/normal triples and the corner count of every face
+			std::vector<int32_t> corners;
+			std::vector<uint32_t> faceSizes;
+			// Positions in corners holding a relative (negative) index that still lacks the chunk base
+			std::vector<std::pair<size_t, int>> relativeIndices;
+			std::vector<ShapeMarker> markers;
+
+			int32_t bases[3];
+			std::vector<ObjIndex> triangles;
+
+			std::string error;
+		};
+
+		inline bool isSpace(char c)
+		{
+			return c == ' ' || c == '\t';
+		}
+
+		inline bool isDigit(char c)
+		{
+			return c >= '0' && c <= '9';
+		}
+
+		inline const char *skipBlanks(const char *p, const char *end)
+		{
+			while (p < end && isSpace(*p)) {
+				p++;
+			}
+			return p;
+		}
+
+		// End of a whitespace separated token, or of a corner component when slash is set
+		inline const char *tokenEnd(const char *p, const char *end, bool slash = false)
+		{
+			while (p < end && !isSpace(*p) && *p != '\r' && !(slash && *p == '/')) {
+				p++;
+			}
+			return p;
+		}
+
+		// Same digit-by-digit algorithm as tinyobjloader so both produce bit identical floats
+		bool tryParseDouble(const char *s, const char *end, double *result)
+		{
+			if (s >= end) {
+				return false;
+			}
+
+			double mantissa = 0.0;
+			int exponent = 0;
+			char sign = '+';
+			char exponentSign = '+';
+			const char *current = s;
+			int read = 0;
+
+			if (*current == '+' || *current == '-') {
+				sign = *current;
+				current++;
+			} else if (!isDigit(*current)) {
+				return false;
+			}
+
+			while (current != end && isDigit(*current)) {
+				mantissa *= 10;
+				mantissa += static_cast<int>(*current - '0');
+				current++;
+				read++;
+			}
+
+			if (read == 0) {
+				return false;
+			}
+
+			if (current != end) {
+				bool exponentFollows = false;
+
+				if (*current == '.') {
+					static const double powers[] = {
+						1.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001
+					};
+					const int powerCount = sizeof(powers) / sizeof(powers[0]);
+
+					current++;
+					read = 1;
+					while (current != end && isDigit(*current)) {
+						mantissa += static_cast<int>(*current - '0') *
+						            (read < powerCount ? powers[read] : std::pow(10.0, -read));
+						read++;
+						current++;
+					}
+					exponentFollows = current != end;
+				} else if (*current == 'e' || *current == 'E') {
+					exponentFollows = true;
+				}
+
+				if (exponentFollows && (*current == 'e' || *current == 'E')) {
+					current++;
+					if (current != end && (*current == '+' || *current == '-')) {
+						exponentSign = *current;
+						current++;
+					} else if (current == end || !isDigit(*current)) {
+						return false;
+					}
+
+					read = 0;
+					while (current != end && isDigit(*current)) {
+						exponent *= 10;
+						exponent += static_cast<int>(*current - '0');
+						current++;
+						read++;
+					}
+					exponent *= (exponentSign == '+' ? 1 : -1);
+					if (read == 0) {
+						return false;
+					}
+				}
+			}
+
+			*result = (sign == '+' ? 1 : -1) *
+			          (exponent ? std::ldexp(mantissa * std::pow(5.0, exponent), exponent) : mantissa);
+			return true;
+		}
+
+		float parseReal(const char *&p, const char *end, double defaultValue = 0.0)
+		{
+			p = skipBlanks(p, end);
+			const char *realEnd = tokenEnd(p, end);
+			double value = defaultValue;
+			tryParseDouble(p, realEnd, &value);
+			p = realEnd;
+			return static_cast<float>(value);
+		}
+
+		// atoi() that stays inside the line
+		int parseInt(const char *p, const char *end)
+		{
+			while (p < end && (isSpace(*p) || *p == '\r' || *p == '\v' || *p == '\f')) {
+				p++;
+			}
+			int sign = 1;
+			if (p < end && (*p == '+' || *p == '-')) {
+				sign = *p == '-' ? -1 : 1;
+				p++;
+			}
+			int value = 0;
+			while (p < end && isDigit(*p)) {
+				value = value * 10 + (*p - '0');
+				p++;
+			}
+			return sign * value;
+		}
+
+		std::string parseString(const char *&p, const char *end)
+		{
+			p = skipBlanks(p, end);
+			const char *stringEnd = tokenEnd(p, end);
+			std::string token(p, stringEnd);
+			p = stringEnd;
+			return token;
+		}
+
+		// Parses a face corner (i, i/j, i//k or i/j/k) into zero based indices. Relative (negative)
+		// indices are resolved against this chunk's attribute counts and remembered, so the chunk's
+		// base can be added once the counts of all previous chunks are known.
+		bool parseTriple(Chunk &chunk, const char *&p, const char *end)
+		{
+			const size_t counts[3] = {
+				chunk.vertices.size() / 3, chunk.texcoords.size() / 2, chunk.normals.size() / 3
+			};
+			int32_t triple[3] = {-1, -1, -1};
+			bool relative[3] = {false, false, false};
+
+			auto fixIndex = [&](int attribute) {
+				int index = parseInt(p, end);
+				if (index == 0) {
+					return false;
+				}
+				relative[attribute] = index < 0;
+				triple[attribute] = index > 0 ? index - 1 : static_cast<int32_t>(counts[attribute]) + index;
+				p = tokenEnd(p, end, true);
+				return true;
+			};
+
+			bool parsed = fixIndex(0);
+			if (parsed && p < end && *p == '/') {
+				p++;
+				if (p < end && *p == '/') {
+					p++;
+					parsed = fixIndex(2);
+				} else {
+					parsed = fixIndex(1);
+					if (parsed && p < end && *p == '/') {
+						p++;
+						parsed = fixIndex(2);
+					}
+				}
+			}
+
+			if (!parsed) {
+				return false;
+			}
+
+			size_t corner = chunk.corners.size();
+			for (int attribute = 0; attribute < 3; attribute++) {
+				if (relative[attribute]) {
+					chunk.relativeIndices.emplace_back(corner + attribute, attribute);
+				}
+				chunk.corners.emplace_back(triple[attribute]);
+			}
+			return true;
+		}
+
+		void parseLine(Chunk &chunk, const char *p, const char *end)
+		{
+			// Trailing carriage returns belong to the line terminator
+			while (end > p && end[-1] == '\r') {
+				end--;
+			}
+
+			p = skipBlanks(p, end);
+			if (end - p < 2 || *p == '#') {
+				return;
+			}
+
+			if (p[0] == 'v' && isSpace(p[1])) {
+				p += 2;
+				chunk.vertices.emplace_back(parseReal(p, end));
+				chunk.vertices.emplace_back(parseReal(p, end));
+				chunk.vertices.emplace_back(parseReal(p, end));
+				return;
+			}
+
+			if (end - p >= 3 && p[0] == 'v' && p[1] == 't' && isSpace(p[2])) {
+				p += 3;
+				chunk.texcoords.emplace_back(parseReal(p, end));
+				chunk.texcoords.emplace_back(parseReal(p, end));
+				return;
+			}
+
+			if (end - p >= 3 && p[0] == 'v' && p[1] == 'n' && isSpace(p[2])) {
+				p += 3;
+				chunk.normals.emplace_back(parseReal(p, end));
+				chunk.normals.emplace_back(parseReal(p, end));
+				chunk.normals.emplace_back(parseReal(p, end));
+				return;
+			}
+
+			if (p[0] == 'f' && isSpace(p[1])) {
+				p = skipBlanks(p + 2, end);
+
+				uint32_t cornerCount = 0;
+				while (p < end) {
+					if (!parseTriple(chunk, p, end)) {
+						chunk.error = "failed to parse face (zero index?)";
+						return;
+					}
+					cornerCount++;
+					while (p < end && (isSpace(*p) || *p == '\r')) {
+						p++;
+					}
+				}
+				chunk.faceSizes.emplace_back(cornerCount);
+				return;
+			}
+
+			if (p[0] == 'g' && isSpace(p[1])) {
+				std::vector<std::string> names;
+				while (p < end) {
+					names.emplace_back(parseString(p, end));
+					while (p < end && (isSpace(*p) || *p == '\r')) {
+						p++;
+					}
+				}
+
+				std::string name;
+				for (size_t i = 1; i < names.size(); i++) {
+					name += (i > 1 ? " " : "") + names[i];
+				}
+				chunk.markers.emplace_back(ShapeMarker{chunk.faceSizes.size(), name, 0u});
+				return;
+			}
+
+			if (p[0] == 'o' && isSpace(p[1])) {
+				chunk.markers.emplace_back(ShapeMarker{chunk.faceSizes.size(), std::string(p + 2, end), 0u});
+			}
+		}
+
+		void parseChunk(Chunk &chunk)
+		{
+			const char *p = chunk.begin;
+			while (p < chunk.end && chunk.error.empty()) {
+				auto lineEnd = static_cast<const char *>(memchr(p, '\n', static_cast<size_t>(chunk.end - p)));
+				if (!lineEnd) {
+					lineEnd = chunk.end;
+				}
+				parseLine(chunk, p, lineEnd);
+				p = lineEnd + 1;
+			}
+		}
+
+		// Point in polygon test from https://wrf.ecse.rpi.edu/Research/Short_Notes/pnpoly.html
+		bool pointInTriangle(const float *x, const float *y, float testX, float testY)
+		{
+			bool inside = false;
+			for (int i = 0, j = 2; i < 3; j = i++) {
+				if (((y[i] > testY) != (y[j] > testY)) &&
+				    (testX < (x[j] - x[i]) * (testY - y[i]) / (y[j] - y[i]) + x[i])) {
+					inside = !inside;
+				}
+			}
+			return inside;
+		}
+
+		// Ear clipping in the polygon's dominant plane, mirroring tinyobjloader's triangulation
+		void triangulatePolygon(const ObjIndex *polygon, size_t count, const std::vector<float> &v,
+		                        std::vector<ObjIndex> &triangles)
+		{
+			auto valid = [&v](int32_t index, size_t component) {
+				return index >= 0 && static_cast<size_t>(index) * 3 + component < v.size();
+			};
+
+			size_t axes[2] = {1, 2};
+			for (size_t k = 0; k < count; k++) {
+				int32_t i0 = polygon[k % count].vertex;
+				int32_t i1 = polygon[(k + 1) % count].vertex;
+				int32_t i2 = polygon[(k + 2) % count].vertex;
+				if (!valid(i0, 2) || !valid(i1, 2) || !valid(i2, 2)) {
+					continue;
+				}
+
+				float e0x = v[i1 * 3] - v[i0 * 3];
+				float e0y = v[i1 * 3 + 1] - v[i0 * 3 + 1];
+				float e0z = v[i1 * 3 + 2] - v[i0 * 3 + 2];
+				float e1x = v[i2 * 3] - v[i1 * 3];
+				float e1y = v[i2 * 3 + 1] - v[i1 * 3 + 1];
+				float e1z = v[i2 * 3 + 2] - v[i1 * 3 + 2];
+				float cx = std::fabs(e0y * e1z - e0z * e1y);
+				float cy = std::fabs(e0z * e1x - e0x * e1z);
+				float cz = std::fabs(e0x * e1y - e0y * e1x);
+				const float epsilon = std::numeric_limits<float>::epsilon();
+				if (cx > epsilon || cy > epsilon || cz > epsilon) {
+					if (!(cx > cy && cx > cz)) {
+						axes[0] = 0;
+						if (cz > cx && cz > cy) {
+							axes[1] = 1;
+						}
+					}
+					break;
+				}
+			}
+
+			float area = 0.0f;
+			for (size_t k = 0; k < count; k++) {
+				int32_t i0 = polygon[k].vertex;
+				int32_t i1 = polygon[(k + 1) % count].vertex;
+				if (!valid(i0, axes[0]) || !valid(i0, axes[1]) || !valid(i1, axes[0]) || !valid(i1, axes[1])) {
+					continue;
+				}
+				area += (v[i0 * 3 + axes[0]] * v[i1 * 3 + axes[1]] -
+				         v[i0 * 3 + axes[1]] * v[i1 * 3 + axes[0]]) * 0.5f;
+			}
+
+			std::vector<ObjIndex> remaining(polygon, polygon + count);
+			int maxRounds = 10;
+			size_t guess = 0;
+
+			while (remaining.size() > 3 && maxRounds > 0) {
+				size_t size = remaining.size();
+				if (guess >= size) {
+					maxRounds--;
+					guess -= size;
+				}
+
+				ObjIndex corner[3];
+				float x[3], y[3];
+				for (size_t k = 0; k < 3; k++) {
+					corner[k] = remaining[(guess + k) % size];
+					bool inRange = valid(corner[k].vertex, axes[0]) && valid(corner[k].vertex, axes[1]);
+					x[k] = inRange ? v[corner[k].vertex * 3 + axes[0]] : 0.0f;
+					y[k] = inRange ? v[corner[k].vertex * 3 + axes[1]] : 0.0f;
+				}
+
+				float cross = (x[1] - x[0]) * (y[2] - y[1]) - (y[1] - y[0]) * (x[2] - x[1]);
+				if (cross * area < 0.0f) {
+					guess++;
+					continue;
+				}
+
+				bool overlap = false;
+				for (size_t other = 3; other < size; other++) {
+					int32_t index = remaining[(guess + other) % size].vertex;
+					if (!valid(index, axes[0]) || !valid(index, axes[1])) {
+						continue;
+					}
+					if (pointInTriangle(x, y, v[index * 3 + axes[0]], v[index * 3 + axes[1]])) {
+						overlap = true;
+						break;
+					}
+				}
+
+				if (overlap) {
+					guess++;
+					continue;
+				}
+
+				triangles.insert(triangles.end(), corner, corner + 3);
+				remaining.erase(remaining.begin() + static_cast<std::ptrdiff_t>((guess + 1) % size));
+			}
+
+			if (remaining.size() == 3) {
+				triangles.insert(triangles.end(), remaining.begin(), remaining.end());
+			}
+		}
+
+		void triangulateChunk(Chunk &chunk, const std::vector<float> &vertices)
+		{
+			for (const auto &relative : chunk.relativeIndices) {
+				chunk.corners[relative.first] += chunk.bases[relative.second];
+			}
+
+			auto polygon = reinterpret_cast<const ObjIndex *>(chunk.corners.data());
+			auto marker = chunk.markers.begin();
+			chunk.triangles.reserve(chunk.faceSizes.size() * 3);
+
+			for (size_t face = 0; face < chunk.faceSizes.size(); face++) {
+				for (; marker != chunk.markers.end() && marker->face == face; marker++) {
+					marker->triangleOffset = chunk.triangles.size();
+				}
+
+				uint32_t size = chunk.faceSizes[face];
+				if (size == 3) {
+					chunk.triangles.insert(chunk.triangles.end(), polygon, polygon + 3);
+				} else if (size > 3) {
+					triangulatePolygon(polygon, size, vertices, chunk.triangles);
+				}
+				polygon += size;
+			}
+
+			for (; marker != chunk.markers.end(); marker++) {
+				marker->triangleOffset = chunk.triangles.size();
+			}
+		}
+
+		template<typename Function>
+		void forEachChunk(std::vector<Chunk> &chunks, Function function)
+		{
+			std::vector<std::thread> threads;
+			threads.reserve(chunks.size());
+			for (auto &chunk : chunks) {
+				threads.emplace_back([&chunk, &function]() {
+					function(chunk);
+				});
+			}
+			for (auto &thread : threads) {
+				thread.join();
+			}
+		}
+	}
+
+	static_assert(sizeof(ObjIndex) == 3 * sizeof(int32_t), "ObjIndex must alias a corner triple");
+
+	ObjData ObjParser::parse(const std::string &filename, unsigned int threadCount)
+	{
+		MappedFile file(filename);
+		return parse(file.getData(), file.getSize(), threadCount);
+	}
+
+	ObjData ObjParser::parse(const char *data, size_t size, unsigned int threadCount)
+	{
+		if (threadCount == 0u) {
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+		}
+		size_t chunkCount = std::max<size_t>(1u, std::min<size_t>(threadCount, size / MinimumChunkSize));
+
+		// Split into roughly equal chunks that each end right after a newline
+		std::vector<Chunk> chunks(chunkCount);
+		const char *begin = data;
+		const char *end = data + size;
+		for (size_t i = 0; i < chunkCount; i++) {
+			const char *chunkEnd = i + 1 == chunkCount ? end : std::max(begin, data + size / chunkCount * (i + 1));
+			if (chunkEnd < end) {
+				auto newline = static_cast<const char *>(memchr(chunkEnd, '\n', static_cast<size_t>(end - chunkEnd)));
+				chunkEnd = newline ? newline + 1 : end;
+			}
+			chunks[i].begin = begin;
+			chunks[i].end = chunkEnd;
+			begin = chunkEnd;
+		}
+
+		forEachChunk(chunks, parseChunk);
+
+		for (const auto &chunk : chunks) {
+			if (!chunk.error.empty()) {
+				throw std::runtime_error("OBJ parse error near byte " +
+				                         std::to_string(chunk.begin - data) + ": " + chunk.error);
+			}
+		}
+
+		// Every chunk's attributes continue where the previous chunk's ended
+		ObjData result;
+		size_t counts[3] = {0u, 0u, 0u};
+		for (auto &chunk : chunks) {
+			chunk.bases[0] = static_cast<int32_t>(counts[0]);
+			chunk.bases[1] = static_cast<int32_t>(counts[1]);
+			chunk.bases[2] = static_cast<int32_t>(counts[2]);
+			counts[0] += chunk.vertices.size() / 3;
+			counts[1] += chunk.texcoords.size() / 2;
+			counts[2] += chunk.normals.size() / 3;
+		}
+
+		result.vertices.resize(counts[0] * 3);
+		result.texcoords.resize(counts[1] * 2);
+		result.normals.resize(counts[2] * 3);
+
+		forEachChunk(chunks, [&result](Chunk &chunk) {
+			std::copy(chunk.vertices.begin(), chunk.vertices.end(), result.vertices.begin() + chunk.bases[0] * 3);
+			std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), result.texcoords.begin() + chunk.bases[1] * 2);
+			std::copy(chunk.normals.begin(), chunk.normals.end(), result.normals.begin() + chunk.bases[2] * 3);
+			std::vector<float>().swap(chunk.vertices);
+			std::vector<float>().swap(chunk.texcoords);
+			std::vector<float>().swap(chunk.normals);
+		});
+
+		forEachChunk(chunks, [&result](Chunk &chunk) {
+			triangulateChunk(chunk, result.vertices);
+		});
+
+		// Stitch the triangles into shapes, a shape may span several chunks
+		ObjShape shape;
+		auto finishShape = [&result, &shape](const std::string &nextName) {
+			if (!shape.indices.empty()) {
+				result.shapes.emplace_back(std::move(shape));
+			}
+			shape = ObjShape();
+			shape.name = nextName;
+		};
+
+		for (auto &chunk : chunks) {
+			size_t offset = 0u;
+			for (const auto &marker : chunk.markers) {
+				shape.indices.insert(shape.indices.end(),
+				                     chunk.triangles.begin() + offset,
+				                     chunk.triangles.begin() + marker.triangleOffset);
+				offset = marker.triangleOffset;
+				finishShape(marker.name);
+			}
+			shape.indices.insert(shape.indices.end(), chunk.triangles.begin() + offset, chunk.triangles.end());
+			std::vector<ObjIndex>().swap(chunk.triangles);
+		}
+		finishShape(std::string());
+
+		return result;
+	}
+}
@@ -0,0 +1,43 @@
+#ifndef OBTAIN_GRAPHICS_VULKAN_OBJ_PARSER_HPP
+#define OBTAIN_GRAPHICS_VULKAN_OBJ_PARSER_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Obtain::Graphics::Vulkan {
+	// Zero based attribute indices of one face corner, -1 when the corner has no such attribute
+	struct ObjIndex {
+		int32_t vertex;
+		int32_t texcoord;
+		int32_t normal;
+	};
+
+	// Triangulated faces between two `o`/`g` statements
+	struct ObjShape {
+		std::string name;
+		std::vector<ObjIndex> indices;
+	};
+
+	struct ObjData {
+		std::vector<float> vertices;  // xyz
+		std::vector<float> texcoords; // uv
+		std::vector<float> normals;   // xyz
+		std::vector<ObjShape> shapes;
+	};
+
+	/*
+	 * Parses the geometry of Wavefront OBJ files (`v`, `vt`, `vn`, `f`, `g` and `o` records).
+	 * The file is split into newline aligned chunks that are parsed on separate threads and
+	 * then merged, so the result matches a sequential parse: same attribute order, same shapes,
+	 * and polygons are triangulated the same way tinyobjloader does it.
+	 */
+	class ObjParser {
+	public:
+		static ObjData parse(const std::string &filename, unsigned int threadCount = 0u);
+
+		static ObjData parse(const char *data, size_t size, unsigned int threadCount = 0u);
+	};
+}
+
+#endif // OBTAIN_GRAPHICS_VULKAN_OBJ_PARSER_HPP
@@ -8,6 +8,7 @@
 #include "buffer.hpp"
 
 #define TEXTURE_LOCATION "assets/textures/"
+#define SHADER_LOCATION "assets/shaders/"
 
 namespace Obtain::Graphics::Vulkan {
 
@@ -15,94 +16,157 @@ namespace Obtain::Graphics::Vulkan {
 	 ******************* public **************************
 	 *****************************************************/
 
-	Object::Object(Device *device, vk::UniqueCommandPool &commandPool, const std::string &modelFile,
-	               const std::string &textureFile)
-		: model(Model::unique(modelFile)), vertices(model->getVertices()), indices(model->getIndices()),
-		  textureImage(Image::createTextureImage(device, commandPool, textureFile)),
-		  device(device), commandPool(commandPool), buffer(createBuffer())
+	Object::Object(Device *device, UploadBatch &batch, GeometryPool &geometryPool, const std::string &modelFile,
+	               const std::string &textureFile, bool packVertices)
+		: model(Model::unique(modelFile)),
+		  vertexFormat(createVertexFormat(packVertices)),
+		  textureImage(Image::createTextureImage(device, batch, textureFile)),
+		  device(device), geometry(createGeometry(batch, geometryPool)), meshletBuffer(createMeshletBuffer(batch))
 	{}
 
-	std::unique_ptr<Object> Object::unique(Device *device, vk::UniqueCommandPool &commandPool,
-	                                       const std::string &modelFile, const std::string &textureFile)
+	std::unique_ptr<Object> Object::unique(Device *device, UploadBatch &batch, GeometryPool &geometryPool,
+	                                       const std::string &modelFile, const std::string &textureFile,
+	                                       bool packVertices)
 	{
-		return std::make_unique<Object>(Object(device, commandPool,
-		                                       modelFile, textureFile));
+		return std::make_unique<Object>(Object(device, batch, geometryPool,
+		                                       modelFile, textureFile, packVertices));
 	}
 
-	std::vector<Vertex> &Object::getVertices()
+	const void *Object::getVertexData()
 	{
-		return vertices;
+		if (!packedVertices.empty()) {
+			return packedVertices.data();
+		}
+		return model->getVertexData();
 	}
 
-	std::vector<uint32_t> &Object::getIndices()
+	const VertexFormat &Object::getVertexFormat()
 	{
-		return indices;
+		return vertexFormat;
 	}
 
-	std::unique_ptr<Image> &Object::getTextureImage()
+	const void *Object::getIndexData()
 	{
-		return textureImage;
+		return model->getIndexData();
 	}
 
-	vk::DeviceSize Object::getVertexBufferSize()
+	vk::IndexType Object::getIndexType()
 	{
-		return static_cast<vk::DeviceSize>(sizeof(vertices[0]) * vertices.size());
+		return model->getIndexType();
 	}
 
-	vk::DeviceSize Object::getIndexBufferSize()
+	const ModelPartition *Object::getPartitionData()
 	{
-		return static_cast<vk::DeviceSize>(sizeof(indices[0]) * indices.size());
+		return model->getPartitionData();
 	}
 
-	vk::DeviceSize Object::getBufferSize()
+	uint32_t Object::getPartitionCount()
 	{
-		return getVertexBufferSize() + getIndexBufferSize();
+		return model->getPartitionCount();
 	}
 
-	vk::DeviceSize Object::getVertexBufferOffset()
+	const ModelLod *Object::getLodData()
 	{
-		return buffer->getOffset() + getIndexBufferSize();
+		return model->getLodData();
 	}
 
-	vk::DeviceSize Object::getIndexBufferOffset()
+	uint32_t Object::getLodCount()
 	{
-		return getBufferOffset();
+		return model->getLodCount();
 	}
 
-	vk::DeviceSize Object::getBufferOffset()
+	uint32_t Object::selectLod(const glm::vec3 &cameraPosition, float pixelsPerUnit, float maxPixelError)
 	{
-		return buffer->getOffset();
+		const ModelBounds &bounds = model->getBounds();
+		glm::vec3 minimum(bounds.min[0], bounds.min[1], bounds.min[2]);
+		glm::vec3 maximum(bounds.max[0], bounds.max[1], bounds.max[2]);
+
+		// Distance to the nearest point of the bounding sphere, so no part of the model is closer
+		float distance = glm::distance(cameraPosition, (minimum + maximum) * 0.5f) -
+		                 glm::distance(minimum, maximum) * 0.5f;
+		if (distance <= 0.0f) {
+			return 0u;
+		}
+
+		uint32_t selected = 0u;
+		for (uint32_t lod = 1; lod < model->getLodCount(); lod++) {
+			if (model->getLodData()[lod].error * pixelsPerUnit / distance <= maxPixelError) {
+				selected = lod;
+			}
+		}
+		return selected;
+	}
+
+	const GeometryAllocation &Object::getGeometry()
+	{
+		return geometry;
+	}
+
+	std::unique_ptr<Buffer> &Object::getMeshletBuffer()
+	{
+		return meshletBuffer;
+	}
+
+	uint32_t Object::getMeshletCount()
+	{
+		return model->getMeshletCount();
+	}
+
+	std::unique_ptr<Image> &Object::getTextureImage()
+	{
+		return textureImage;
+	}
+
+	vk::DeviceSize Object::getVertexBufferSize()
+	{
+		return static_cast<vk::DeviceSize>(vertexFormat.input.binding.stride) * model->getVertexCount();
+	}
+
+	vk::DeviceSize Object::getIndexBufferSize()
+	{
+		return static_cast<vk::DeviceSize>(model->getIndexSize()) * model->getIndexCount();
 	}
 
 	/******************************************************
 	 ******************* private **************************
 	 *****************************************************/
 
-	std::unique_ptr<Buffer> Object::createBuffer()
+	GeometryAllocation Object::createGeometry(UploadBatch &batch, GeometryPool &geometryPool)
 	{
-		vk::DeviceSize indicesSize = indices.size() * sizeof(uint32_t);
-		vk::DeviceSize verticesSize = vertices.size() * sizeof(Vertex);
-		vk::DeviceSize size = indicesSize + verticesSize;
+		auto allocation = geometryPool.allocate(model->getVertexCount(), vertexFormat.input.binding.stride,
+		                                        model->getIndexCount(), model->getIndexType());
+
+		// Cooked models hand out pointers straight into the mapped file, so staging, or the direct write
+		// into device memory, is the only copy
+		geometryPool.upload(batch, allocation, getVertexData(), model->getIndexData());
+		return allocation;
+	}
 
-		Buffer stagingBuffer = Buffer(
-			device,
-			size,
-			vk::BufferUsageFlagBits::eTransferSrc,
-			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
-		);
+	std::unique_ptr<Buffer> Object::createMeshletBuffer(UploadBatch &batch)
+	{
+		if (model->getMeshletCount() == 0) {
+			return nullptr;
+		}
 
-		stagingBuffer.load(0u, indices.data(), static_cast<size_t>(indicesSize));
-		stagingBuffer.load(indicesSize, vertices.data(), static_cast<size_t>(verticesSize));
+		vk::DeviceSize size = sizeof(ModelMeshlet) * model->getMeshletCount();
 
-		auto newBuffer = Buffer::unique(
-			device,
-			size,
-			vk::BufferUsageFlagBits::eTransferDst |
-			vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer,
-			vk::MemoryPropertyFlagBits::eDeviceLocal
-		);
+		// Transfer usage lets the defragmenter move it
+		auto newBuffer = batch.createBuffer(size, vk::BufferUsageFlagBits::eStorageBuffer |
+		                                          vk::BufferUsageFlagBits::eTransferSrc |
+		                                          vk::BufferUsageFlagBits::eTransferDst,
+		                                    MemoryCategory::Geometry);
 
-		stagingBuffer.copyToBuffer(commandPool, device->getGraphicsQueue(), newBuffer);
+		batch.copyToBuffer(model->getMeshletData(), size, newBuffer);
 		return newBuffer;
 	}
+
+	VertexFormat Object::createVertexFormat(bool packVertices)
+	{
+		if (!packVertices) {
+			return {StandardVertexLayout::describe(), SHADER_LOCATION "vert.spv", VertexDequantization::identity()};
+		}
+
+		auto dequantization = PackedVertex::pack(model->getVertexData(), model->getVertexCount(), packedVertices);
+		return {PackedVertexLayout::describe(), SHADER_LOCATION "vert-packed.spv", dequantization};
+	}
 }
\ No newline at end of file
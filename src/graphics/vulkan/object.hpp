@@ -4,47 +4,72 @@
 #include <vector>
 
 #include "vertex.hpp"
+#include "packed-vertex.hpp"
 #include "model.hpp"
 #include "image.hpp"
+#include "upload-batch.hpp"
+#include "geometry-pool.hpp"
 
 namespace Obtain::Graphics::Vulkan {
 	class Object {
 	public:
 		// Object();
-		Object(Device *device, vk::UniqueCommandPool &commandPool, const std::string &modelFile,
-		       const std::string &textureFile);
+		// With packVertices the vertices are PackedVertex instead of Vertex. Vertices and indices go into
+		// geometryPool; their uploads and the texture's are recorded into batch, the object can be drawn
+		// once the batch completes.
+		Object(Device *device, UploadBatch &batch, GeometryPool &geometryPool, const std::string &modelFile,
+		       const std::string &textureFile, bool packVertices);
 
-		static std::unique_ptr<Object> unique(Device *device, vk::UniqueCommandPool &commandPool,
-		                                      const std::string &modelFile, const std::string &textureFile);
+		static std::unique_ptr<Object> unique(Device *device, UploadBatch &batch, GeometryPool &geometryPool,
+		                                      const std::string &modelFile, const std::string &textureFile,
+		                                      bool packVertices);
 
-		std::vector<Vertex> &getVertices();
+		const void *getVertexData();
 
-		std::vector<uint32_t> &getIndices();
+		const VertexFormat &getVertexFormat();
 
-		std::unique_ptr<Image> &getTextureImage();
+		const void *getIndexData();
 
-		vk::DeviceSize getVertexBufferSize();
+		vk::IndexType getIndexType();
 
-		vk::DeviceSize getIndexBufferSize();
+		const ModelPartition *getPartitionData();
+
+		uint32_t getPartitionCount();
+
+		const ModelLod *getLodData();
+
+		uint32_t getLodCount();
 
-		vk::DeviceSize getBufferSize();
+		// Coarsest level of detail whose error projects to at most maxPixelError pixels, seen from
+		// cameraPosition in model space with pixelsPerUnit pixels per model unit at a distance of 1
+		uint32_t selectLod(const glm::vec3 &cameraPosition, float pixelsPerUnit, float maxPixelError);
 
-		vk::DeviceSize getVertexBufferOffset();
+		// Where the vertices and indices are in the geometry pool; partitions and meshlets are relative to it
+		const GeometryAllocation &getGeometry();
 
-		vk::DeviceSize getIndexBufferOffset();
+		// Storage buffer of ModelMeshlet read by the culling pass
+		std::unique_ptr<Buffer> &getMeshletBuffer();
 
-		vk::DeviceSize getBufferOffset();
+		uint32_t getMeshletCount();
+
+		std::unique_ptr<Image> &getTextureImage();
+
+		vk::DeviceSize getVertexBufferSize();
+
+		vk::DeviceSize getIndexBufferSize();
 
 	private:
 		Device *device;
 		std::unique_ptr<Model> model;
-		std::vector<Vertex> &vertices;
-		std::vector<uint32_t> &indices;
+		std::vector<PackedVertex> packedVertices;
+		VertexFormat vertexFormat;
 		std::unique_ptr<Image> textureImage;
-		vk::UniqueCommandPool &commandPool;
-		std::unique_ptr<Buffer> buffer;
+		GeometryAllocation geometry;
+		std::unique_ptr<Buffer> meshletBuffer;
 
-		std::unique_ptr<Buffer> createBuffer();
+		GeometryAllocation createGeometry(UploadBatch &batch, GeometryPool &geometryPool);
+		std::unique_ptr<Buffer> createMeshletBuffer(UploadBatch &batch);
+		VertexFormat createVertexFormat(bool packVertices);
 	};
 }
 
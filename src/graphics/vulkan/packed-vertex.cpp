@@ -0,0 +1,55 @@
+#include "packed-vertex.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Obtain::Graphics::Vulkan {
+	namespace {
+		inline uint16_t quantize(float value, float minimum, float scale)
+		{
+			float normalized = scale > 0.0f ? (value - minimum) / scale : 0.0f;
+			return static_cast<uint16_t>(std::lround(std::min(std::max(normalized, 0.0f), 1.0f) * 65535.0f));
+		}
+	}
+
+	VertexDequantization PackedVertex::pack(const Vertex *vertices, size_t count, std::vector<PackedVertex> &packed)
+	{
+		float minimum[5], maximum[5]; // x, y, z, u, v
+		for (int axis = 0; axis < 5; axis++) {
+			minimum[axis] = count == 0 ? 0.0f : std::numeric_limits<float>::max();
+			maximum[axis] = count == 0 ? 0.0f : std::numeric_limits<float>::lowest();
+		}
+
+		for (size_t i = 0; i < count; i++) {
+			const float values[5] = {vertices[i].pos.x, vertices[i].pos.y, vertices[i].pos.z,
+			                         vertices[i].texCoord.x, vertices[i].texCoord.y};
+			for (int axis = 0; axis < 5; axis++) {
+				minimum[axis] = std::min(minimum[axis], values[axis]);
+				maximum[axis] = std::max(maximum[axis], values[axis]);
+			}
+		}
+
+		float scale[5];
+		for (int axis = 0; axis < 5; axis++) {
+			scale[axis] = maximum[axis] - minimum[axis];
+		}
+
+		packed.resize(count);
+		for (size_t i = 0; i < count; i++) {
+			const Vertex &vertex = vertices[i];
+			packed[i].pos.value[0] = quantize(vertex.pos.x, minimum[0], scale[0]);
+			packed[i].pos.value[1] = quantize(vertex.pos.y, minimum[1], scale[1]);
+			packed[i].pos.value[2] = quantize(vertex.pos.z, minimum[2], scale[2]);
+			packed[i].pos.value[3] = 65535u;
+			packed[i].texCoord.value[0] = quantize(vertex.texCoord.x, minimum[3], scale[3]);
+			packed[i].texCoord.value[1] = quantize(vertex.texCoord.y, minimum[4], scale[4]);
+		}
+
+		VertexDequantization dequantization = {};
+		dequantization.positionScale = glm::vec4(scale[0], scale[1], scale[2], 1.0f);
+		dequantization.positionOffset = glm::vec4(minimum[0], minimum[1], minimum[2], 0.0f);
+		dequantization.texCoordTransform = glm::vec4(scale[3], scale[4], minimum[3], minimum[4]);
+		return dequantization;
+	}
+}
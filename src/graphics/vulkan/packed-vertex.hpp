@@ -0,0 +1,29 @@
+#ifndef OBTAIN_GRAPHICS_VULKAN_PACKED_VERTEX_HPP
+#define OBTAIN_GRAPHICS_VULKAN_PACKED_VERTEX_HPP
+
+#include <vector>
+
+#include "vertex.hpp"
+#include "vertex-layout.hpp"
+
+namespace Obtain::Graphics::Vulkan {
+	/*
+	 * 12 byte vertex for meshes that do not need the per vertex color Model always sets to white.
+	 * Positions and texture coordinates are normalized to the bounds of the mesh and stored as 16 bit
+	 * unorms; the vertex shader scales them back with the VertexDequantization that packing returns.
+	 */
+	struct PackedVertex {
+		Unorm16x4 pos;      // xyz relative to the mesh bounds, w is always 1
+		Unorm16x2 texCoord; // relative to the texture coordinate bounds
+
+		static VertexDequantization pack(const Vertex *vertices, size_t count, std::vector<PackedVertex> &packed);
+	};
+
+	static_assert(sizeof(PackedVertex) == 12, "PackedVertex must not contain padding");
+
+	using PackedVertexLayout = VertexLayout<PackedVertex,
+		VertexAttribute<0, Unorm16x4, offsetof(PackedVertex, pos)>,
+		VertexAttribute<2, Unorm16x2, offsetof(PackedVertex, texCoord)>>;
+}
+
+#endif // OBTAIN_GRAPHICS_VULKAN_PACKED_VERTEX_HPP
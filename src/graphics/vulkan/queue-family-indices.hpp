@@ -7,6 +7,9 @@ namespace Obtain::Graphics::Vulkan {
 	struct QueueFamilyIndices {
 		std::optional<uint32_t> graphicsFamily;
 		std::optional<uint32_t> presentFamily;
+		// A family with transfer but neither graphics nor compute, usually backed by the copy engines
+		// and so able to upload while the graphics queue renders; empty when the device has none
+		std::optional<uint32_t> transferFamily;
 
 		bool isComplete()
 		{
@@ -0,0 +1,75 @@
+#include "range-allocator.hpp"
+
+#include <algorithm>
+
+namespace Obtain::Graphics::Vulkan {
+	RangeAllocator::RangeAllocator(vk::DeviceSize capacity)
+		: capacity(capacity), usedBytes(0u)
+	{
+		if (capacity > 0u) {
+			freeRanges.emplace(0u, capacity);
+		}
+	}
+
+	vk::DeviceSize RangeAllocator::allocate(vk::DeviceSize size, vk::DeviceSize alignment)
+	{
+		for (auto range = freeRanges.begin(); range != freeRanges.end(); ++range) {
+			vk::DeviceSize offset = (range->first + alignment - 1u) / alignment * alignment;
+			vk::DeviceSize end = range->first + range->second;
+			if (offset + size > end) {
+				continue;
+			}
+
+			// Whatever is left on either side stays free
+			vk::DeviceSize start = range->first;
+			freeRanges.erase(range);
+			if (offset > start) {
+				freeRanges.emplace(start, offset - start);
+			}
+			if (offset + size < end) {
+				freeRanges.emplace(offset + size, end - offset - size);
+			}
+			usedBytes += size;
+			return offset;
+		}
+		return NoSpace;
+	}
+
+	void RangeAllocator::free(vk::DeviceSize offset, vk::DeviceSize size)
+	{
+		usedBytes -= size;
+
+		auto next = freeRanges.lower_bound(offset);
+		if (next != freeRanges.end() && offset + size == next->first) {
+			size += next->second;
+			next = freeRanges.erase(next);
+		}
+		if (next != freeRanges.begin()) {
+			auto previous = std::prev(next);
+			if (previous->first + previous->second == offset) {
+				previous->second += size;
+				return;
+			}
+		}
+		freeRanges.emplace_hint(next, offset, size);
+	}
+
+	vk::DeviceSize RangeAllocator::getCapacity()
+	{
+		return capacity;
+	}
+
+	vk::DeviceSize RangeAllocator::getUsedBytes()
+	{
+		return usedBytes;
+	}
+
+	vk::DeviceSize RangeAllocator::getLargestFreeRange()
+	{
+		vk::DeviceSize largest = 0u;
+		for (const auto &range : freeRanges) {
+			largest = std::max(largest, range.second);
+		}
+		return largest;
+	}
+}
@@ -0,0 +1,39 @@
+#ifndef OBTAIN_GRAPHICS_VULKAN_RANGE_ALLOCATOR_HPP
+#define OBTAIN_GRAPHICS_VULKAN_RANGE_ALLOCATOR_HPP
+
+#include <limits>
+#include <map>
+#include <vulkan/vulkan.hpp>
+
+namespace Obtain::Graphics::Vulkan {
+	/*
+	 * Hands out ranges of [0, capacity) first fit from a free list sorted by offset and merges freed
+	 * ranges with their free neighbours. Meant for a modest number of long-lived ranges, like the
+	 * meshes in a geometry pool; alignments don't have to be powers of two, so ranges can be aligned
+	 * to a vertex stride.
+	 */
+	class RangeAllocator {
+	public:
+		static constexpr vk::DeviceSize NoSpace = std::numeric_limits<vk::DeviceSize>::max();
+
+		explicit RangeAllocator(vk::DeviceSize capacity);
+
+		// Offset of the new range, NoSpace if no free range fits
+		vk::DeviceSize allocate(vk::DeviceSize size, vk::DeviceSize alignment);
+
+		void free(vk::DeviceSize offset, vk::DeviceSize size);
+
+		vk::DeviceSize getCapacity();
+
+		vk::DeviceSize getUsedBytes();
+
+		vk::DeviceSize getLargestFreeRange();
+
+	private:
+		vk::DeviceSize capacity;
+		vk::DeviceSize usedBytes;
+		std::map<vk::DeviceSize, vk::DeviceSize> freeRanges; // offset to size
+	};
+}
+
+#endif // OBTAIN_GRAPHICS_VULKAN_RANGE_ALLOCATOR_HPP
@@ -0,0 +1,63 @@
+#include "ring-allocator.hpp"
+
+namespace Obtain::Graphics::Vulkan {
+	RingAllocator::RingAllocator(vk::DeviceSize capacity)
+		: capacity(capacity), head(0u), tail(0u), used(0u), open(0u)
+	{}
+
+	vk::DeviceSize RingAllocator::allocate(vk::DeviceSize size, vk::DeviceSize alignment)
+	{
+		if (used == 0u) {
+			head = 0u;
+			tail = 0u;
+		}
+
+		vk::DeviceSize offset = (head + alignment - 1u) / alignment * alignment;
+		if (head >= tail && used < capacity) {
+			// Free space is [head, capacity) and [0, tail), wrapping skips whatever is left at the end
+			if (offset + size > capacity) {
+				if (size > tail) {
+					return NoSpace;
+				}
+				offset = 0u;
+			}
+		} else if (offset + size > tail) {
+			return NoSpace;
+		}
+
+		vk::DeviceSize end = offset + size;
+		vk::DeviceSize consumed = end > head ? end - head : capacity - head + end;
+		used += consumed;
+		open += consumed;
+		head = end;
+		return offset;
+	}
+
+	bool RingAllocator::hasOpen()
+	{
+		return open > 0u;
+	}
+
+	RingSection RingAllocator::close()
+	{
+		RingSection section = {head, open};
+		open = 0u;
+		return section;
+	}
+
+	void RingAllocator::release(const RingSection &section)
+	{
+		tail = section.end;
+		used -= section.bytes;
+	}
+
+	vk::DeviceSize RingAllocator::getCapacity()
+	{
+		return capacity;
+	}
+
+	vk::DeviceSize RingAllocator::getUsedBytes()
+	{
+		return used;
+	}
+}
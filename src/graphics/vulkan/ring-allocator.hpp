@@ -0,0 +1,50 @@
+#ifndef OBTAIN_GRAPHICS_VULKAN_RING_ALLOCATOR_HPP
+#define OBTAIN_GRAPHICS_VULKAN_RING_ALLOCATOR_HPP
+
+#include <limits>
+#include <vulkan/vulkan.hpp>
+
+namespace Obtain::Graphics::Vulkan {
+	// Space handed out between two calls to close, which is given back as a whole
+	struct RingSection {
+		vk::DeviceSize end; // head when closed, the tail once released
+		vk::DeviceSize bytes; // including space skipped when wrapping
+	};
+
+	/*
+	 * Hands out space of [0, capacity) in order, wrapping around to the start when what's left at the
+	 * end doesn't fit. Space comes back in sections, released in the order they were closed; once all
+	 * of it is free the ring starts over at 0.
+	 */
+	class RingAllocator {
+	public:
+		static constexpr vk::DeviceSize NoSpace = std::numeric_limits<vk::DeviceSize>::max();
+
+		explicit RingAllocator(vk::DeviceSize capacity);
+
+		// Offset of the new range, NoSpace if the free space can't take it yet
+		vk::DeviceSize allocate(vk::DeviceSize size, vk::DeviceSize alignment);
+
+		// True if space was handed out since the last close
+		bool hasOpen();
+
+		// Ends the section of everything handed out since the last close
+		RingSection close();
+
+		// Frees section, which has to be the oldest one not released yet
+		void release(const RingSection &section);
+
+		vk::DeviceSize getCapacity();
+
+		vk::DeviceSize getUsedBytes();
+
+	private:
+		vk::DeviceSize capacity;
+		vk::DeviceSize head; // next free byte
+		vk::DeviceSize tail; // oldest byte still in use
+		vk::DeviceSize used;
+		vk::DeviceSize open; // handed out since the last close
+	};
+}
+
+#endif // OBTAIN_GRAPHICS_VULKAN_RING_ALLOCATOR_HPP
@@ -0,0 +1,117 @@
+#include "staging-ring.hpp"
+
+#include <cstring>
+
+namespace Obtain::Graphics::Vulkan {
+	StagingRing::StagingRing(Device *device, vk::DeviceSize size)
+		: device(device), timeline(device->getTransferTimeline()), space(size), commandBufferCount(0u), submitted(0u)
+	{
+		commandPool = device->createTransferCommandPool(vk::CommandPoolCreateFlagBits::eResetCommandBuffer);
+		buffer = Buffer::unique(device,
+		                        size,
+		                        vk::BufferUsageFlagBits::eTransferSrc,
+		                        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+		                        MemoryCategory::Staging);
+	}
+
+	StagingRing::~StagingRing()
+	{
+		// The GPU may still be reading from the buffer
+		wait(submitted);
+	}
+
+	std::unique_ptr<StagingRing> StagingRing::unique(Device *device, vk::DeviceSize size)
+	{
+		return std::make_unique<StagingRing>(device, size);
+	}
+
+	vk::DeviceSize StagingRing::getMaxAllocation()
+	{
+		return space.getCapacity() / 4u;
+	}
+
+	bool StagingRing::tryStage(const void *data, vk::DeviceSize dataSize, vk::DeviceSize alignment,
+	                           StagedRange &range)
+	{
+		retireCompleted();
+		vk::DeviceSize offset = space.allocate(dataSize, alignment);
+		if (offset == RingAllocator::NoSpace) {
+			return false;
+		}
+
+		memcpy(static_cast<char *>(buffer->getMappedData()) + offset, data, static_cast<size_t>(dataSize));
+		range = {*(buffer->getBuffer()), buffer->getOffset() + offset};
+		return true;
+	}
+
+	bool StagingRing::hasUnsubmitted()
+	{
+		return space.hasOpen();
+	}
+
+	vk::UniqueCommandBuffer StagingRing::acquireCommandBuffer()
+	{
+		retireCompleted();
+		if (freeCommandBuffers.empty()) {
+			commandBufferCount++;
+			auto allocated = device->allocateCommandBuffers(commandPool, vk::CommandBufferLevel::ePrimary, 1u);
+			return std::move(allocated[0]);
+		}
+
+		vk::UniqueCommandBuffer commandBuffer = std::move(freeCommandBuffers.back());
+		freeCommandBuffers.pop_back();
+		commandBuffer->reset(vk::CommandBufferResetFlags());
+		return commandBuffer;
+	}
+
+	uint64_t StagingRing::submit(vk::UniqueCommandBuffer commandBuffer)
+	{
+		submitted = timeline.submit(*commandBuffer);
+		inFlight.push_back({submitted, space.close(), std::move(commandBuffer)});
+		return submitted;
+	}
+
+	uint32_t StagingRing::getCommandBufferCount()
+	{
+		return commandBufferCount;
+	}
+
+	void StagingRing::waitOldest()
+	{
+		if (!inFlight.empty()) {
+			timeline.wait(inFlight.front().value);
+			retire();
+		}
+	}
+
+	void StagingRing::wait(uint64_t submission)
+	{
+		timeline.wait(submission);
+		retireCompleted();
+	}
+
+	bool StagingRing::isComplete(uint64_t submission)
+	{
+		retireCompleted();
+		return timeline.isComplete(submission);
+	}
+
+	/******************************************
+	 ***************** private *****************
+	 ******************************************/
+
+	// Frees the space and command buffer of the oldest submission, which must have completed
+	void StagingRing::retire()
+	{
+		space.release(inFlight.front().section);
+		freeCommandBuffers.push_back(std::move(inFlight.front().commandBuffer));
+		inFlight.pop_front();
+	}
+
+	void StagingRing::retireCompleted()
+	{
+		while (!inFlight.empty() && timeline.isComplete(inFlight.front().value)) {
+			retire();
+		}
+	}
+}
@@ -0,0 +1,85 @@
+#ifndef OBTAIN_GRAPHICS_VULKAN_STAGING_RING_HPP
+#define OBTAIN_GRAPHICS_VULKAN_STAGING_RING_HPP
+
+#include <deque>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "device.hpp"
+#include "buffer.hpp"
+#include "ring-allocator.hpp"
+
+namespace Obtain::Graphics::Vulkan {
+	// Where staged data ended up, valid until the submission reading it completes
+	struct StagedRange {
+		vk::Buffer buffer;
+		vk::DeviceSize offset;
+	};
+
+	/*
+	 * A fixed size, persistently mapped staging buffer shared by all uploads. Space is handed out by a
+	 * RingAllocator; every submit takes ownership of what was handed out since the previous one, and
+	 * that space comes back once the transfer timeline reaches the submit's value. Submissions complete in order, so waiting for one means waiting for all before it. Host
+	 * memory for staging is bounded by the ring size and streaming allocates nothing in steady state:
+	 * the command buffers of submissions are recycled along with their space.
+	 */
+	class StagingRing {
+	public:
+		StagingRing(Device *device, vk::DeviceSize size);
+
+		~StagingRing();
+
+		static std::unique_ptr<StagingRing> unique(Device *device, vk::DeviceSize size);
+
+		// Upper bound for one allocation, larger uploads have to be split; a quarter of the ring so
+		// that copying one chunk can overlap with staging the next
+		vk::DeviceSize getMaxAllocation();
+
+		// Copies data into the ring, or returns false when the free space can't take it yet
+		bool tryStage(const void *data, vk::DeviceSize size, vk::DeviceSize alignment, StagedRange &range);
+
+		// True if space was staged since the last submit, which only a submit can give back
+		bool hasUnsubmitted();
+
+		// A primary for the transfer queue, not begun yet; one of a completed submission when there is one
+		vk::UniqueCommandBuffer acquireCommandBuffer();
+
+		// Submits commandBuffer, which must only read ranges staged since the last submit, to the
+		// transfer queue and returns its value on the device's transfer timeline. The ring keeps the
+		// command buffer until the submission completes and hands it out again then.
+		uint64_t submit(vk::UniqueCommandBuffer commandBuffer);
+
+		// Command buffers allocated since creation, stays flat once enough are in circulation
+		uint32_t getCommandBufferCount();
+
+		// Blocks until the oldest submission in flight completes and its space is free again
+		void waitOldest();
+
+		void wait(uint64_t submission);
+
+		bool isComplete(uint64_t submission);
+
+	private:
+		struct Submission {
+			uint64_t value;
+			RingSection section;
+			vk::UniqueCommandBuffer commandBuffer;
+		};
+
+		Device *device;
+		GpuTimeline &timeline;
+		std::unique_ptr<Buffer> buffer;
+		RingAllocator space;
+		vk::UniqueCommandPool commandPool; // declared before the buffers so they are freed before it's destroyed
+		std::deque<Submission> inFlight;
+		std::vector<vk::UniqueCommandBuffer> freeCommandBuffers;
+		uint32_t commandBufferCount;
+		uint64_t submitted; // value of the latest submit
+
+		void retire();
+		void retireCompleted();
+	};
+}
+
+#endif // OBTAIN_GRAPHICS_VULKAN_STAGING_RING_HPP
@@ -1,5 +1,11 @@
 #include "swapchain.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #define GLM_FORCE_RADIANS
 
@@ -11,7 +17,6 @@
 #include "queue-family-indices.hpp"
 #include "vertex.hpp"
 #include "uniform-buffer-object.hpp"
-#include "../../utils/time.hpp"
 
 namespace Obtain::Graphics::Vulkan {
 
@@ -23,14 +28,17 @@ namespace Obtain::Graphics::Vulkan {
 		std::array<uint32_t, 2> windowSize,
 		QueueFamilyIndices indices,
 		vk::UniqueCommandPool &commandPool,
-		std::unique_ptr<Buffer> &vertexBuffer,
-		std::unique_ptr<Buffer> &indexBuffer,
-		std::unique_ptr<Image> &textureImage,
+		CommandBufferManager &commandBuffers,
+		WorkerPool &workers,
+		std::unique_ptr<GeometryPool> &geometryPool,
+		std::vector<std::unique_ptr<Object>> &meshes,
+		std::vector<Image *> &materials,
 		vk::UniqueSampler &sampler
 	)
 		:
-		device(device), commandPool(commandPool), vertexBuffer(vertexBuffer), indexBuffer(indexBuffer),
-		textureImage(textureImage), sampler(sampler)
+		device(device), commandPool(commandPool), commandBuffers(commandBuffers), workers(workers),
+		recordingThreads(workers.getThreadCount()), geometryPool(geometryPool),
+		meshes(meshes), materials(materials), sampler(sampler)
 	{
 		auto swapchainSupport = device->querySwapchainSupport();
 
@@ -55,19 +63,36 @@ namespace Obtain::Graphics::Vulkan {
 		                                          depthImage->getView(), renderPass,
 		                                          extent);
 		createUniformBuffers();
-		descriptorPool = device->createDescriptorPool(static_cast<uint32_t>(images.size()));
-		descriptorSets = device->createDescriptorSets(static_cast<uint32_t>(images.size()),
-		                                              descriptorSetLayout,
-		                                              descriptorPool,
-		                                              sampler,
-		                                              textureImage->getView(),
-		                                              uniformBuffers);
+		for (auto &mesh : meshes) {
+			if (mesh->getMeshletBuffer()) {
+				createCullPipeline();
+				break;
+			}
+		}
+		if (LogStatistics && device->supportsPipelineStatistics()) {
+			statisticFlags = vk::QueryPipelineStatisticFlagBits::eVertexShaderInvocations |
+			                 vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations;
+			statisticsQueryPool = device->createQueryPool(vk::QueryType::ePipelineStatistics,
+			                                              static_cast<uint32_t>(images.size()),
+			                                              statisticFlags);
+		}
+		// Dynamic offsets select the uniforms, so one set per material serves every image and draw
+		descriptorPool = device->createDescriptorPool(static_cast<uint32_t>(materials.size()));
+		for (auto material : materials) {
+			auto materialSets = device->createDescriptorSets(1u,
+			                                                 descriptorSetLayout,
+			                                                 descriptorPool,
+			                                                 sampler,
+			                                                 material->getView(),
+			                                                 uniformRing->getDescriptorInfo());
+			descriptorSets.push_back(std::move(materialSets[0]));
+		}
 		createCommandBuffers();
 
 		for (size_t i = 0; i < MaxFramesInFlight; i++) {
 			imageReady[i] = device->createSemaphore();
 			renderFinished[i] = device->createSemaphore();
-			outOfFlight[i] = device->createFence(true);
+			frameImages[i] = NoImage;
 		}
 	}
 
@@ -78,33 +103,52 @@ namespace Obtain::Graphics::Vulkan {
 	}
 
 	bool Swapchain::submitFrame(
-		vk::Queue &graphicsQueue,
-		vk::Queue &presentationQueue
+		vk::Queue &presentationQueue,
+		const DrawList &drawList,
+		vk::ArrayProxy<const GpuWait> waits
 	)
 	{
-		device->waitForFence(outOfFlight[currentFrame]);
-		device->resetFence(outOfFlight[currentFrame]);
+		GpuTimeline &timeline = device->getGraphicsTimeline();
+		timeline.wait(frameSubmissions[currentFrame]);
+		readStatistics();
 		uint32_t imageIndex;
 		try {
 			imageIndex = device->nextImage(swapchain, imageReady[currentFrame]);
 		} catch (vk::OutOfDateKHRError &error) {
 			return false;
 		}
+		// The image's uniforms, query, secondaries and cull descriptor sets may still be in use by the other
+		// frame in flight
+		for (size_t frame = 0; frame < MaxFramesInFlight; frame++) {
+			if (frame != currentFrame && frameImages[frame] == imageIndex) {
+				timeline.wait(frameSubmissions[frame]);
+			}
+		}
 
-		updateUniformBuffer(imageIndex);
+		auto uniformStart = std::chrono::high_resolution_clock::now();
+		updateUniformBuffer(imageIndex, drawList);
+		recordFrameTime(uniformStart);
 
-		vk::PipelineStageFlags waitStages[] = {vk::PipelineStageFlagBits::eColorAttachmentOutput};
-		vk::SubmitInfo submitInfo(
-			1,
-			&imageReady[currentFrame].get(),
-			waitStages,
-			1,
-			&commandBuffers[imageIndex].get(),
-			1,
-			&renderFinished[currentFrame].get()
-		);
+		// Only a draw list that draws something else than last time, or buffers being moved, costs recording
+		// the secondaries again; the primary is cheap and recorded every frame
+		if (staleImages[imageIndex] || frameDraws != recordedDraws[imageIndex]) {
+			refreshCommandBuffer(imageIndex);
+		}
+		vk::CommandBuffer commandBuffer = recordFrame(imageIndex);
 
-		graphicsQueue.submit(1, &submitInfo, *outOfFlight[currentFrame]);
+		std::array<GpuWait, GpuTimeline::MaxWaits> frameWaits;
+		if (waits.size() >= GpuTimeline::MaxWaits) {
+			throw std::logic_error("frame waits on more semaphores than a timeline submit takes");
+		}
+		frameWaits[0] = {*imageReady[currentFrame], 0u, vk::PipelineStageFlagBits::eColorAttachmentOutput};
+		std::copy(waits.begin(), waits.end(), frameWaits.begin() + 1);
+
+		frameSubmissions[currentFrame] = timeline.submit(
+			commandBuffer,
+			vk::ArrayProxy<const GpuWait>(waits.size() + 1u, frameWaits.data()),
+			*renderFinished[currentFrame]
+		);
+		frameImages[currentFrame] = imageIndex;
 
 		vk::Result result;
 		try {
@@ -127,6 +171,56 @@ namespace Obtain::Graphics::Vulkan {
 		return result == vk::Result::eSuccess;
 	}
 
+	void Swapchain::benchmarkRecording(const DrawList &drawList, uint32_t repetitions)
+	{
+		device->waitIdle();
+		uint32_t configuredThreads = recordingThreads;
+		uint32_t maxThreads = workers.getThreadCount();
+		double singleThreadTime = 0.0;
+
+		for (uint32_t threads = 1;; threads = std::min(threads * 2, maxThreads)) {
+			recordingThreads = threads;
+			auto start = std::chrono::high_resolution_clock::now();
+			for (uint32_t repetition = 0; repetition < repetitions; repetition++) {
+				for (uint32_t i = 0; i < images.size(); i++) {
+					updateUniformBuffer(i, drawList);
+					refreshCommandBuffer(i);
+				}
+			}
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+			double imageTime = elapsed.count() / (repetitions * images.size());
+			if (threads == 1) {
+				singleThreadTime = imageTime;
+			}
+
+			uint32_t drawCount = frameDraws.empty() ? 0u : frameDraws.back().firstDraw + frameDraws.back().drawCount;
+			std::cout << "recording " << drawCount << " draws of " << frameDraws.size() << " items with " << threads
+			          << " threads in " << secondaryCounts[0] << " slices: " << imageTime << " ms per image, "
+			          << singleThreadTime / imageTime << "x single thread" << std::endl;
+			if (threads == maxThreads) {
+				break;
+			}
+		}
+
+		recordingThreads = configuredThreads;
+	}
+
+	vk::PipelineStageFlags Swapchain::getSceneReadStages()
+	{
+		return vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eDrawIndirect |
+		       vk::PipelineStageFlagBits::eVertexInput | vk::PipelineStageFlagBits::eFragmentShader;
+	}
+
+	void Swapchain::invalidateCommandBuffers()
+	{
+		staleImages.assign(images.size(), true);
+	}
+
+	bool Swapchain::hasStaleCommandBuffers()
+	{
+		return std::find(staleImages.begin(), staleImages.end(), true) != staleImages.end();
+	}
+
 	/******************************************
 	 ***************** private *****************
 	 ******************************************/
@@ -201,65 +295,189 @@ namespace Obtain::Graphics::Vulkan {
 
 	void Swapchain::createCommandBuffers()
 	{
-		commandBuffers = device->allocateCommandBuffers(commandPool,
-		                                                vk::CommandBufferLevel::ePrimary,
-		                                                static_cast<uint32_t>(framebuffers.size()));
+		// Nothing is recorded until each image is first drawn
+		staleImages.assign(images.size(), true);
+		recordedDraws.resize(images.size());
+		secondaryCounts.assign(images.size(), 0u);
+
+		secondaryCommandBuffers.resize(images.size());
+		for (auto &secondaries : secondaryCommandBuffers) {
+			secondaries.resize(workers.getThreadCount());
+		}
+		executedSecondaries.reserve(workers.getThreadCount());
+	}
+
+	// Culls and executes the secondaries recorded for the image, with the uniforms of frameDraws
+	vk::CommandBuffer Swapchain::recordFrame(uint32_t image)
+	{
+		vk::CommandBuffer commandBuffer = commandBuffers.getPrimary();
+		commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit, nullptr));
 
-		for (size_t i = 0; i < commandBuffers.size(); i++) {
-			auto &commandBuffer = commandBuffers[i];
+		std::array<vk::ClearValue, 2> clearValues = {
+			vk::ClearValue(vk::ClearColorValue(std::array<float, 4>{0.0f, 0.0f, 0.0f, 1.0f})),
+			vk::ClearValue(vk::ClearDepthStencilValue(1.0f, 0))
+		};
 
-			commandBuffer->begin(
-				vk::CommandBufferBeginInfo(
-					vk::CommandBufferUsageFlagBits::eSimultaneousUse,
-					nullptr
-				)
-			);
+		if (statisticsQueryPool) {
+			commandBuffer.resetQueryPool(*statisticsQueryPool, image, 1);
+		}
 
-			std::array<vk::ClearValue, 2> clearValues = {
-				vk::ClearValue(vk::ClearColorValue(std::array<float, 4>{0.0f, 0.0f, 0.0f, 1.0f})),
-				vk::ClearValue(vk::ClearDepthStencilValue(1.0f, 0))
-			};
+		if (frameCommandCount > 0u) {
+			commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, *cullPipeline);
+			for (const RecordedDraw &draw : frameDraws) {
+				if (!isCulled(draw.mesh)) {
+					continue;
+				}
+				commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
+				                                 *cullPipelineLayout,
+				                                 0,
+				                                 1,
+				                                 &cullDescriptorSets[image * meshes.size() + draw.mesh].get(),
+				                                 1,
+				                                 &draw.uniformOffset);
+				commandBuffer.dispatch((meshes[draw.mesh]->getMeshletCount() + CullGroupSize - 1) / CullGroupSize, 1,
+				                       1);
+			}
 
-			commandBuffer->beginRenderPass(
-				vk::RenderPassBeginInfo(
-					*renderPass,
-					*(framebuffers[i]),
-					vk::Rect2D(
-						{0, 0},
-						extent
-					),
-					clearValues.size(),
-					clearValues.data()
+			vk::BufferMemoryBarrier barrier(vk::AccessFlagBits::eShaderWrite,
+			                                vk::AccessFlagBits::eIndirectCommandRead,
+			                                VK_QUEUE_FAMILY_IGNORED,
+			                                VK_QUEUE_FAMILY_IGNORED,
+			                                *(indirectBuffers[image]->getBuffer()),
+			                                indirectBuffers[image]->getOffset(),
+			                                indirectBuffers[image]->getSize());
+			commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+			                              vk::PipelineStageFlagBits::eDrawIndirect,
+			                              vk::DependencyFlags(),
+			                              0, nullptr,
+			                              1, &barrier,
+			                              0, nullptr);
+		}
+
+		commandBuffer.beginRenderPass(
+			vk::RenderPassBeginInfo(
+				*renderPass,
+				*(framebuffers[image]),
+				vk::Rect2D(
+					{0, 0},
+					extent
 				),
-				vk::SubpassContents::eInline
-			);
+				clearValues.size(),
+				clearValues.data()
+			),
+			vk::SubpassContents::eSecondaryCommandBuffers
+		);
 
-			commandBuffer->bindPipeline(vk::PipelineBindPoint::eGraphics, *pipeline);
-			vk::Buffer vertexBuffers[] = {*(vertexBuffer->getBuffer())};
-			vk::DeviceSize offsets[] = {vertexBuffer->getOffset()};
-			commandBuffer->bindVertexBuffers(0, 1, vertexBuffers, offsets);
-			commandBuffer->bindIndexBuffer(*(indexBuffer->getBuffer()),
-			                               indexBuffer->getOffset(),
-			                               vk::IndexType::eUint32);
-			commandBuffers[i]->bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
-			                                      *pipelineLayout,
-			                                      0,
-			                                      1,
-			                                      &descriptorSets[i].get(),
-			                                      0,
-			                                      nullptr);
-			commandBuffer->drawIndexed(static_cast<uint32_t>(indexBuffer->getSize() / sizeof(uint32_t)),
-			                           1, 0, 0, 0);
-			commandBuffer->endRenderPass();
-			commandBuffer->end();
+		if (statisticsQueryPool) {
+			commandBuffer.beginQuery(*statisticsQueryPool, image, vk::QueryControlFlags());
 		}
+		executedSecondaries.clear();
+		for (uint32_t slice = 0; slice < secondaryCounts[image]; slice++) {
+			executedSecondaries.push_back(*secondaryCommandBuffers[image][slice]);
+		}
+		if (!executedSecondaries.empty()) {
+			commandBuffer.executeCommands(executedSecondaries);
+		}
+		if (statisticsQueryPool) {
+			commandBuffer.endQuery(*statisticsQueryPool, image);
+		}
+		commandBuffer.endRenderPass();
+		commandBuffer.end();
+		return commandBuffer;
+	}
+
+	// Records frameDraws into the image's secondaries, split in slices across the worker threads
+	void Swapchain::recordSecondaries(uint32_t image)
+	{
+		uint32_t drawCount = frameDraws.empty() ? 0u : frameDraws.back().firstDraw + frameDraws.back().drawCount;
+		uint32_t sliceCount = drawCount == 0u ? 0u : std::max(1u, std::min({drawCount / MinDrawsPerThread,
+		                                                                    recordingThreads,
+		                                                                    workers.getThreadCount()}));
+		workers.run(sliceCount, [this, image, sliceCount](uint32_t slice) {
+			recordSecondary(image, slice, sliceCount);
+		});
+		secondaryCounts[image] = sliceCount;
+	}
+
+	// Runs on worker thread slice and records the slice's share of the draws
+	void Swapchain::recordSecondary(uint32_t image, uint32_t slice, uint32_t sliceCount)
+	{
+		auto &commandBuffer = secondaryCommandBuffers[image][slice];
+		// Slice n is always recorded on thread n, which allocates from its own pool
+		if (!commandBuffer) {
+			commandBuffer = commandBuffers.allocateSecondary(slice);
+		}
+
+		// Statistics are queried around the secondaries, which inherit the query
+		vk::CommandBufferInheritanceInfo inheritance(*renderPass,
+		                                             0,
+		                                             *(framebuffers[image]),
+		                                             VK_FALSE,
+		                                             vk::QueryControlFlags(),
+		                                             statisticsQueryPool ? statisticFlags
+		                                                                 : vk::QueryPipelineStatisticFlags());
+		commandBuffer->begin(
+			vk::CommandBufferBeginInfo(
+				vk::CommandBufferUsageFlagBits::eRenderPassContinue |
+				vk::CommandBufferUsageFlagBits::eSimultaneousUse,
+				&inheritance
+			)
+		);
+
+		commandBuffer->bindPipeline(vk::PipelineBindPoint::eGraphics, *pipeline);
+
+		uint32_t drawCount = frameDraws.back().firstDraw + frameDraws.back().drawCount;
+		uint32_t first = static_cast<uint32_t>(static_cast<uint64_t>(drawCount) * slice / sliceCount);
+		uint32_t end = static_cast<uint32_t>(static_cast<uint64_t>(drawCount) * (slice + 1) / sliceCount);
+		auto draw = std::upper_bound(frameDraws.begin(), frameDraws.end(), first,
+		                             [](uint32_t value, const RecordedDraw &draw) {
+			                             return value < draw.firstDraw;
+		                             }) - 1;
+
+		// Items are sorted by material and then mesh, so the index type rarely changes between them
+		bool bound = false;
+		vk::IndexType indexType = vk::IndexType::eUint32;
+		for (; draw != frameDraws.end() && draw->firstDraw < end; ++draw) {
+			Object &mesh = *meshes[draw->mesh];
+			if (!bound || mesh.getIndexType() != indexType) {
+				indexType = mesh.getIndexType();
+				geometryPool->bind(*commandBuffer, indexType);
+				bound = true;
+			}
+			commandBuffer->bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+			                                  *pipelineLayout,
+			                                  0,
+			                                  1,
+			                                  &descriptorSets[draw->material].get(),
+			                                  1,
+			                                  &draw->uniformOffset);
+
+			uint32_t itemFirst = std::max(first, draw->firstDraw) - draw->firstDraw;
+			uint32_t itemEnd = std::min(end, draw->firstDraw + draw->drawCount) - draw->firstDraw;
+			recordDraws(*commandBuffer, image, *draw, itemFirst, itemEnd - itemFirst);
+		}
+		commandBuffer->end();
+	}
+
+	void Swapchain::refreshCommandBuffer(uint32_t image)
+	{
+		// Sets are rewritten whenever there is a buffer they refer to, even for a list that doesn't cull, so
+		// they never keep referring to moved meshlets
+		bool replaced = frameCommandCount > 0u && reserveIndirectCommands(image, frameCommandCount);
+		if (cullPipeline && indirectBuffers[image] && (replaced || staleImages[image])) {
+			writeCullDescriptorSets(image);
+		}
+		// The pools reset single command buffers, the image's are recorded again in place
+		recordSecondaries(image);
+		recordedDraws[image] = frameDraws;
+		staleImages[image] = false;
 	}
 
 	void Swapchain::createPipeline()
 	{
 		Shader *vertShader = new Shader(
 			device,
-			"assets/shaders/vert.spv",
+			meshes[0]->getVertexFormat().vertexShader,
 			vk::ShaderStageFlagBits::eVertex
 		);
 		Shader *fragShader = new Shader(
@@ -274,43 +492,316 @@ namespace Obtain::Graphics::Vulkan {
 		};
 
 		pipeline = device->createGraphicsPipeline(extent, pipelineLayout, renderPass,
-		                                          shaderCreateInfos);
+		                                          shaderCreateInfos, meshes[0]->getVertexFormat().input);
 
 		delete (vertShader);
 		delete (fragShader);
 	}
 
+	// Without culling a draw is a partition of the level of detail, with culling an indirect draw of up to
+	// getMaxDrawIndirectCount meshlets
+	uint32_t Swapchain::getDrawCount(uint32_t mesh, uint32_t lod)
+	{
+		Object &object = *meshes[mesh];
+		if (!isCulled(mesh)) {
+			return object.getLodData()[lod].partitionCount;
+		}
+		uint32_t maxDrawCount = device->getMaxDrawIndirectCount();
+		return object.getMeshletCount() / maxDrawCount + (object.getMeshletCount() % maxDrawCount != 0u ? 1u : 0u);
+	}
+
+	// Records drawCount of the item's draws starting at firstDraw
+	void Swapchain::recordDraws(vk::CommandBuffer commandBuffer, uint32_t image, const RecordedDraw &draw,
+	                            uint32_t firstDraw, uint32_t drawCount)
+	{
+		Object &object = *meshes[draw.mesh];
+		if (!isCulled(draw.mesh)) {
+			const GeometryAllocation &geometry = object.getGeometry();
+			const ModelLod &lod = object.getLodData()[draw.levelOfDetail];
+			for (uint32_t partition = lod.firstPartition + firstDraw;
+			     partition < lod.firstPartition + firstDraw + drawCount; partition++) {
+				const ModelPartition &range = object.getPartitionData()[partition];
+				commandBuffer.drawIndexed(range.indexCount, 1, geometry.getFirstIndex() + range.firstIndex,
+				                          static_cast<int32_t>(geometry.getVertexOffset() + range.vertexOffset), 0);
+			}
+			return;
+		}
+
+		// Culled meshlets still cost a command read each, but no vertex or fragment work
+		uint32_t maxDrawCount = device->getMaxDrawIndirectCount();
+		uint32_t stride = sizeof(vk::DrawIndexedIndirectCommand);
+		for (uint32_t indirectDraw = firstDraw; indirectDraw < firstDraw + drawCount; indirectDraw++) {
+			uint32_t first = indirectDraw * maxDrawCount;
+			uint32_t count = std::min(maxDrawCount, object.getMeshletCount() - first);
+			commandBuffer.drawIndexedIndirect(*(indirectBuffers[image]->getBuffer()),
+			                                  indirectBuffers[image]->getOffset() +
+			                                  static_cast<vk::DeviceSize>(draw.firstCommand + first) * stride,
+			                                  count,
+			                                  stride);
+		}
+	}
+
+	void Swapchain::createCullPipeline()
+	{
+		uint32_t count = static_cast<uint32_t>(images.size() * meshes.size());
+
+		// Allocated once a draw list culls something
+		indirectBuffers.resize(images.size());
+
+		cullDescriptorSetLayout = device->createDescriptorSetLayout({
+			vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eUniformBufferDynamic, 1,
+			                               vk::ShaderStageFlagBits::eCompute, nullptr),
+			vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageBuffer, 1,
+			                               vk::ShaderStageFlagBits::eCompute, nullptr),
+			vk::DescriptorSetLayoutBinding(2, vk::DescriptorType::eStorageBuffer, 1,
+			                               vk::ShaderStageFlagBits::eCompute, nullptr)
+		});
+		cullDescriptorPool = device->createDescriptorPool({
+			vk::DescriptorPoolSize(vk::DescriptorType::eUniformBufferDynamic, count),
+			vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, 2 * count)
+		}, count);
+		cullDescriptorSets = device->allocateDescriptorSets(count, cullDescriptorSetLayout, cullDescriptorPool);
+
+		cullPipelineLayout = device->createPipelineLayout(cullDescriptorSetLayout);
+		Shader *cullShader = new Shader(
+			device,
+			"assets/shaders/cull.spv",
+			vk::ShaderStageFlagBits::eCompute
+		);
+		cullPipeline = device->createComputePipeline(cullPipelineLayout, cullShader->getCreateInfo());
+		delete (cullShader);
+	}
+
+	bool Swapchain::isCulled(uint32_t mesh)
+	{
+		return cullPipeline && meshes[mesh]->getMeshletBuffer();
+	}
+
+	// Makes room for commandCount indirect commands in the image's buffer, which must not be in use; returns
+	// whether the buffer was replaced
+	bool Swapchain::reserveIndirectCommands(uint32_t image, uint32_t commandCount)
+	{
+		vk::DeviceSize stride = sizeof(vk::DrawIndexedIndirectCommand);
+		if (indirectBuffers[image] && indirectBuffers[image]->getSize() >= commandCount * stride) {
+			return false;
+		}
+
+		uint32_t capacity = MinIndirectCommands;
+		while (capacity < commandCount) {
+			capacity *= 2u;
+		}
+		indirectBuffers[image] = Buffer::unique(
+			device,
+			capacity * stride,
+			vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer,
+			vk::MemoryPropertyFlagBits::eDeviceLocal,
+			MemoryCategory::Geometry
+		);
+		return true;
+	}
+
+	void Swapchain::writeCullDescriptorSets(uint32_t image)
+	{
+		vk::DescriptorBufferInfo uniformInfo = uniformRing->getDescriptorInfo();
+		vk::DescriptorBufferInfo indirectInfo(*(indirectBuffers[image]->getBuffer()),
+		                                      indirectBuffers[image]->getOffset(),
+		                                      indirectBuffers[image]->getSize());
+		for (size_t mesh = 0; mesh < meshes.size(); mesh++) {
+			auto &meshletBuffer = meshes[mesh]->getMeshletBuffer();
+			if (!meshletBuffer) {
+				continue;
+			}
+			vk::DescriptorBufferInfo meshletInfo(*(meshletBuffer->getBuffer()),
+			                                     meshletBuffer->getOffset(),
+			                                     meshletBuffer->getSize());
+			auto &cullDescriptorSet = cullDescriptorSets[image * meshes.size() + mesh];
+			device->updateDescriptorSets({
+				vk::WriteDescriptorSet(*cullDescriptorSet, 0, 0, 1, vk::DescriptorType::eUniformBufferDynamic,
+				                       nullptr, &uniformInfo, nullptr),
+				vk::WriteDescriptorSet(*cullDescriptorSet, 1, 0, 1, vk::DescriptorType::eStorageBuffer,
+				                       nullptr, &meshletInfo, nullptr),
+				vk::WriteDescriptorSet(*cullDescriptorSet, 2, 0, 1, vk::DescriptorType::eStorageBuffer,
+				                       nullptr, &indirectInfo, nullptr)
+			});
+		}
+	}
+
 	void Swapchain::createUniformBuffers()
 	{
-		uniformBuffers.resize(images.size());
-		for (size_t i = 0; i < images.size(); i++) {
-			uniformBuffers[i] = std::make_unique<Buffer>(
-				Buffer(
-					device,
-					sizeof(UniformBufferObject),
-					vk::BufferUsageFlagBits::eUniformBuffer,
-					vk::MemoryPropertyFlagBits::eHostVisible |
-					vk::MemoryPropertyFlagBits::eHostCoherent)
-			);
+		uniformRing = UniformRing::unique(device, UniformFrameSize, static_cast<uint32_t>(images.size()),
+		                                  sizeof(UniformBufferObject), persistentUniforms);
+	}
+
+	// Replaces the uniform ring with one whose regions take itemCount items, or that is mapped the way
+	// persistentUniforms asks for, once the GPU is done with the old one. Every set and secondary refers to
+	// the ring, so all of them are rewritten.
+	void Swapchain::reserveUniforms(size_t itemCount)
+	{
+		vk::DeviceSize frameSize = uniformRing->getFrameSize();
+		vk::DeviceSize required = itemCount * uniformRing->getAlignedSize(sizeof(UniformBufferObject));
+		if (required <= frameSize && uniformRing->isPersistentlyMapped() == persistentUniforms) {
+			return;
+		}
+		while (frameSize < required) {
+			frameSize *= 2u;
+		}
+
+		device->waitIdle();
+		uniformRing = UniformRing::unique(device, frameSize, static_cast<uint32_t>(images.size()),
+		                                  sizeof(UniformBufferObject), persistentUniforms);
+		vk::DescriptorBufferInfo uniformInfo = uniformRing->getDescriptorInfo();
+		for (auto &descriptorSet : descriptorSets) {
+			device->updateDescriptorSets({
+				vk::WriteDescriptorSet(*descriptorSet, 0, 0, 1, vk::DescriptorType::eUniformBufferDynamic,
+				                       nullptr, &uniformInfo, nullptr)
+			});
+		}
+		// Cull sets are rewritten along with the secondaries as each image is drawn next
+		invalidateCommandBuffers();
+	}
+
+	// Writes the uniforms of every item into the image's region in draw list order and what they draw into
+	// frameDraws
+	void Swapchain::updateUniformBuffer(uint32_t currentImage, const DrawList &drawList)
+	{
+		glm::mat4 view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f),
+		                             glm::vec3(0.0f, 0.0f, 0.0f),
+		                             glm::vec3(0.0f, 0.0f, 1.0f));
+		glm::mat4 projection = glm::perspective(glm::radians(45.0f),
+		                                        static_cast<float>(extent.width) / static_cast<float>(extent.height),
+		                                        01.f,
+		                                        10.0f);
+		projection[1][1] *= -1;
+		// projection[1][1] is 1 / tan(fovy / 2): pixels per unit at distance 1 in the vertical direction
+		float pixelsPerUnit = std::fabs(projection[1][1]) * static_cast<float>(extent.height) * 0.5f;
+
+		reserveUniforms(drawList.size());
+		uniformRing->beginFrame(currentImage);
+		frameDraws.clear();
+		frameCommandCount = 0;
+		uint32_t drawCount = 0;
+		for (const DrawItem &item : drawList.getItems()) {
+			if (item.mesh >= meshes.size() || item.material >= materials.size()) {
+				throw std::out_of_range("draw list refers to a mesh or material that was never registered!");
+			}
+			Object &object = *meshes[item.mesh];
+
+			UniformBufferObject ubo = {};
+			ubo.model = item.transform;
+			ubo.view = view;
+			ubo.projection = projection;
+			const auto &dequantization = object.getVertexFormat().dequantization;
+			ubo.positionScale = dequantization.positionScale;
+			ubo.positionOffset = dequantization.positionOffset;
+			ubo.texCoordTransform = dequantization.texCoordTransform;
+
+			// Frustum planes in model space from the rows of the combined matrix (Gribb and Hartmann), so the
+			// culling shader can test meshlet bounds without transforming them
+			glm::mat4 transform = glm::transpose(ubo.projection * ubo.view * ubo.model);
+			glm::vec4 planes[6] = {
+				transform[3] + transform[0], transform[3] - transform[0],
+				transform[3] + transform[1], transform[3] - transform[1],
+				transform[2], transform[3] - transform[2]
+			};
+			for (size_t i = 0; i < 6; i++) {
+				ubo.frustumPlanes[i] = planes[i] / glm::length(glm::vec3(planes[i]));
+			}
+			ubo.cameraPosition = glm::inverse(ubo.view * ubo.model) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+			RecordedDraw draw = {item.mesh, item.material, 0u, 0u, 0u, drawCount, 0u};
+			uint32_t itemLod = 0;
+			if (object.getLodCount() > 0) {
+				itemLod = object.selectLod(glm::vec3(ubo.cameraPosition), pixelsPerUnit, MaxPixelError);
+				const ModelLod &lod = object.getLodData()[itemLod];
+				const GeometryAllocation &geometry = object.getGeometry();
+				ubo.meshletRange = glm::uvec4(lod.firstMeshlet, lod.meshletCount, geometry.getFirstIndex(),
+				                              geometry.getVertexOffset());
+			}
+			if (frameDraws.empty()) {
+				levelOfDetail = itemLod;
+			}
+
+			// Culling picks the level of detail on the GPU, so only draws without it are recorded per level
+			if (isCulled(item.mesh)) {
+				draw.firstCommand = frameCommandCount;
+				ubo.commandRange = glm::uvec4(frameCommandCount, 0u, 0u, 0u);
+				frameCommandCount += object.getMeshletCount();
+			} else {
+				draw.levelOfDetail = itemLod;
+			}
+			draw.drawCount = getDrawCount(item.mesh, draw.levelOfDetail);
+			drawCount += draw.drawCount;
+
+			draw.uniformOffset = uniformRing->push(ubo);
+			frameDraws.push_back(draw);
+		}
+		uniformRing->flush();
+	}
+
+	bool Swapchain::RecordedDraw::operator==(const RecordedDraw &other) const
+	{
+		return mesh == other.mesh && material == other.material && levelOfDetail == other.levelOfDetail &&
+		       uniformOffset == other.uniformOffset && firstCommand == other.firstCommand &&
+		       firstDraw == other.firstDraw && drawCount == other.drawCount;
+	}
+
+	// CPU time between frames and of the uniform update, which used to map and unmap every frame
+	void Swapchain::recordFrameTime(std::chrono::high_resolution_clock::time_point uniformStart)
+	{
+		if (!LogStatistics && !BenchmarkMapping) {
+			return;
+		}
+		auto now = std::chrono::high_resolution_clock::now();
+		auto previousFrame = lastFrame;
+		lastFrame = uniformStart;
+		if (previousFrame == std::chrono::high_resolution_clock::time_point()) {
+			lastFrame = now;
+			return;
+		}
+		frameTime += uniformStart - previousFrame;
+		uniformTime += now - uniformStart;
+
+		if (++timedFrames == StatisticsInterval) {
+			std::cout << "frame time: " << frameTime.count() / timedFrames << " ms, uniform update: "
+			          << uniformTime.count() * 1000.0 / timedFrames << " us"
+			          << (persistentUniforms ? " (persistent mapping)" : " (map per frame)") << std::endl;
+			frameTime = {};
+			uniformTime = {};
+			timedFrames = 0;
+
+			if (BenchmarkMapping) {
+				// The next frame replaces the ring and waits for the device, timing starts again after it
+				persistentUniforms = !persistentUniforms;
+				lastFrame = {};
+			}
 		}
 	}
 
-	void Swapchain::updateUniformBuffer(uint32_t currentImage)
+	// Called once the frame in the current slot has finished rendering
+	void Swapchain::readStatistics()
 	{
-		float time = Time::elapsedTime();
-		UniformBufferObject ubo = {};
-		ubo.model = glm::rotate(glm::mat4(1.0f),
-		                        time * glm::radians(90.0f),
-		                        glm::vec3(0.0f, 0.0f, 1.0f));
-		ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f),
-		                       glm::vec3(0.0f, 0.0f, 0.0f),
-		                       glm::vec3(0.0f, 0.0f, 1.0f));
-		ubo.projection = glm::perspective(glm::radians(45.0f),
-		                                  static_cast<float>(extent.width) / static_cast<float>(extent.height),
-		                                  01.f,
-		                                  10.0f);
-		ubo.projection[1][1] *= -1;
-
-		uniformBuffers[currentImage]->load(0, &ubo, sizeof(ubo));
+		uint32_t image = frameImages[currentFrame];
+		frameImages[currentFrame] = NoImage;
+
+		// Results come in bit order of the statistics: vertex, then fragment shader invocations
+		uint64_t invocations[2];
+		if (!statisticsQueryPool || image == NoImage ||
+		    !device->getQueryResults(statisticsQueryPool, image, 1, 2, invocations)) {
+			return;
+		}
+
+		vertexInvocations += invocations[0];
+		fragmentInvocations += invocations[1];
+		if (++statisticsFrames == StatisticsInterval) {
+			std::cout << "vertex shader invocations per frame: " << vertexInvocations / statisticsFrames
+			          << " (" << frameDraws.size() << " draw items, level of detail " << levelOfDetail
+			          << " for the first)" << std::endl;
+			std::cout << "fragment shader invocations per frame: " << fragmentInvocations / statisticsFrames
+			          << " (" << static_cast<double>(fragmentInvocations) / statisticsFrames /
+			                     (static_cast<double>(extent.width) * extent.height) << " per pixel)" << std::endl;
+			vertexInvocations = 0;
+			fragmentInvocations = 0;
+			statisticsFrames = 0;
+		}
 	}
 }
@@ -1,6 +1,7 @@
 #ifndef OBTAIN_GRAPHICS_VULKAN_SWAPCHAIN_HPP
 #define OBTAIN_GRAPHICS_VULKAN_SWAPCHAIN_HPP
 
+#include <chrono>
 #include <vector>
 #include <vulkan/vulkan.hpp>
 
@@ -8,6 +9,12 @@
 #include "buffer.hpp"
 #include "device.hpp"
 #include "image.hpp"
+#include "object.hpp"
+#include "geometry-pool.hpp"
+#include "uniform-ring.hpp"
+#include "command-buffer-manager.hpp"
+#include "draw-list.hpp"
+#include "../../utils/worker-pool.hpp"
 
 namespace Obtain::Graphics::Vulkan {
 	class Swapchain {
@@ -17,28 +24,42 @@ namespace Obtain::Graphics::Vulkan {
 			std::array<uint32_t, 2> windowSize,
 			QueueFamilyIndices indices,
 			vk::UniqueCommandPool &commandPool,
-			std::unique_ptr<Buffer> &vertexBuffer,
-			std::unique_ptr<Buffer> &indexBuffer,
-			std::unique_ptr<Image> &textureImage,
+			CommandBufferManager &commandBuffers,
+			WorkerPool &workers,
+			std::unique_ptr<GeometryPool> &geometryPool,
+			std::vector<std::unique_ptr<Object>> &meshes,
+			std::vector<Image *> &materials,
 			vk::UniqueSampler &sampler
 		);
 
 		~Swapchain();
 
+		// Records the sorted draw list into a primary of the current frame of commandBuffers and submits
+		// it on the graphics timeline after waits, besides the image being acquired
 		bool submitFrame(
-			vk::Queue &graphicsQueue,
-			vk::Queue &presentationQueue
+			vk::Queue &presentationQueue,
+			const DrawList &drawList,
+			vk::ArrayProxy<const GpuWait> waits = nullptr
 		);
 
+		// Stages in which a frame first reads the scene, for waits on scene uploads; culling is the first
+		static vk::PipelineStageFlags getSceneReadStages();
+
 		inline vk::UniqueSwapchainKHR &getSwapchain()
 		{
 			return swapchain;
 		}
 
-		inline vk::UniqueCommandBuffer &getCommandBuffer(uint32_t i)
-		{
-			return commandBuffers[i];
-		}
+		// Rewrites each image's secondaries and cull descriptors the next time the image is drawn, after
+		// buffers they refer to were replaced
+		void invalidateCommandBuffers();
+
+		// Whether some command buffer still refers to buffers replaced before invalidateCommandBuffers
+		bool hasStaleCommandBuffers();
+
+		// Records every image's secondaries for drawList repetitions times with 1, 2, 4 and so on up to all
+		// worker threads and logs the time per image for each; waits for the device to be idle first
+		void benchmarkRecording(const DrawList &drawList, uint32_t repetitions);
 
 	private:
 		vk::UniqueSwapchainKHR swapchain;
@@ -60,19 +81,92 @@ namespace Obtain::Graphics::Vulkan {
 		vk::UniquePipeline pipeline;
 		vk::UniqueRenderPass renderPass;
 
+		// What an image's secondaries draw for one item of the sorted draw list. Uniform offsets only depend
+		// on the position in the list, so a frame whose draws compare equal to the ones recorded for its
+		// image executes the same secondaries again
+		struct RecordedDraw {
+			uint32_t mesh;
+			uint32_t material;
+			uint32_t levelOfDetail; // drawn without culling, with culling the pass selects it
+			uint32_t uniformOffset;
+			uint32_t firstCommand; // in the image's indirect buffer, with culling
+			uint32_t firstDraw; // draw calls of the items before
+			uint32_t drawCount;
+
+			bool operator==(const RecordedDraw &other) const;
+		};
+
 		vk::UniqueCommandPool &commandPool;
-		std::vector<vk::UniqueCommandBuffer> commandBuffers;
-		std::unique_ptr<Buffer> &vertexBuffer;
-		std::unique_ptr<Buffer> &indexBuffer;
-		std::vector<std::unique_ptr<Buffer>> uniformBuffers;
+		// The primary of each frame, which culls and executes the image's secondaries, and the secondaries
+		CommandBufferManager &commandBuffers;
+		// Draws are recorded into secondary command buffers on the worker threads, in slices of at least
+		// MinDrawsPerThread draws, which the primary executes in order
+		static const uint32_t MinDrawsPerThread = 64;
+		WorkerPool &workers;
+		uint32_t recordingThreads;
+		std::vector<std::vector<vk::UniqueCommandBuffer>> secondaryCommandBuffers; // per image and thread
+		std::vector<uint32_t> secondaryCounts; // per image, slices of its last recording
+		std::vector<vk::CommandBuffer> executedSecondaries;
+		std::vector<std::vector<RecordedDraw>> recordedDraws; // per image
+		std::vector<RecordedDraw> frameDraws; // of the frame being submitted
+		uint32_t frameCommandCount = 0; // indirect commands the frame culls into
+		std::vector<bool> staleImages;
+		std::unique_ptr<GeometryPool> &geometryPool;
+		// Meshes and materials of the draw list by index, all drawn with the vertex format of the first
+		std::vector<std::unique_ptr<Object>> &meshes;
+		std::vector<Image *> &materials;
+		// Uniform data of all draws, one region per swapchain image; a UniformBufferObject takes 512 bytes
+		// at the usual alignments, so regions start with room for 512 draw items and double whenever a
+		// draw list doesn't fit
+		static constexpr vk::DeviceSize UniformFrameSize = 256u * 1024u;
+		std::unique_ptr<UniformRing> uniformRing;
+
+		// Meshlet culling: a compute pass per item with meshlets writes one indirect draw per meshlet into
+		// the item's range of the image's indirect buffer, culled meshlets get an instance count of 0.
+		// Descriptor sets are per image and mesh
+		static const uint32_t CullGroupSize = 64;
+		// Levels of detail are picked so their simplification error stays below this on screen
+		static constexpr float MaxPixelError = 1.0f;
+		uint32_t levelOfDetail = 0; // of the first draw item, for the statistics
+		vk::UniqueDescriptorSetLayout cullDescriptorSetLayout;
+		vk::UniqueDescriptorPool cullDescriptorPool;
+		std::vector<vk::UniqueDescriptorSet> cullDescriptorSets;
+		// Indirect buffers start with room for MinIndirectCommands and double when a draw list needs more
+		static const uint32_t MinIndirectCommands = 16u * 1024u;
+		vk::UniquePipelineLayout cullPipelineLayout;
+		vk::UniquePipeline cullPipeline;
+		std::vector<std::unique_ptr<Buffer>> indirectBuffers;
 
 		static const int MaxFramesInFlight = 2;
 		std::array<vk::UniqueSemaphore, MaxFramesInFlight> imageReady;
 		std::array<vk::UniqueSemaphore, MaxFramesInFlight> renderFinished;
-		std::array<vk::UniqueFence, MaxFramesInFlight> outOfFlight;
+		// Graphics timeline value of each frame's last submission
+		std::array<uint64_t, MaxFramesInFlight> frameSubmissions{};
 		size_t currentFrame = 0;
 
-		std::unique_ptr<Image> &textureImage;
+		// Log vertex and fragment shader invocations of the draws every StatisticsInterval frames, to
+		// measure overdraw and what culling saves; queried once per swapchain image
+		static const bool LogStatistics = false;
+		static const uint32_t NoImage = 0xFFFFFFFFu;
+		static const uint32_t StatisticsInterval = 500;
+		vk::UniqueQueryPool statisticsQueryPool;
+		vk::QueryPipelineStatisticFlags statisticFlags;
+		std::array<uint32_t, MaxFramesInFlight> frameImages;
+		uint64_t vertexInvocations = 0;
+		uint64_t fragmentInvocations = 0;
+		uint32_t statisticsFrames = 0;
+
+		// Switch the uniform ring between persistent mapping and a map, copy and unmap per frame every
+		// StatisticsInterval frames, logging the frame time and uniform update time of each
+		static const bool BenchmarkMapping = false;
+		bool persistentUniforms = true;
+
+		// Frame pacing, averaged over StatisticsInterval frames and logged with the invocations
+		std::chrono::high_resolution_clock::time_point lastFrame;
+		std::chrono::duration<double, std::milli> frameTime{};
+		std::chrono::duration<double, std::milli> uniformTime{};
+		uint32_t timedFrames = 0;
+
 		vk::UniqueSampler &sampler;
 
 		static vk::SurfaceFormatKHR chooseSwapSurfaceFormat(
@@ -90,9 +184,23 @@ namespace Obtain::Graphics::Vulkan {
 
 		void createUniformBuffers();
 		void createCommandBuffers();
+		vk::CommandBuffer recordFrame(uint32_t image);
+		void recordSecondaries(uint32_t image);
+		void refreshCommandBuffer(uint32_t image);
 		void createPipeline();
-
-		void updateUniformBuffer(uint32_t currentImage);
+		void createCullPipeline();
+		bool isCulled(uint32_t mesh);
+		bool reserveIndirectCommands(uint32_t image, uint32_t commandCount);
+		void writeCullDescriptorSets(uint32_t image);
+		void reserveUniforms(size_t itemCount);
+		uint32_t getDrawCount(uint32_t mesh, uint32_t lod);
+		void recordSecondary(uint32_t image, uint32_t slice, uint32_t sliceCount);
+		void recordDraws(vk::CommandBuffer commandBuffer, uint32_t image, const RecordedDraw &draw, uint32_t firstDraw,
+		                 uint32_t drawCount);
+
+		void updateUniformBuffer(uint32_t currentImage, const DrawList &drawList);
+		void readStatistics();
+		void recordFrameTime(std::chrono::high_resolution_clock::time_point uniformStart);
 	};
 }
 
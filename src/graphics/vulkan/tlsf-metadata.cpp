@@ -0,0 +1,348 @@
+#include "tlsf-metadata.hpp"
+
+#include <algorithm>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace Obtain::Graphics::Vulkan {
+	namespace {
+		// Bit scans of non-zero values, with the compiler's intrinsics where there are some
+		uint32_t mostSignificantBit(uint64_t value)
+		{
+#if defined(__GNUC__) || defined(__clang__)
+			return 63u - static_cast<uint32_t>(__builtin_clzll(value));
+#elif defined(_MSC_VER)
+			unsigned long index;
+			_BitScanReverse64(&index, value);
+			return static_cast<uint32_t>(index);
+#else
+			uint32_t index = 0u;
+			while (value >>= 1u) {
+				index++;
+			}
+			return index;
+#endif
+		}
+
+		uint32_t leastSignificantBit(uint64_t value)
+		{
+#if defined(__GNUC__) || defined(__clang__)
+			return static_cast<uint32_t>(__builtin_ctzll(value));
+#elif defined(_MSC_VER)
+			unsigned long index;
+			_BitScanForward64(&index, value);
+			return static_cast<uint32_t>(index);
+#else
+			uint32_t index = 0u;
+			while (!(value & 1u)) {
+				value >>= 1u;
+				index++;
+			}
+			return index;
+#endif
+		}
+
+		vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+		{
+			return (value + alignment - 1u) / alignment * alignment;
+		}
+	}
+
+	/******************************************
+	 ***************** public *****************
+	 ******************************************/
+
+	TlsfMetadata::TlsfMetadata(vk::DeviceSize size)
+		: size(size), usedBytes(0u), allocationCount(0u), firstLevelBitmap(0u), secondLevelBitmaps{}
+	{
+		for (auto &heads : freeHeads) {
+			std::fill(std::begin(heads), std::end(heads), NullNode);
+		}
+		insertFree(createNode(0u, size, NullNode, NullNode));
+	}
+
+	uint32_t TlsfMetadata::allocate(vk::DeviceSize allocationSize, vk::DeviceSize alignment, bool linear,
+	                                vk::DeviceSize granularity)
+	{
+		uint32_t firstLevel, secondLevel;
+		mapping(roundUpToClass(allocationSize), firstLevel, secondLevel);
+
+		// Every range in the rounded up class and above is large enough, only alignment and
+		// granularity can still get in the way
+		uint32_t node = NullNode;
+		vk::DeviceSize offset = 0u;
+		while (node == NullNode && findNonEmpty(firstLevel, secondLevel)) {
+			for (uint32_t candidate = freeHeads[firstLevel][secondLevel];
+			     candidate != NullNode; candidate = nodes[candidate].nextFree) {
+				if (fits(candidate, allocationSize, alignment, linear, granularity, offset)) {
+					node = candidate;
+					break;
+				}
+			}
+			if (++secondLevel == SecondLevelCount) {
+				secondLevel = 0u;
+				firstLevel++;
+			}
+		}
+
+		// Ranges in the class of the exact size may be just large enough
+		if (node == NullNode) {
+			mapping(allocationSize, firstLevel, secondLevel);
+			for (uint32_t candidate = freeHeads[firstLevel][secondLevel];
+			     candidate != NullNode; candidate = nodes[candidate].nextFree) {
+				if (fits(candidate, allocationSize, alignment, linear, granularity, offset)) {
+					node = candidate;
+					break;
+				}
+			}
+		}
+
+		if (node == NullNode) {
+			return NullNode;
+		}
+
+		removeFree(node);
+
+		// Padding in front and the rest behind go back to the free lists
+		if (offset > nodes[node].offset) {
+			uint32_t padding = createNode(nodes[node].offset, offset - nodes[node].offset,
+			                              nodes[node].previous, node);
+			nodes[node].previous = padding;
+			nodes[node].offset = offset;
+			nodes[node].size -= nodes[padding].size;
+			insertFree(padding);
+		}
+		if (nodes[node].size > allocationSize) {
+			uint32_t rest = createNode(offset + allocationSize, nodes[node].size - allocationSize,
+			                           node, nodes[node].next);
+			nodes[node].next = rest;
+			nodes[node].size = allocationSize;
+			insertFree(rest);
+		}
+
+		nodes[node].free = false;
+		nodes[node].linear = linear;
+		usedBytes += allocationSize;
+		allocationCount++;
+		return node;
+	}
+
+	void TlsfMetadata::free(uint32_t node)
+	{
+		usedBytes -= nodes[node].size;
+		allocationCount--;
+		nodes[node].free = true;
+
+		uint32_t previous = nodes[node].previous;
+		if (previous != NullNode && nodes[previous].free) {
+			removeFree(previous);
+			nodes[node].offset = nodes[previous].offset;
+			nodes[node].size += nodes[previous].size;
+			releaseNode(previous);
+		}
+		uint32_t next = nodes[node].next;
+		if (next != NullNode && nodes[next].free) {
+			removeFree(next);
+			nodes[node].size += nodes[next].size;
+			releaseNode(next);
+		}
+		insertFree(node);
+	}
+
+	vk::DeviceSize TlsfMetadata::getOffset(uint32_t node) const
+	{
+		return nodes[node].offset;
+	}
+
+	vk::DeviceSize TlsfMetadata::getSize(uint32_t node) const
+	{
+		return nodes[node].size;
+	}
+
+	vk::DeviceSize TlsfMetadata::getSize() const
+	{
+		return size;
+	}
+
+	vk::DeviceSize TlsfMetadata::getUsedBytes() const
+	{
+		return usedBytes;
+	}
+
+	uint32_t TlsfMetadata::getAllocationCount() const
+	{
+		return allocationCount;
+	}
+
+	bool TlsfMetadata::isEmpty() const
+	{
+		return allocationCount == 0u;
+	}
+
+	vk::DeviceSize TlsfMetadata::getLargestFreeRange() const
+	{
+		if (firstLevelBitmap == 0u) {
+			return 0u;
+		}
+		uint32_t firstLevel = mostSignificantBit(firstLevelBitmap);
+		uint32_t secondLevel = mostSignificantBit(secondLevelBitmaps[firstLevel]);
+
+		vk::DeviceSize largest = 0u;
+		for (uint32_t node = freeHeads[firstLevel][secondLevel]; node != NullNode; node = nodes[node].nextFree) {
+			largest = std::max(largest, nodes[node].size);
+		}
+		return largest;
+	}
+
+	/******************************************
+	 ***************** private *****************
+	 ******************************************/
+
+	void TlsfMetadata::mapping(vk::DeviceSize value, uint32_t &firstLevel, uint32_t &secondLevel)
+	{
+		if (value < SmallSize) {
+			firstLevel = 0u;
+			secondLevel = static_cast<uint32_t>(value / (SmallSize / SecondLevelCount));
+		} else {
+			uint32_t bit = mostSignificantBit(value);
+			firstLevel = bit - SmallSizeBits + 1u;
+			secondLevel = static_cast<uint32_t>(value >> (bit - SecondLevelBits)) - SecondLevelCount;
+		}
+	}
+
+	// Smallest size whose class only holds ranges of at least value
+	vk::DeviceSize TlsfMetadata::roundUpToClass(vk::DeviceSize value)
+	{
+		if (value < SmallSize) {
+			return alignUp(value, SmallSize / SecondLevelCount);
+		}
+		vk::DeviceSize step = vk::DeviceSize(1u) << (mostSignificantBit(value) - SecondLevelBits);
+		return alignUp(value, step);
+	}
+
+	// Moves firstLevel and secondLevel to the first non-empty class at or above them
+	bool TlsfMetadata::findNonEmpty(uint32_t &firstLevel, uint32_t &secondLevel) const
+	{
+		if (firstLevel >= FirstLevelCount) {
+			return false;
+		}
+		uint32_t secondLevelMap = secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+		if (secondLevelMap == 0u) {
+			uint64_t firstLevelMap = firstLevel + 1u < FirstLevelCount
+			                         ? firstLevelBitmap & (~uint64_t(0u) << (firstLevel + 1u))
+			                         : 0u;
+			if (firstLevelMap == 0u) {
+				return false;
+			}
+			firstLevel = leastSignificantBit(firstLevelMap);
+			secondLevelMap = secondLevelBitmaps[firstLevel];
+		}
+		secondLevel = leastSignificantBit(secondLevelMap);
+		return true;
+	}
+
+	// Linear and optimal tiling resources closer than bufferImageGranularity may alias on some
+	// hardware, so a range next to one of the other kind must not share its page
+	bool TlsfMetadata::fits(uint32_t node, vk::DeviceSize allocationSize, vk::DeviceSize alignment, bool linear,
+	                        vk::DeviceSize granularity, vk::DeviceSize &offset) const
+	{
+		const Node &candidate = nodes[node];
+		offset = alignUp(candidate.offset, alignment);
+
+		if (granularity > 1u && candidate.previous != NullNode) {
+			const Node &previous = nodes[candidate.previous];
+			if (previous.linear != linear &&
+			    samePage(previous.offset + previous.size - 1u, offset, granularity)) {
+				offset = alignUp(offset, granularity);
+			}
+		}
+		if (offset + allocationSize > candidate.offset + candidate.size) {
+			return false;
+		}
+		if (granularity > 1u && candidate.next != NullNode) {
+			const Node &next = nodes[candidate.next];
+			if (next.linear != linear && samePage(offset + allocationSize - 1u, next.offset, granularity)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool TlsfMetadata::samePage(vk::DeviceSize a, vk::DeviceSize b, vk::DeviceSize granularity)
+	{
+		return a / granularity == b / granularity;
+	}
+
+	uint32_t TlsfMetadata::createNode(vk::DeviceSize offset, vk::DeviceSize nodeSize, uint32_t previous, uint32_t next)
+	{
+		uint32_t node;
+		if (unusedNodes.empty()) {
+			node = static_cast<uint32_t>(nodes.size());
+			nodes.emplace_back();
+		} else {
+			node = unusedNodes.back();
+			unusedNodes.pop_back();
+		}
+		nodes[node] = {offset, nodeSize, previous, next, NullNode, NullNode, true, true};
+		if (previous != NullNode) {
+			nodes[previous].next = node;
+		}
+		if (next != NullNode) {
+			nodes[next].previous = node;
+		}
+		return node;
+	}
+
+	// Unlinks node from its neighbours in the block and recycles it
+	void TlsfMetadata::releaseNode(uint32_t node)
+	{
+		if (nodes[node].previous != NullNode) {
+			nodes[nodes[node].previous].next = nodes[node].next;
+		}
+		if (nodes[node].next != NullNode) {
+			nodes[nodes[node].next].previous = nodes[node].previous;
+		}
+		unusedNodes.push_back(node);
+	}
+
+	void TlsfMetadata::insertFree(uint32_t node)
+	{
+		uint32_t firstLevel, secondLevel;
+		mapping(nodes[node].size, firstLevel, secondLevel);
+
+		uint32_t &head = freeHeads[firstLevel][secondLevel];
+		nodes[node].previousFree = NullNode;
+		nodes[node].nextFree = head;
+		if (head != NullNode) {
+			nodes[head].previousFree = node;
+		}
+		head = node;
+
+		firstLevelBitmap |= uint64_t(1u) << firstLevel;
+		secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+	}
+
+	void TlsfMetadata::removeFree(uint32_t node)
+	{
+		uint32_t firstLevel, secondLevel;
+		mapping(nodes[node].size, firstLevel, secondLevel);
+
+		if (nodes[node].previousFree != NullNode) {
+			nodes[nodes[node].previousFree].nextFree = nodes[node].nextFree;
+		} else {
+			freeHeads[firstLevel][secondLevel] = nodes[node].nextFree;
+		}
+		if (nodes[node].nextFree != NullNode) {
+			nodes[nodes[node].nextFree].previousFree = nodes[node].previousFree;
+		}
+
+		if (freeHeads[firstLevel][secondLevel] == NullNode) {
+			secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+			if (secondLevelBitmaps[firstLevel] == 0u) {
+				firstLevelBitmap &= ~(uint64_t(1u) << firstLevel);
+			}
+		}
+	}
+}
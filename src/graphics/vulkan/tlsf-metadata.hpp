@@ -0,0 +1,94 @@
+#ifndef OBTAIN_GRAPHICS_VULKAN_TLSF_METADATA_HPP
+#define OBTAIN_GRAPHICS_VULKAN_TLSF_METADATA_HPP
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace Obtain::Graphics::Vulkan {
+	/*
+	 * Bookkeeping of one block. Every range of the block, free or used, is a node in a list sorted
+	 * by offset; free nodes are also in the free list of their size class. A size class is found
+	 * from the bit pattern of the size and the first non-empty class at or above it from two
+	 * levels of bitmaps, which is what makes TLSF constant time.
+	 */
+	class TlsfMetadata {
+	public:
+		static constexpr uint32_t NullNode = std::numeric_limits<uint32_t>::max();
+
+		explicit TlsfMetadata(vk::DeviceSize size);
+
+		// Returns the node of the new range or NullNode when no free range fits
+		uint32_t allocate(vk::DeviceSize allocationSize, vk::DeviceSize alignment, bool linear,
+		                  vk::DeviceSize granularity);
+
+		void free(uint32_t node);
+
+		vk::DeviceSize getOffset(uint32_t node) const;
+
+		vk::DeviceSize getSize(uint32_t node) const;
+
+		vk::DeviceSize getSize() const;
+
+		vk::DeviceSize getUsedBytes() const;
+
+		uint32_t getAllocationCount() const;
+
+		bool isEmpty() const;
+
+		vk::DeviceSize getLargestFreeRange() const;
+
+	private:
+		// Every power of two size range is split into SecondLevelCount linear steps
+		static constexpr uint32_t SecondLevelBits = 4u;
+		static constexpr uint32_t SecondLevelCount = 1u << SecondLevelBits;
+
+		// Sizes below SmallSize share first level 0, in steps of SmallSize / SecondLevelCount
+		static constexpr uint32_t SmallSizeBits = 8u;
+		static constexpr vk::DeviceSize SmallSize = 1u << SmallSizeBits;
+		static constexpr uint32_t FirstLevelCount = 64u - SmallSizeBits + 1u;
+
+		struct Node {
+			vk::DeviceSize offset;
+			vk::DeviceSize size;
+			uint32_t previous; // neighbours in the block
+			uint32_t next;
+			uint32_t previousFree; // neighbours in the free list, free nodes only
+			uint32_t nextFree;
+			bool free;
+			bool linear;
+		};
+
+		vk::DeviceSize size;
+		vk::DeviceSize usedBytes;
+		uint32_t allocationCount;
+		std::vector<Node> nodes;
+		std::vector<uint32_t> unusedNodes;
+
+		uint64_t firstLevelBitmap;
+		uint32_t secondLevelBitmaps[FirstLevelCount];
+		uint32_t freeHeads[FirstLevelCount][SecondLevelCount];
+
+		static void mapping(vk::DeviceSize value, uint32_t &firstLevel, uint32_t &secondLevel);
+
+		static vk::DeviceSize roundUpToClass(vk::DeviceSize value);
+
+		bool findNonEmpty(uint32_t &firstLevel, uint32_t &secondLevel) const;
+
+		bool fits(uint32_t node, vk::DeviceSize allocationSize, vk::DeviceSize alignment, bool linear,
+		          vk::DeviceSize granularity, vk::DeviceSize &offset) const;
+
+		static bool samePage(vk::DeviceSize a, vk::DeviceSize b, vk::DeviceSize granularity);
+
+		uint32_t createNode(vk::DeviceSize offset, vk::DeviceSize nodeSize, uint32_t previous, uint32_t next);
+
+		void releaseNode(uint32_t node);
+
+		void insertFree(uint32_t node);
+
+		void removeFree(uint32_t node);
+	};
+}
+
+#endif // OBTAIN_GRAPHICS_VULKAN_TLSF_METADATA_HPP
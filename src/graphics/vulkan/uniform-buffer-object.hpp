@@ -9,6 +9,18 @@ namespace Obtain::Graphics::Vulkan {
 		alignas(16) glm::mat4 model;
 		alignas(16) glm::mat4 view;
 		alignas(16) glm::mat4 projection;
+		// VertexDequantization of the vertex buffer being drawn
+		alignas(16) glm::vec4 positionScale;
+		alignas(16) glm::vec4 positionOffset;
+		alignas(16) glm::vec4 texCoordTransform;
+		// Model space view frustum and camera for meshlet culling
+		alignas(16) glm::vec4 frustumPlanes[6];
+		alignas(16) glm::vec4 cameraPosition;
+		// First meshlet and meshlet count of the level of detail being drawn, first index and vertex offset
+		// of the mesh in the geometry pool
+		alignas(16) glm::uvec4 meshletRange;
+		// First command of the draw in the indirect buffer the culling pass writes
+		alignas(16) glm::uvec4 commandRange;
 	};
 }
 #endif // OBTAIN_GRAPHICS_VULKAN_UNIFORM_BUFFER_OBJECT_HPP
@@ -0,0 +1,87 @@
+#include "uniform-ring.hpp"
+
+#include <stdexcept>
+
+namespace Obtain::Graphics::Vulkan {
+	UniformRing::UniformRing(Device *device, vk::DeviceSize frameSize, uint32_t frameCount, vk::DeviceSize range,
+	                         bool persistentlyMapped)
+		: alignment(device->getMinUniformBufferOffsetAlignment()), frameCount(frameCount), range(range), frame(0u),
+		  used(0u)
+	{
+		this->frameSize = (frameSize + alignment - 1u) / alignment * alignment;
+
+		// The range read from the last offset of the last region must still be inside the buffer
+		buffer = Buffer::unique(device,
+		                        this->frameSize * frameCount + range,
+		                        vk::BufferUsageFlagBits::eUniformBuffer,
+		                        vk::MemoryPropertyFlagBits::eHostVisible,
+		                        MemoryCategory::Uniforms,
+		                        persistentlyMapped);
+		if (!persistentlyMapped) {
+			frameData.resize(static_cast<size_t>(this->frameSize));
+		}
+	}
+
+	std::unique_ptr<UniformRing> UniformRing::unique(Device *device, vk::DeviceSize frameSize, uint32_t frameCount,
+	                                                 vk::DeviceSize range, bool persistentlyMapped)
+	{
+		return std::make_unique<UniformRing>(UniformRing(device, frameSize, frameCount, range, persistentlyMapped));
+	}
+
+	void UniformRing::beginFrame(uint32_t frame)
+	{
+		this->frame = frame % frameCount;
+		used = 0u;
+	}
+
+	UniformRange UniformRing::allocate(vk::DeviceSize size)
+	{
+		if (size > range || used + size > frameSize) {
+			throw std::runtime_error("uniform ring is out of space for this frame!");
+		}
+
+		vk::DeviceSize offset = frame * frameSize + used;
+		void *data = frameData.empty() ? static_cast<char *>(buffer->getMappedData()) + offset
+		                               : frameData.data() + used;
+		used = (used + size + alignment - 1u) / alignment * alignment;
+
+		return {data, static_cast<uint32_t>(offset)};
+	}
+
+	void UniformRing::flush()
+	{
+		if (used == 0u) {
+			return;
+		}
+		if (frameData.empty()) {
+			buffer->flush(frame * frameSize, used);
+		} else {
+			buffer->load(frame * frameSize, frameData.data(), static_cast<size_t>(used));
+		}
+	}
+
+	uint32_t UniformRing::getFrameOffset(uint32_t frame)
+	{
+		return static_cast<uint32_t>((frame % frameCount) * frameSize);
+	}
+
+	vk::DeviceSize UniformRing::getFrameSize()
+	{
+		return frameSize;
+	}
+
+	vk::DeviceSize UniformRing::getAlignedSize(vk::DeviceSize size)
+	{
+		return (size + alignment - 1u) / alignment * alignment;
+	}
+
+	bool UniformRing::isPersistentlyMapped()
+	{
+		return frameData.empty();
+	}
+
+	vk::DescriptorBufferInfo UniformRing::getDescriptorInfo()
+	{
+		return vk::DescriptorBufferInfo(*(buffer->getBuffer()), buffer->getOffset(), range);
+	}
+}
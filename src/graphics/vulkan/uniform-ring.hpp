@@ -0,0 +1,76 @@
+#ifndef OBTAIN_GRAPHICS_VULKAN_UNIFORM_RING_HPP
+#define OBTAIN_GRAPHICS_VULKAN_UNIFORM_RING_HPP
+
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "device.hpp"
+#include "buffer.hpp"
+
+namespace Obtain::Graphics::Vulkan {
+	// Uniform data of one draw, written through data and bound with dynamicOffset
+	struct UniformRange {
+		void *data;
+		uint32_t dynamicOffset;
+	};
+
+	/*
+	 * Hands out uniform data for any number of draws from one persistently mapped buffer. The buffer
+	 * is split into one region per frame, used round robin, and each region is allocated linearly
+	 * from its start and reset as a whole when its frame comes around again. Ranges are aligned to
+	 * minUniformBufferOffsetAlignment, so one eUniformBufferDynamic descriptor over the whole buffer
+	 * serves every draw and only the dynamic offset changes between them. A ring that is not persistently
+	 * mapped collects the frame's uniforms in host memory and loads them in one map, copy and unmap.
+	 */
+	class UniformRing {
+	public:
+		// range is what a descriptor reads from each dynamic offset, at least the largest allocation
+		UniformRing(Device *device, vk::DeviceSize frameSize, uint32_t frameCount, vk::DeviceSize range,
+		            bool persistentlyMapped = true);
+
+		static std::unique_ptr<UniformRing> unique(Device *device, vk::DeviceSize frameSize, uint32_t frameCount,
+		                                           vk::DeviceSize range, bool persistentlyMapped = true);
+
+		// Starts allocating from the region of frame; the GPU must be done with its previous contents
+		void beginFrame(uint32_t frame);
+
+		UniformRange allocate(vk::DeviceSize size);
+
+		template<typename T>
+		uint32_t push(const T &data)
+		{
+			UniformRange range = allocate(sizeof(T));
+			memcpy(range.data, &data, sizeof(T));
+			return range.dynamicOffset;
+		}
+
+		// Makes everything allocated since beginFrame visible to the device
+		void flush();
+
+		// Dynamic offset of the first allocation in the region of frame
+		uint32_t getFrameOffset(uint32_t frame);
+
+		vk::DeviceSize getFrameSize();
+
+		// Space an allocation of size takes in a region
+		vk::DeviceSize getAlignedSize(vk::DeviceSize size);
+
+		vk::DescriptorBufferInfo getDescriptorInfo();
+
+		bool isPersistentlyMapped();
+
+	private:
+		std::unique_ptr<Buffer> buffer;
+		vk::DeviceSize alignment;
+		vk::DeviceSize frameSize;
+		uint32_t frameCount;
+		vk::DeviceSize range;
+		uint32_t frame;
+		vk::DeviceSize used;
+		std::vector<char> frameData; // the current frame's uniforms when the buffer isn't persistently mapped
+	};
+}
+
+#endif // OBTAIN_GRAPHICS_VULKAN_UNIFORM_RING_HPP
@@ -0,0 +1,259 @@
+#include "upload-batch.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace Obtain::Graphics::Vulkan {
+	// Device local memory that can still be written through a mapping
+	static const vk::MemoryPropertyFlags DirectMemoryProperties =
+		vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eHostVisible;
+
+	UploadBatch::UploadBatch(Device *device, vk::UniqueCommandPool &graphicsPool, StagingRing &ring,
+	                         bool directUploads)
+		: device(device), graphicsPool(graphicsPool), ring(ring),
+		  transferTimeline(device->getTransferTimeline()), graphicsTimeline(device->getGraphicsTimeline()),
+		  ownershipTransfer(device->getTransferFamily() != device->getGraphicsFamily()),
+		  lastSubmission(0u), graphicsSubmission(0u),
+		  directUploads(directUploads), stagedBytes(0u), directBytes(0u), uploadCount(0u), submissionCount(0u),
+		  submitted(false)
+	{
+		uint32_t directMemoryType;
+		this->directUploads = directUploads && device->findMemoryType(~0u, DirectMemoryProperties, directMemoryType);
+
+		beginCommandBuffer();
+	}
+
+	UploadBatch::~UploadBatch()
+	{
+		if (lastSubmission > 0u) {
+			wait();
+		}
+	}
+
+	vk::CommandBuffer UploadBatch::getCommandBuffer()
+	{
+		if (submitted) {
+			throw std::logic_error("recording into an upload batch that was already submitted");
+		}
+		return *commandBuffer;
+	}
+
+	vk::CommandBuffer UploadBatch::getGraphicsCommandBuffer()
+	{
+		if (submitted) {
+			throw std::logic_error("recording into an upload batch that was already submitted");
+		}
+		if (!graphicsCommandBuffer) {
+			auto allocated = device->allocateCommandBuffers(graphicsPool, vk::CommandBufferLevel::ePrimary, 1u);
+			graphicsCommandBuffer = std::move(allocated[0]);
+			graphicsCommandBuffer->begin(
+				vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+		}
+		return *graphicsCommandBuffer;
+	}
+
+	void UploadBatch::handOver(vk::Image image, const vk::ImageSubresourceRange &range,
+	                           const vk::ImageLayout &layout)
+	{
+		// On one queue the barrier at the end of every submission already orders the copies before it
+		if (!ownershipTransfer) {
+			return;
+		}
+
+		vk::ImageMemoryBarrier release(vk::AccessFlagBits::eTransferWrite, vk::AccessFlags(),
+		                               layout, layout,
+		                               device->getTransferFamily(), device->getGraphicsFamily(),
+		                               image, range);
+		getCommandBuffer().pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+		                                   vk::PipelineStageFlagBits::eBottomOfPipe,
+		                                   vk::DependencyFlags(),
+		                                   0u, nullptr,
+		                                   0u, nullptr,
+		                                   1u, &release);
+
+		vk::ImageMemoryBarrier acquire(vk::AccessFlags(),
+		                               vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite,
+		                               layout, layout,
+		                               device->getTransferFamily(), device->getGraphicsFamily(),
+		                               image, range);
+		getGraphicsCommandBuffer().pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,
+		                                           vk::PipelineStageFlagBits::eTransfer,
+		                                           vk::DependencyFlags(),
+		                                           0u, nullptr,
+		                                           0u, nullptr,
+		                                           1u, &acquire);
+	}
+
+	vk::DeviceSize UploadBatch::getMaxStageSize()
+	{
+		return ring.getMaxAllocation();
+	}
+
+	StagedRange UploadBatch::stage(const void *data, vk::DeviceSize size, vk::DeviceSize alignment)
+	{
+		if (submitted) {
+			throw std::logic_error("staging into an upload batch that was already submitted");
+		}
+		if (size > getMaxStageSize()) {
+			throw std::logic_error("staging more than the staging ring takes at once, the upload must be split");
+		}
+
+		StagedRange staged;
+		while (!ring.tryStage(data, size, alignment, staged)) {
+			if (ring.hasUnsubmitted()) {
+				// The ring is full of this batch's own data, which only comes back once it is submitted
+				submitCommandBuffer();
+				beginCommandBuffer();
+			} else {
+				ring.waitOldest();
+			}
+		}
+
+		stagedBytes += size;
+		uploadCount++;
+		return staged;
+	}
+
+	std::unique_ptr<Buffer> UploadBatch::createBuffer(vk::DeviceSize size, const vk::BufferUsageFlags &usageFlags,
+	                                                  MemoryCategory category)
+	{
+		if (directUploads && size <= MaxDirectBufferSize &&
+		    size <= device->getHeapHeadroom(DirectMemoryProperties) / DirectHeadroomDivisor) {
+			try {
+				return Buffer::unique(device, size, usageFlags, DirectMemoryProperties, category);
+			} catch (std::runtime_error &) {
+				// Out of memory in that heap after all, device local only memory is usually much larger
+			}
+		}
+		return Buffer::unique(device, size, vk::BufferUsageFlagBits::eTransferDst | usageFlags,
+		                      vk::MemoryPropertyFlagBits::eDeviceLocal, category);
+	}
+
+	void UploadBatch::copyToBuffer(const void *data, vk::DeviceSize size, std::unique_ptr<Buffer> &dst,
+	                               vk::DeviceSize dstOffset)
+	{
+		// Not read by the device before the batch is submitted, which makes host writes visible
+		if (dst->getMappedData() != nullptr) {
+			dst->load(dstOffset, data, static_cast<size_t>(size));
+			directBytes += size;
+			uploadCount++;
+			return;
+		}
+
+		for (vk::DeviceSize copied = 0u; copied < size;) {
+			vk::DeviceSize chunk = std::min(size - copied, getMaxStageSize());
+			StagedRange staged = stage(static_cast<const char *>(data) + copied, chunk);
+			vk::BufferCopy region(staged.offset, dst->getOffset() + dstOffset + copied, chunk);
+			getCommandBuffer().copyBuffer(staged.buffer, *(dst->getBuffer()), 1u, &region);
+			copied += chunk;
+		}
+		handOver(*(dst->getBuffer()), dst->getOffset() + dstOffset, size);
+	}
+
+	void UploadBatch::submit()
+	{
+		getCommandBuffer();
+		submitCommandBuffer();
+		if (graphicsCommandBuffer) {
+			graphicsCommandBuffer->end();
+			// Acquires wait at the top of the pipe, but the stage has to cover whatever else was recorded
+			graphicsSubmission = graphicsTimeline.submit(
+				*graphicsCommandBuffer,
+				transferTimeline.waitFor(lastSubmission, vk::PipelineStageFlagBits::eAllCommands));
+		}
+		submitted = true;
+	}
+
+	GpuWait UploadBatch::getReadyWait(const vk::PipelineStageFlags &stage)
+	{
+		if (graphicsSubmission > 0u) {
+			return graphicsTimeline.waitFor(graphicsSubmission, stage);
+		}
+		return transferTimeline.waitFor(lastSubmission, stage);
+	}
+
+	void UploadBatch::wait()
+	{
+		ring.wait(lastSubmission);
+		graphicsTimeline.wait(graphicsSubmission);
+	}
+
+	bool UploadBatch::isComplete()
+	{
+		return submitted && ring.isComplete(lastSubmission) && graphicsTimeline.isComplete(graphicsSubmission);
+	}
+
+	vk::DeviceSize UploadBatch::getStagedBytes()
+	{
+		return stagedBytes;
+	}
+
+	vk::DeviceSize UploadBatch::getDirectBytes()
+	{
+		return directBytes;
+	}
+
+	uint32_t UploadBatch::getUploadCount()
+	{
+		return uploadCount;
+	}
+
+	uint32_t UploadBatch::getSubmissionCount()
+	{
+		return submissionCount + (graphicsCommandBuffer ? 1u : 0u);
+	}
+
+	/******************************************
+	 ***************** private *****************
+	 ******************************************/
+
+	void UploadBatch::beginCommandBuffer()
+	{
+		commandBuffer = ring.acquireCommandBuffer();
+		commandBuffer->begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+	}
+
+	void UploadBatch::submitCommandBuffer()
+	{
+		vk::MemoryBarrier barrier(vk::AccessFlagBits::eTransferWrite,
+		                          vk::AccessFlagBits::eMemoryRead);
+		commandBuffer->pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+		                              vk::PipelineStageFlagBits::eAllCommands,
+		                              vk::DependencyFlags(),
+		                              1u, &barrier,
+		                              0u, nullptr,
+		                              0u, nullptr);
+		commandBuffer->end();
+
+		lastSubmission = ring.submit(std::move(commandBuffer));
+		submissionCount++;
+	}
+
+	// Releases the range of buffer to the graphics family and acquires it there, like the image overload
+	void UploadBatch::handOver(vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize size)
+	{
+		if (!ownershipTransfer) {
+			return;
+		}
+
+		vk::BufferMemoryBarrier release(vk::AccessFlagBits::eTransferWrite, vk::AccessFlags(),
+		                                device->getTransferFamily(), device->getGraphicsFamily(),
+		                                buffer, offset, size);
+		getCommandBuffer().pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+		                                   vk::PipelineStageFlagBits::eBottomOfPipe,
+		                                   vk::DependencyFlags(),
+		                                   0u, nullptr,
+		                                   1u, &release,
+		                                   0u, nullptr);
+
+		vk::BufferMemoryBarrier acquire(vk::AccessFlags(), vk::AccessFlagBits::eMemoryRead,
+		                                device->getTransferFamily(), device->getGraphicsFamily(),
+		                                buffer, offset, size);
+		getGraphicsCommandBuffer().pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,
+		                                           vk::PipelineStageFlagBits::eAllCommands,
+		                                           vk::DependencyFlags(),
+		                                           0u, nullptr,
+		                                           1u, &acquire,
+		                                           0u, nullptr);
+	}
+}
@@ -0,0 +1,121 @@
+#ifndef OBTAIN_GRAPHICS_VULKAN_UPLOAD_BATCH_HPP
+#define OBTAIN_GRAPHICS_VULKAN_UPLOAD_BATCH_HPP
+
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "device.hpp"
+#include "buffer.hpp"
+#include "staging-ring.hpp"
+
+namespace Obtain::Graphics::Vulkan {
+	/*
+	 * Records the uploads of any number of buffers and textures into one command buffer and submits
+	 * them at once. Data is staged in a shared StagingRing; when the ring fills up with this batch's
+	 * own data, what was recorded so far is submitted early so the ring can be recycled, which lets a
+	 * batch upload more than the ring holds. Only one batch may record into a ring at a time.
+	 *
+	 * With direct uploads on, buffers go into memory that is both device local and host visible when
+	 * the device has it (integrated GPUs, resizable BAR) and its heap has room, and are written
+	 * through the mapping without staging or a copy command. Textures always need a copy into
+	 * optimal tiling and are staged either way.
+	 *
+	 * Copies run on the device's transfer queue. With a dedicated transfer family, handed over
+	 * resources are released to the graphics family at the end of their copies and acquired in a
+	 * second command buffer on the graphics queue, which also takes what transfer queues can't do,
+	 * like the blits of mipmap generation. It waits for the copies on the transfer timeline, and
+	 * frames using the uploads wait on getReadyWait, so neither the host nor the graphics queue blocks
+	 * on the copies.
+	 */
+	class UploadBatch {
+	public:
+		// Copies are recorded into command buffers of ring, graphicsPool is for the graphics queue
+		UploadBatch(Device *device, vk::UniqueCommandPool &graphicsPool, StagingRing &ring,
+		            bool directUploads = true);
+
+		// Waits for everything the batch submitted, the command buffers may still be executing
+		~UploadBatch();
+
+		// Records copies into the batch; only valid before submit. Staging may submit early and start a
+		// new command buffer, so fetch it again after every stage.
+		vk::CommandBuffer getCommandBuffer();
+
+		// Records into the graphics queue side of the batch, which runs after every copy and sees the
+		// resources handed over so far; only valid before submit
+		vk::CommandBuffer getGraphicsCommandBuffer();
+
+		// Gives the graphics queue the subresources of image copied so far, which are in layout, for its
+		// transfer commands; recorded after the last copy into them
+		void handOver(vk::Image image, const vk::ImageSubresourceRange &range, const vk::ImageLayout &layout);
+
+		// Largest size stage takes at once, larger uploads have to be split
+		vk::DeviceSize getMaxStageSize();
+
+		// Copies data into staging memory, aligned to alignment
+		StagedRange stage(const void *data, vk::DeviceSize size, vk::DeviceSize alignment = DefaultAlignment);
+
+		// Device local buffer for copyToBuffer, host visible too if it can be written directly and is no
+		// larger than MaxDirectBufferSize
+		std::unique_ptr<Buffer> createBuffer(vk::DeviceSize size, const vk::BufferUsageFlags &usageFlags,
+		                                     MemoryCategory category);
+
+		// Writes host visible buffers through their mapping, stages and copies in chunks of at most
+		// getMaxStageSize and hands the range over to the graphics queue otherwise
+		void copyToBuffer(const void *data, vk::DeviceSize size, std::unique_ptr<Buffer> &dst,
+		                  vk::DeviceSize dstOffset = 0u);
+
+		// Ends recording and submits what's left with a barrier that makes the uploads visible to any
+		// later command
+		void submit();
+
+		// For graphics queue submissions to wait in stage until the uploads are visible to them; valid
+		// after submit
+		GpuWait getReadyWait(const vk::PipelineStageFlags &stage);
+
+		void wait();
+
+		bool isComplete();
+
+		vk::DeviceSize getStagedBytes();
+
+		vk::DeviceSize getDirectBytes();
+
+		uint32_t getUploadCount();
+
+		uint32_t getSubmissionCount();
+
+	private:
+		// Buffer to image copies need offsets that are a multiple of the texel size and of 4
+		static constexpr vk::DeviceSize DefaultAlignment = 16u;
+		// Direct uploads leave at least this share of the heap's headroom to everything else, as on
+		// discrete GPUs without resizable BAR the heap is only 256 MiB
+		static constexpr vk::DeviceSize DirectHeadroomDivisor = 2u;
+		// Larger buffers are long lived pools that the GPU reads every frame, which is faster from device
+		// local only memory, and would take most of a small host visible heap
+		static constexpr vk::DeviceSize MaxDirectBufferSize = 4u * 1024u * 1024u;
+
+		Device *device;
+		vk::UniqueCommandPool &graphicsPool;
+		StagingRing &ring;
+		GpuTimeline &transferTimeline;
+		GpuTimeline &graphicsTimeline;
+		bool ownershipTransfer; // copies run on a family other than graphics
+		vk::UniqueCommandBuffer commandBuffer; // being recorded, the ring keeps submitted ones
+		vk::UniqueCommandBuffer graphicsCommandBuffer; // null until something is recorded into it
+		uint64_t lastSubmission; // on the transfer timeline
+		uint64_t graphicsSubmission; // on the graphics timeline, 0 without a graphics command buffer
+		bool directUploads;
+		vk::DeviceSize stagedBytes;
+		vk::DeviceSize directBytes;
+		uint32_t uploadCount;
+		uint32_t submissionCount; // on the transfer queue
+		bool submitted;
+
+		void beginCommandBuffer();
+		void submitCommandBuffer();
+		void handOver(vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize size);
+	};
+}
+
+#endif // OBTAIN_GRAPHICS_VULKAN_UPLOAD_BATCH_HPP
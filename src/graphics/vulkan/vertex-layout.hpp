@@ -0,0 +1,126 @@
+#ifndef OBTAIN_GRAPHICS_VULKAN_VERTEX_LAYOUT_HPP
+#define OBTAIN_GRAPHICS_VULKAN_VERTEX_LAYOUT_HPP
+
+#include <vulkan/vulkan.hpp>
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Obtain::Graphics::Vulkan {
+	// Normalized 16 bit attribute components, read as floats in [0, 1] by the vertex shader
+	struct Unorm16x2 {
+		uint16_t value[2];
+	};
+
+	struct Unorm16x4 {
+		uint16_t value[4];
+	};
+
+	// Vulkan format of a vertex attribute of type T
+	template<typename T>
+	struct AttributeFormat;
+
+	template<>
+	struct AttributeFormat<glm::vec2> {
+		static constexpr vk::Format value = vk::Format::eR32G32Sfloat;
+	};
+
+	template<>
+	struct AttributeFormat<glm::vec3> {
+		static constexpr vk::Format value = vk::Format::eR32G32B32Sfloat;
+	};
+
+	template<>
+	struct AttributeFormat<glm::vec4> {
+		static constexpr vk::Format value = vk::Format::eR32G32B32A32Sfloat;
+	};
+
+	template<>
+	struct AttributeFormat<Unorm16x2> {
+		static constexpr vk::Format value = vk::Format::eR16G16Unorm;
+	};
+
+	template<>
+	struct AttributeFormat<Unorm16x4> {
+		static constexpr vk::Format value = vk::Format::eR16G16B16A16Unorm;
+	};
+
+	// One shader input: its location, member type and offset within the vertex
+	template<uint32_t Location, typename T, size_t Offset>
+	struct VertexAttribute {
+		static constexpr uint32_t location = Location;
+		static constexpr vk::Format format = AttributeFormat<T>::value;
+		static constexpr uint32_t offset = static_cast<uint32_t>(Offset);
+		static constexpr uint32_t size = sizeof(T);
+	};
+
+	// What createGraphicsPipeline needs to know about a vertex format
+	struct VertexInputDescription {
+		vk::VertexInputBindingDescription binding;
+		std::vector<vk::VertexInputAttributeDescription> attributes;
+	};
+
+	// Turns normalized attributes back into model space positions and texture coordinates:
+	// position = positionOffset + attribute * positionScale, likewise with texCoordTransform (xy scale,
+	// zw offset). Identity for float formats.
+	struct VertexDequantization {
+		glm::vec4 positionScale;
+		glm::vec4 positionOffset;
+		glm::vec4 texCoordTransform;
+
+		static VertexDequantization identity()
+		{
+			return {glm::vec4(1.0f, 1.0f, 1.0f, 1.0f), glm::vec4(0.0f, 0.0f, 0.0f, 0.0f),
+			        glm::vec4(1.0f, 1.0f, 0.0f, 0.0f)};
+		}
+	};
+
+	// Everything the pipeline and the uniforms need to draw a vertex buffer of some format
+	struct VertexFormat {
+		VertexInputDescription input;
+		std::string vertexShader;
+		VertexDequantization dequantization;
+	};
+
+	/*
+	 * Type level description of the vertex input of one vertex struct, binding 0, one attribute per
+	 * member. The attribute table is expanded from the template arguments, so adding a vertex format
+	 * is a using declaration next to the struct instead of hand written descriptions that can drift
+	 * from it.
+	 */
+	template<typename V, typename... Attributes>
+	class VertexLayout {
+	public:
+		static constexpr uint32_t stride = sizeof(V);
+		static constexpr size_t attributeCount = sizeof...(Attributes);
+
+		static_assert(((Attributes::offset + Attributes::size <= sizeof(V)) && ...),
+		              "vertex attribute lies outside the vertex");
+
+		static vk::VertexInputBindingDescription getBindingDescription()
+		{
+			return vk::VertexInputBindingDescription(0, stride, vk::VertexInputRate::eVertex);
+		}
+
+		// The C structs, which are literal types whatever vulkan.hpp marks constexpr
+		static constexpr std::array<VkVertexInputAttributeDescription, attributeCount> getAttributeDescriptions()
+		{
+			return {{VkVertexInputAttributeDescription{Attributes::location, 0,
+			                                           static_cast<VkFormat>(Attributes::format),
+			                                           Attributes::offset}...}};
+		}
+
+		static VertexInputDescription describe()
+		{
+			static constexpr auto attributes = getAttributeDescriptions();
+			return {getBindingDescription(), {attributes.begin(), attributes.end()}};
+		}
+	};
+}
+
+#endif // OBTAIN_GRAPHICS_VULKAN_VERTEX_LAYOUT_HPP
@@ -0,0 +1,128 @@
+#ifndef OBTAIN_GRAPHICS_VULKAN_VERTEX_TABLE_HPP
+#define OBTAIN_GRAPHICS_VULKAN_VERTEX_TABLE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "../../utils/hash.hpp"
+
+namespace Obtain::Graphics::Vulkan {
+	/*
+	 * Deduplicates vertices by their raw bytes. Open addressing with linear probing over a flat,
+	 * power-of-two sized slot array; each slot caches the upper hash bits next to the vertex index so
+	 * most mismatches are rejected without touching the vertex data. Sized up front for the number of
+	 * vertices that will be offered, so a lookup-or-insert is a single probe sequence with no rehashing.
+	 */
+	template<typename V>
+	class VertexTable {
+	public:
+		explicit VertexTable(size_t expectedCount)
+			: probes(0u), collisions(0u), longestProbe(0u), size(0u)
+		{
+			size_t capacity = 16u;
+			// Stay below a load factor of 0.5 even if every offered vertex turns out to be unique
+			while (capacity < expectedCount * 2u) {
+				capacity *= 2u;
+			}
+			slots.assign(capacity, Slot{0u, Empty});
+			mask = capacity - 1u;
+		}
+
+		// Returns the index of the vertex in vertices, appending it first if it is not there yet
+		uint32_t insert(const V &vertex, std::vector<V> &vertices)
+		{
+			if ((size + 1u) * 4u > slots.size() * 3u) {
+				grow(vertices);
+			}
+
+			uint64_t hash = Hash::bytes(&vertex, sizeof(V));
+			auto tag = static_cast<uint32_t>(hash >> 32u);
+			size_t slot = static_cast<size_t>(hash) & mask;
+			size_t probe = 0u;
+
+			while (true) {
+				probes++;
+				Slot &candidate = slots[slot];
+
+				if (candidate.index == Empty) {
+					candidate = Slot{tag, static_cast<uint32_t>(vertices.size())};
+					vertices.emplace_back(vertex);
+					size++;
+					longestProbe = std::max(longestProbe, probe);
+					return candidate.index;
+				}
+
+				if (candidate.tag == tag && memcmp(&vertices[candidate.index], &vertex, sizeof(V)) == 0) {
+					longestProbe = std::max(longestProbe, probe);
+					return candidate.index;
+				}
+
+				collisions++;
+				probe++;
+				slot = (slot + 1u) & mask;
+			}
+		}
+
+		// Slots inspected over all inserts, including the one that matched or was empty
+		size_t getProbeCount() const
+		{
+			return probes;
+		}
+
+		// Slots inspected that held a different vertex
+		size_t getCollisionCount() const
+		{
+			return collisions;
+		}
+
+		size_t getLongestProbe() const
+		{
+			return longestProbe;
+		}
+
+		size_t getCapacity() const
+		{
+			return slots.size();
+		}
+
+	private:
+		struct Slot {
+			uint32_t tag;
+			uint32_t index;
+		};
+
+		static const uint32_t Empty = 0xFFFFFFFFu;
+
+		std::vector<Slot> slots;
+		size_t mask;
+		size_t probes;
+		size_t collisions;
+		size_t longestProbe;
+		size_t size;
+
+		// Only reached when more vertices are offered than the table was sized for
+		void grow(const std::vector<V> &vertices)
+		{
+			std::vector<Slot> old;
+			old.swap(slots);
+			slots.assign(old.size() * 2u, Slot{0u, Empty});
+			mask = slots.size() - 1u;
+
+			for (const auto &entry : old) {
+				if (entry.index == Empty) {
+					continue;
+				}
+				uint64_t hash = Hash::bytes(&vertices[entry.index], sizeof(V));
+				size_t slot = static_cast<size_t>(hash) & mask;
+				while (slots[slot].index != Empty) {
+					slot = (slot + 1u) & mask;
+				}
+				slots[slot] = entry;
+			}
+		}
+	};
+}
+
+#endif // OBTAIN_GRAPHICS_VULKAN_VERTEX_TABLE_HPP
@@ -13,6 +13,10 @@
 #include <glm/gtx/hash.hpp>
 
 #include <array>
+#include <cstring>
+
+#include "../../utils/hash.hpp"
+#include "vertex-layout.hpp"
 
 namespace Obtain::Graphics::Vulkan {
 	struct Vertex {
@@ -20,29 +24,6 @@ namespace Obtain::Graphics::Vulkan {
 		glm::vec3 color;
 		glm::vec2 texCoord;
 
-		static vk::VertexInputBindingDescription getBindingDescription()
-		{
-			vk::VertexInputBindingDescription bindingDescription = {};
-			bindingDescription.binding = 0;
-			bindingDescription.stride = sizeof(Vertex);
-			bindingDescription.inputRate = vk::VertexInputRate::eVertex;
-			return bindingDescription;
-		}
-
-		static std::array<vk::VertexInputAttributeDescription, 3> getAttributeDescriptions()
-		{
-			std::array<vk::VertexInputAttributeDescription, 3> attributeDescriptions = {
-				vk::VertexInputAttributeDescription(0, 0,
-				                                    vk::Format::eR32G32B32Sfloat, offsetof(Vertex, pos)),
-				vk::VertexInputAttributeDescription(1, 0,
-				                                    vk::Format::eR32G32B32Sfloat, offsetof(Vertex, color)),
-				vk::VertexInputAttributeDescription(2, 0,
-				                                    vk::Format::eR32G32Sfloat, offsetof(Vertex, texCoord))
-			};
-
-			return attributeDescriptions;
-		}
-
 		float distance(Vertex v)
 		{
 			float dx = pos.x - v.pos
@@ -55,11 +36,19 @@ namespace Obtain::Graphics::Vulkan {
 			return (float) sqrt(dx * dx + dy * dy + dz * dz);
 		}
 
+		// Vertices are compared and hashed by their bytes, which keeps both consistent for -0.0 and NaN
 		bool operator==(const Vertex &other) const
 		{
-			return pos == other.pos && color == other.color && texCoord == other.texCoord;
+			return memcmp(this, &other, sizeof(Vertex)) == 0;
 		}
 	};
+
+	static_assert(sizeof(Vertex) == 8 * sizeof(float), "Vertex must not contain padding");
+
+	using StandardVertexLayout = VertexLayout<Vertex,
+		VertexAttribute<0, glm::vec3, offsetof(Vertex, pos)>,
+		VertexAttribute<1, glm::vec3, offsetof(Vertex, color)>,
+		VertexAttribute<2, glm::vec2, offsetof(Vertex, texCoord)>>;
 }
 
 
@@ -68,9 +57,7 @@ namespace std {
 	struct hash<Obtain::Graphics::Vulkan::Vertex> {
 		size_t operator()(Obtain::Graphics::Vulkan::Vertex const &vertex) const
 		{
-			return ((hash<glm::vec3>()(vertex.pos) ^
-			         (hash<glm::vec3>()(vertex.color) << 1U)) >> 1U) ^
-			       (hash<glm::vec2>()(vertex.texCoord) << 1U);
+			return static_cast<size_t>(Obtain::Hash::bytes(&vertex, sizeof(vertex)));
 		}
 	};
 }
@@ -1,7 +1,11 @@
 #include "vulkan-renderer.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <vector>
 #include <iostream>
+#include <chrono>
+#include <thread>
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -12,6 +16,8 @@
 #include "device.hpp"
 #include "queue-family-indices.hpp"
 #include "command.hpp"
+#include "upload-batch.hpp"
+#include "../../utils/time.hpp"
 
 namespace Obtain::Graphics::Vulkan {
 	/******************************************
@@ -31,39 +37,60 @@ namespace Obtain::Graphics::Vulkan {
 		graphicsQueue = device->getGraphicsQueue();
 		presentationQueue = device->getPresentQueue();
 
-		commandPool = device->createCommandPool();
-
-		obj = Object::unique(device, commandPool, "chalet.obj", "chalet.jpg");
-
-		sampler = obj->getTextureImage()->createSampler();
+		commandPool = device->createCommandPool(vk::CommandPoolCreateFlagBits::eResetCommandBuffer);
+		workers = std::make_unique<WorkerPool>(std::max(1u, std::thread::hardware_concurrency()));
+		commandBuffers = CommandBufferManager::unique(device, CommandFrameCount, workers->getThreadCount());
+		stagingRing = StagingRing::unique(device, StagingRingSize);
 
+		if (BenchmarkUploads) {
+			benchmarkUploads();
+		}
 
+		// Every mesh is uploaded in a batch of its own, in as few submissions as the staging ring allows and on
+		// the transfer queue where there is one; frames wait on the GPU for the meshes they draw instead of the
+		// host waiting for the whole scene here
+		uploadStart = std::chrono::high_resolution_clock::now();
+		loadMesh("chalet.obj", "chalet.jpg", PackVertices);
+		if (BenchmarkVertexFormats) {
+			loadMesh("chalet.obj", "chalet.jpg", !PackVertices);
+		}
+		materials.push_back(meshes[0]->getTextureImage().get());
+		materialMeshes.push_back(0u);
 
-		vertexBuffer = createAndLoadBuffer(static_cast<vk::DeviceSize>(obj->getVertexBufferSize()),
-		                                   vk::BufferUsageFlagBits::eVertexBuffer, obj->getVertices().data());
+		sampler = meshes[0]->getTextureImage()->createSampler();
 
-		indexBuffer = createAndLoadBuffer(static_cast<vk::DeviceSize>(obj->getIndexBufferSize()),
-		                                  vk::BufferUsageFlagBits::eIndexBuffer, obj->getIndices().data());
+		recreateSwapchain();
 
-		swapchain = new Swapchain(
-			device,
-			device->getWindowSize(),
-			indices,
-			commandPool,
-			vertexBuffer,
-			indexBuffer,
-			obj->getTextureImage(),
-			sampler
-		);
+		defragmenter = Defragmenter::unique(device, *commandBuffers);
 
+		if (BenchmarkRecording) {
+			// The scene is a single item, which one thread records; a grid of copies gives every thread
+			// slices of many draws
+			auto columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(BenchmarkDrawItems))));
+			DrawList grid;
+			for (uint32_t i = 0; i < BenchmarkDrawItems; i++) {
+				grid.add(0, 0, glm::translate(glm::mat4(1.0f),
+				                              glm::vec3(static_cast<float>(i % columns) - 0.5f * columns,
+				                                        static_cast<float>(i / columns) - 0.5f * columns,
+				                                        0.0f)));
+			}
+			grid.sort();
+			swapchain->benchmarkRecording(grid, BenchmarkRepetitions);
+		}
 	}
 
 	VulkanRenderer::~VulkanRenderer()
 	{
-		obj.reset();
+		uploads.clear();
+		defragmenter.reset();
+		// The swapchain's secondaries are freed into the manager's pools
 		delete (swapchain);
-		vertexBuffer.reset();
-		indexBuffer.reset();
+		commandBuffers.reset();
+		materials.clear();
+		meshes.clear();
+		workers.reset();
+		geometryPool.reset();
+		stagingRing.reset();
 		commandPool.reset();
 		sampler.reset();
 		delete(device);
@@ -73,94 +100,269 @@ namespace Obtain::Graphics::Vulkan {
 	{
 		while (device->windowOpen()) {
 			glfwPollEvents();
-			drawFrame();
-			bool drawSuccess = swapchain->submitFrame(*graphicsQueue, *presentationQueue);
-			if (device->getResizeFlag() || !drawSuccess) {
-				updateWindowSize();
+			updateScene();
+			drawFrame(scene);
+			if (BenchmarkVertexFormats && uploads.empty()) {
+				benchmarkVertexFormats();
 			}
 		}
 
 		device->waitIdle();
 	}
 
+	void VulkanRenderer::drawFrame(DrawList &drawList)
+	{
+		beginFrame();
+		drawList.sort();
+
+		bool drawSuccess;
+		if (!uploads.empty()) {
+			// Frames wait on the GPU for the meshes and materials they draw until they are uploaded
+			drawSuccess = swapchain->submitFrame(*presentationQueue, drawList, getUploadWaits(drawList));
+		} else {
+			drawSuccess = swapchain->submitFrame(*presentationQueue, drawList);
+		}
+		if (device->getResizeFlag() || !drawSuccess) {
+			updateWindowSize();
+		}
+	}
+
 	/******************************************
 	 ***************** private *****************
 	 ******************************************/
 
-	void VulkanRenderer::drawFrame()
+	void VulkanRenderer::beginFrame()
 	{
+		// Driver allocations while recording and submitting the previous frame
+		device->getHostAllocator().endFrame();
+		commandBuffers->nextFrame();
+		if (++frameCount % MemoryLogInterval == 0) {
+			logMemoryUsage();
+		}
 
+		if (!uploads.empty()) {
+			if (std::all_of(uploads.begin(), uploads.end(),
+			                [](const std::unique_ptr<UploadBatch> &batch) { return batch->isComplete(); })) {
+				finishUploads();
+			}
+			return;
+		}
+
+		// Buffers moved out of their memory are referred to until every image's secondaries are rewritten
+		if (!swapchain->hasStaleCommandBuffers()) {
+			defragmenter->releaseRetired();
+		}
+		if (defragmenter->step(DefragmentationBudget)) {
+			swapchain->invalidateCommandBuffers();
+		}
+	}
+
+	void VulkanRenderer::finishUploads()
+	{
+		if (LogLoadStatistics) {
+			logLoadStatistics();
+		}
+		uploads.clear();
+
+		// Moving a buffer while it's still being written would lose the upload
+		defragmenter->add(*geometryPool);
+		for (auto &mesh : meshes) {
+			if (mesh->getMeshletBuffer()) {
+				defragmenter->add(mesh->getMeshletBuffer());
+			}
+		}
+	}
+
+	void VulkanRenderer::loadMesh(const std::string &modelPath, const std::string &texturePath, bool packVertices)
+	{
+		uploads.push_back(std::make_unique<UploadBatch>(device, commandPool, *stagingRing, DirectUploads));
+		UploadBatch &batch = *uploads.back();
+		if (!geometryPool) {
+			geometryPool = GeometryPool::unique(batch, VertexPoolSize, IndexPoolSize);
+		}
+		meshes.push_back(Object::unique(device, batch, *geometryPool, modelPath, texturePath, packVertices));
+		batch.submit();
+	}
+
+	std::vector<GpuWait> VulkanRenderer::getUploadWaits(const DrawList &drawList)
+	{
+		std::vector<bool> drawn(uploads.size(), false);
+		for (const auto &item : drawList.getItems()) {
+			drawn[item.mesh] = true;
+			drawn[materialMeshes[item.material]] = true;
+		}
+
+		// Timeline values only grow, so of the batches finishing on one semaphore the latest is waited for
+		std::vector<GpuWait> waits;
+		for (size_t i = 0; i < uploads.size(); i++) {
+			if (!drawn[i] || uploads[i]->isComplete()) {
+				continue;
+			}
+			GpuWait wait = uploads[i]->getReadyWait(Swapchain::getSceneReadStages());
+			auto same = std::find_if(waits.begin(), waits.end(),
+			                         [&wait](const GpuWait &other) { return other.semaphore == wait.semaphore; });
+			if (same == waits.end()) {
+				waits.push_back(wait);
+			} else {
+				same->value = std::max(same->value, wait.value);
+			}
+		}
+		return waits;
+	}
+
+	void VulkanRenderer::logLoadStatistics()
+	{
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - uploadStart;
+		uint32_t uploadCount = 0u;
+		uint32_t submissionCount = 0u;
+		vk::DeviceSize stagedBytes = 0u;
+		vk::DeviceSize directBytes = 0u;
+		for (auto &batch : uploads) {
+			uploadCount += batch->getUploadCount();
+			submissionCount += batch->getSubmissionCount();
+			stagedBytes += batch->getStagedBytes();
+			directBytes += batch->getDirectBytes();
+		}
+
+		std::cout << "loaded scene in " << elapsed.count() << " ms, " << uploadCount << " uploads in "
+		          << uploads.size() << " batches, " << stagedBytes / 1024u << " KiB staged in "
+		          << submissionCount << " submissions from " << stagingRing->getCommandBufferCount()
+		          << " command buffers and " << directBytes / 1024u
+		          << " KiB written directly, "
+		          << (device->hasDedicatedTransferQueue() ? "on a dedicated transfer queue" : "on the graphics queue")
+		          << std::endl;
+		std::cout << "geometry pool: " << geometryPool->getUsedBytes() / 1024u << " of "
+		          << geometryPool->getCapacity() / 1024u << " KiB used" << std::endl;
+
+		auto heaps = device->getMemoryStatistics();
+		for (size_t i = 0; i < heaps.size(); i++) {
+			if (heaps[i].blockCount > 0u) {
+				std::cout << "memory heap " << i << ": " << heaps[i].usedBytes / 1024u << " of "
+				          << heaps[i].blockBytes / 1024u << " KiB used by " << heaps[i].allocationCount
+				          << " allocations in " << heaps[i].blockCount << " blocks, fragmentation "
+				          << heaps[i].fragmentation << std::endl;
+			}
+		}
+		logMemoryUsage();
+	}
+
+	// Loads the scene into pools and objects of its own, alternating between direct and staged uploads so
+	// both get the same file caches, and times each load until it completed on the GPU
+	void VulkanRenderer::benchmarkUploads()
+	{
+		std::chrono::duration<double, std::milli> elapsed[2]{};
+		vk::DeviceSize directBytes = 0u;
+		for (uint32_t i = 0; i < 2u * BenchmarkLoads; i++) {
+			bool direct = i % 2u == 0u;
+			auto start = std::chrono::high_resolution_clock::now();
+
+			UploadBatch batch(device, commandPool, *stagingRing, direct);
+			auto pool = GeometryPool::unique(batch, VertexPoolSize, IndexPoolSize);
+			auto mesh = Object::unique(device, batch, *pool, "chalet.obj", "chalet.jpg", PackVertices);
+			batch.submit();
+			batch.wait();
+
+			elapsed[direct] += std::chrono::high_resolution_clock::now() - start;
+			if (direct) {
+				directBytes = batch.getDirectBytes();
+			}
+		}
+
+		std::cout << "scene load with direct uploads: " << elapsed[1].count() / BenchmarkLoads << " ms, "
+		          << directBytes / 1024u << " KiB written directly" << std::endl;
+		std::cout << "scene load staged: " << elapsed[0].count() / BenchmarkLoads << " ms" << std::endl;
+	}
+
+	// The chalet, spinning a quarter turn per second
+	void VulkanRenderer::updateScene()
+	{
+		scene.clear();
+		scene.add(0, 0, glm::rotate(glm::mat4(1.0f),
+		                            Time::elapsedTime() * glm::radians(90.0f),
+		                            glm::vec3(0.0f, 0.0f, 1.0f)));
 	}
 
 	void VulkanRenderer::updateWindowSize()
 	{
 		device->updateWindowSizeOnceVisible();
+		recreateSwapchain();
+		device->resetResizeFlag();
+	}
 
+	void VulkanRenderer::recreateSwapchain()
+	{
 		delete (swapchain);
 		swapchain = new Swapchain(
 			device,
 			device->getWindowSize(),
 			indices,
 			commandPool,
-			vertexBuffer,
-			indexBuffer,
-			obj->getTextureImage(),
+			*commandBuffers,
+			*workers,
+			geometryPool,
+			meshes,
+			materials,
 			sampler
 		);
-
-		device->resetResizeFlag();
 	}
 
-	std::unique_ptr<Buffer> VulkanRenderer::createAndLoadBuffer(vk::DeviceSize size, vk::BufferUsageFlags usageFlags,
-	                                                            void *data)
+	void VulkanRenderer::benchmarkVertexFormats()
 	{
-		Buffer stagingBuffer = Buffer(
-			device,
-			size,
-			vk::BufferUsageFlagBits::eTransferSrc,
-			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
-		);
-
-		stagingBuffer.load(0u, data, static_cast<size_t>(size));
-
-		std::unique_ptr<Buffer> newBuffer = std::make_unique<Buffer>(
-			Buffer(
-				device,
-				size,
-				vk::BufferUsageFlagBits::eTransferDst | usageFlags,
-				vk::MemoryPropertyFlagBits::eDeviceLocal
-			)
-		);
+		// The first frame of a format is still waiting for the pipeline and secondaries
+		auto now = std::chrono::high_resolution_clock::now();
+		if (benchmarkFrame++ == 0u) {
+			benchmarkStart = now;
+			return;
+		}
+		if (benchmarkFrame <= BenchmarkFrames) {
+			return;
+		}
 
-		copyBuffer(
-			stagingBuffer.getBuffer(), 0u,
-			newBuffer->getBuffer(), 0u,
-			size
-		);
+		std::chrono::duration<double, std::milli> elapsed = now - benchmarkStart;
+		std::cout << meshes[0]->getVertexFormat().input.binding.stride << " byte vertices: "
+		          << elapsed.count() / BenchmarkFrames << " ms per frame" << std::endl;
 
-		return newBuffer;
+		// The scene draws mesh 0, the swapchain's pipeline is made for its vertex format
+		std::swap(meshes[0], meshes[1]);
+		recreateSwapchain();
+		benchmarkFrame = 0u;
 	}
 
-	void VulkanRenderer::copyBuffer(
-		vk::UniqueBuffer &src, vk::DeviceSize srcOffset, vk::UniqueBuffer &dst, vk::DeviceSize dstOffset,
-		vk::DeviceSize size
-	)
+	void VulkanRenderer::logMemoryUsage()
 	{
-		vk::BufferCopy region(srcOffset, dstOffset, size);
-
-		auto action = [
-			&src,
-			&dst,
-			&region
-		](vk::CommandBuffer commandBuffer) {
-			commandBuffer.copyBuffer(
-				*src,
-				*dst,
-				1u,
-				&region
-			);
+		static const char *categoryNames[MemoryCategoryCount] = {
+			"geometry", "textures", "attachments", "uniforms", "staging"
+		};
+		static const char *scopeNames[HostAllocator::ScopeCount] = {
+			"command", "object", "cache", "device", "instance"
 		};
 
-		Command::runSingleTime(device, commandPool, *graphicsQueue, action);
+		auto budgets = device->getMemoryBudgets();
+		for (size_t i = 0; i < budgets.size(); i++) {
+			std::cout << "memory heap " << i << ": " << budgets[i].usage / (1024u * 1024u) << " of "
+			          << budgets[i].budget / (1024u * 1024u) << " MiB budget used"
+			          << (device->hasMemoryBudget() ? "" : " (heap size)") << std::endl;
+		}
+
+		auto categories = device->getMemoryCategoryStatistics();
+		for (size_t i = 0; i < MemoryCategoryCount; i++) {
+			std::cout << "memory " << categoryNames[i] << ": " << categories[i].bytes / 1024u << " KiB in "
+			          << categories[i].allocationCount << " allocations, peak " << categories[i].peakBytes / 1024u
+			          << " KiB" << std::endl;
+		}
+
+		std::cout << "defragmenter: " << defragmenter->getMoveCount() << " buffers and mesh ranges moved, "
+		          << defragmenter->getMovedBytes() / 1024u << " KiB copied" << std::endl;
+
+		std::cout << "command buffers: " << commandBuffers->getAllocationCount() << " allocated for "
+		          << CommandFrameCount << " frames on " << commandBuffers->getThreadCount() << " threads" << std::endl;
+
+		auto scopes = device->getHostAllocator().getStatistics();
+		for (size_t i = 0; i < HostAllocator::ScopeCount; i++) {
+			std::cout << "driver host memory, " << scopeNames[i] << " scope: " << scopes[i].bytes / 1024u
+			          << " KiB, peak " << scopes[i].peakBytes / 1024u << " KiB, " << scopes[i].allocationCount
+			          << " allocations, " << scopes[i].frameAllocationCount << " in the last frame, "
+			          << scopes[i].internalBytes / 1024u << " KiB internal" << std::endl;
+		}
 	}
 }
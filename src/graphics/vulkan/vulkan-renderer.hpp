@@ -5,6 +5,7 @@
 
 #include <GLFW/glfw3.h>
 #include <vulkan/vulkan.hpp>
+#include <chrono>
 
 #include "../renderer.hpp"
 #include "swapchain.hpp"
@@ -12,6 +13,13 @@
 #include "buffer.hpp"
 #include "device.hpp"
 #include "image.hpp"
+#include "upload-batch.hpp"
+#include "staging-ring.hpp"
+#include "geometry-pool.hpp"
+#include "defragmenter.hpp"
+#include "command-buffer-manager.hpp"
+#include "draw-list.hpp"
+#include "../../utils/worker-pool.hpp"
 
 namespace Obtain::Graphics::Vulkan {
 	class VulkanRenderer : public Renderer {
@@ -26,8 +34,29 @@ namespace Obtain::Graphics::Vulkan {
 
 		void run();
 
+		// Sorts drawList and draws it; meshes and materials are indices into the ones loaded with the scene
+		void drawFrame(DrawList &drawList);
+
 	private:
-		std::unique_ptr<Object> obj;
+		// Draw with 12 byte PackedVertex instead of the 32 byte Vertex
+		static const bool PackVertices = true;
+		// Load every mesh in both vertex formats and switch the scene between them every BenchmarkFrames
+		// frames, logging the mean frame time of each
+		static const bool BenchmarkVertexFormats = false;
+		static const uint32_t BenchmarkFrames = 2000;
+		uint32_t benchmarkFrame = 0;
+		std::chrono::high_resolution_clock::time_point benchmarkStart;
+		// Write buffers straight into device local, host visible memory when there is some
+		static const bool DirectUploads = true;
+		// Load the scene BenchmarkLoads times with direct uploads and as many times staged on startup, and
+		// log the mean load time of each
+		static const bool BenchmarkUploads = false;
+		static const uint32_t BenchmarkLoads = 5;
+
+		// Draw lists refer to these by index
+		std::vector<std::unique_ptr<Object>> meshes;
+		std::vector<Image *> materials;
+		DrawList scene;
 
 		QueueFamilyIndices indices;
 
@@ -36,24 +65,76 @@ namespace Obtain::Graphics::Vulkan {
 		vk::Queue *graphicsQueue;
 		vk::Queue *presentationQueue;
 
-		Swapchain *swapchain;
+		Swapchain *swapchain = nullptr;
+		// Resets single command buffers, for the swapchain's which are recorded again when stale
 		vk::UniqueCommandPool commandPool;
 
+		// One recording thread per hardware thread
+		std::unique_ptr<WorkerPool> workers;
+		// Command buffers recorded every frame come from pools of this many frames, one per worker thread
+		static const uint32_t CommandFrameCount = 2;
+		std::unique_ptr<CommandBufferManager> commandBuffers;
+		// Log how recording the swapchain's command buffers scales with the worker threads on startup, for a
+		// grid of BenchmarkDrawItems copies of the first mesh; waits for the scene's uploads first
+		static const bool BenchmarkRecording = false;
+		static const uint32_t BenchmarkRepetitions = 20;
+		static const uint32_t BenchmarkDrawItems = 4096;
+
+		// Staging memory of all uploads, bounded no matter how much is streamed
+		static constexpr vk::DeviceSize StagingRingSize = 32u * 1024u * 1024u;
+		std::unique_ptr<StagingRing> stagingRing;
+
+		// The scene's uploads, a batch per mesh so frames only wait for the meshes they draw, kept until all
+		// of them complete while the first frames are rendered
+		std::vector<std::unique_ptr<UploadBatch>> uploads;
+		// Mesh, and so upload batch, each material's texture is loaded with
+		std::vector<uint32_t> materialMeshes;
+		std::chrono::high_resolution_clock::time_point uploadStart;
+		// Log how long the scene took to load, how it was uploaded and where its memory went
+		static const bool LogLoadStatistics = false;
+
 		vk::UniqueSampler sampler;
 
-		std::unique_ptr<Buffer>  vertexBuffer;
-		std::unique_ptr<Buffer>  indexBuffer;
+		// Vertices and indices of every mesh, bound once for all draws
+		static constexpr vk::DeviceSize VertexPoolSize = 64u * 1024u * 1024u;
+		static constexpr vk::DeviceSize IndexPoolSize = 32u * 1024u * 1024u;
+		std::unique_ptr<GeometryPool> geometryPool;
+
+		// Static buffers are moved into fuller memory blocks with at most this many bytes copied per frame
+		static constexpr vk::DeviceSize DefragmentationBudget = 4u * 1024u * 1024u;
+		std::unique_ptr<Defragmenter> defragmenter;
+
+		// Memory budgets and usage per category are logged every this many frames
+		static const uint32_t MemoryLogInterval = 1000;
+		uint32_t frameCount = 0;
+
+		// Frame housekeeping before anything is recorded
+		void beginFrame();
+
+		void updateScene();
 
-		void drawFrame();
+		// Lets the defragmenter have the buffers once the scene's uploads are complete
+		void finishUploads();
+
+		// Uploads a mesh and its texture in a batch of their own, into the geometry pool which the first
+		// batch creates
+		void loadMesh(const std::string &modelPath, const std::string &texturePath, bool packVertices);
+
+		// Waits of a frame drawing drawList for the uploads of its meshes and materials not complete yet
+		std::vector<GpuWait> getUploadWaits(const DrawList &drawList);
+
+		void logLoadStatistics();
+
+		void benchmarkUploads();
 
 		void updateWindowSize();
 
-		std::unique_ptr<Buffer> createAndLoadBuffer(vk::DeviceSize size, vk::BufferUsageFlags usageFlags, void *data);
+		void recreateSwapchain();
 
-		void copyBuffer(
-			vk::UniqueBuffer &src, vk::DeviceSize srcOffset, vk::UniqueBuffer &dst, vk::DeviceSize dstOffset,
-			vk::DeviceSize size
-		);
+		// Counts frames of the current vertex format and switches to the other after BenchmarkFrames
+		void benchmarkVertexFormats();
+
+		void logMemoryUsage();
 	};
 }
 
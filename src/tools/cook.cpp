@@ -0,0 +1,287 @@
+//
+// Created by agent on 10/17/26.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+
+#include "../graphics/vulkan/model.hpp"
+#include "../graphics/vulkan/obj-parser.hpp"
+#include "../graphics/vulkan/vertex-table.hpp"
+#include "../utils/mapped-file.hpp"
+
+using Obtain::Graphics::Vulkan::Model;
+using Obtain::Graphics::Vulkan::ModelStatistics;
+using Obtain::Graphics::Vulkan::ObjData;
+using Obtain::Graphics::Vulkan::ObjParser;
+using Obtain::Graphics::Vulkan::Vertex;
+using Obtain::Graphics::Vulkan::VertexTable;
+
+namespace {
+	template<typename Function>
+	double bestOf(int runs, Function function)
+	{
+		double best = 0.0;
+		for (int i = 0; i < runs; i++) {
+			auto start = std::chrono::high_resolution_clock::now();
+			function();
+			std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+			best = i == 0 ? elapsed.count() : std::min(best, elapsed.count());
+		}
+		return best;
+	}
+
+	bool matches(const tinyobj::attrib_t &attributes, const std::vector<tinyobj::shape_t> &shapes, const ObjData &obj)
+	{
+		if (attributes.vertices != obj.vertices || attributes.texcoords != obj.texcoords ||
+		    attributes.normals != obj.normals || shapes.size() != obj.shapes.size()) {
+			return false;
+		}
+
+		for (size_t i = 0; i < shapes.size(); i++) {
+			const auto &expected = shapes[i].mesh.indices;
+			const auto &actual = obj.shapes[i].indices;
+			if (expected.size() != actual.size()) {
+				return false;
+			}
+			for (size_t j = 0; j < expected.size(); j++) {
+				if (expected[j].vertex_index != actual[j].vertex ||
+				    expected[j].texcoord_index != actual[j].texcoord ||
+				    expected[j].normal_index != actual[j].normal) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	// The glm based hash Vertex used before it hashed raw bytes, kept for comparison
+	struct LegacyVertexHash {
+		size_t operator()(const Vertex &vertex) const
+		{
+			return ((std::hash<glm::vec3>()(vertex.pos) ^
+			         (std::hash<glm::vec3>()(vertex.color) << 1U)) >> 1U) ^
+			       (std::hash<glm::vec2>()(vertex.texCoord) << 1U);
+		}
+	};
+
+	// Entries that share a bucket with another entry
+	template<typename Map>
+	size_t bucketCollisions(const Map &map)
+	{
+		size_t collisions = 0u;
+		for (size_t bucket = 0; bucket < map.bucket_count(); bucket++) {
+			size_t size = map.bucket_size(bucket);
+			collisions += size > 1u ? size - 1u : 0u;
+		}
+		return collisions;
+	}
+
+	template<typename Hasher>
+	double mapDeduplicate(const std::vector<Vertex> &corners, std::vector<uint32_t> &indices,
+	                      const std::string &label)
+	{
+		std::unordered_map<Vertex, uint32_t, Hasher> uniqueVertices;
+		std::vector<Vertex> vertices;
+		double time = bestOf(1, [&]() {
+			for (const auto &vertex : corners) {
+				if (uniqueVertices.count(vertex) == 0) {
+					uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
+					vertices.emplace_back(vertex);
+				}
+				indices.emplace_back(uniqueVertices[vertex]);
+			}
+		});
+
+		std::cout << "\t" << label << time * 1000.0 << " ms, " << vertices.size() << " vertices, "
+		          << bucketCollisions(uniqueVertices) << " entries in shared buckets" << std::endl;
+		return time;
+	}
+
+	// Compares vertex deduplication through std::unordered_map against VertexTable
+	bool benchmarkDeduplication(const ObjData &obj)
+	{
+		std::vector<Vertex> corners;
+		for (const auto &shape : obj.shapes) {
+			for (const auto &index : shape.indices) {
+				Vertex vertex = {};
+				vertex.pos = {
+					obj.vertices[3 * index.vertex],
+					obj.vertices[3 * index.vertex + 1],
+					obj.vertices[3 * index.vertex + 2]
+				};
+				if (index.texcoord >= 0) {
+					vertex.texCoord = {
+						obj.texcoords[2 * index.texcoord],
+						1.0f - obj.texcoords[2 * index.texcoord + 1]
+					};
+				}
+				vertex.color = {1.0f, 1.0f, 1.0f};
+				corners.emplace_back(vertex);
+			}
+		}
+
+		std::vector<uint32_t> legacyIndices, mapIndices, tableIndices;
+		mapDeduplicate<LegacyVertexHash>(corners, legacyIndices, "unordered_map, glm hash:  ");
+		mapDeduplicate<std::hash<Vertex>>(corners, mapIndices, "unordered_map, byte hash: ");
+
+		VertexTable<Vertex> table(corners.size());
+		std::vector<Vertex> vertices;
+		tableIndices.reserve(corners.size());
+		double time = bestOf(1, [&]() {
+			for (const auto &vertex : corners) {
+				tableIndices.emplace_back(table.insert(vertex, vertices));
+			}
+		});
+
+		std::cout << "\tVertexTable:               " << time * 1000.0 << " ms, " << vertices.size() << " vertices, "
+		          << static_cast<double>(table.getCollisionCount()) / std::max<size_t>(corners.size(), 1u)
+		          << " collisions per lookup, longest probe " << table.getLongestProbe() << std::endl;
+
+		return legacyIndices == tableIndices && mapIndices == tableIndices;
+	}
+
+	// What cooking did to the model, which loading it in the engine keeps quiet about
+	void report(Model &model)
+	{
+		const ModelStatistics &statistics = model.getStatistics();
+		std::cout << "\tparsed at " << static_cast<double>(statistics.fileBytes) / (1024.0 * 1024.0) /
+		                              statistics.parseSeconds << " MB/s" << std::endl
+		          << "\tdeduplicated " << statistics.cornerCount << " corners into " << statistics.uniqueVertexCount
+		          << " vertices, " << static_cast<double>(statistics.collisionCount) /
+		                              std::max<uint64_t>(statistics.cornerCount, 1u) << " collisions per lookup"
+		          << std::endl
+		          << "\tACMR " << statistics.unoptimized.acmr << " -> " << statistics.cacheOptimized.acmr << " -> "
+		          << statistics.optimized.acmr << " (overdraw), ATVR " << statistics.unoptimized.atvr << " -> "
+		          << statistics.cacheOptimized.atvr << " -> " << statistics.optimized.atvr << " (overdraw)" << std::endl;
+
+		std::cout << "\t" << model.getLodCount() << " levels of detail:";
+		for (uint32_t lod = 0; lod < model.getLodCount(); lod++) {
+			std::cout << " " << model.getLodData()[lod].indexCount / 3u << " (" << model.getLodData()[lod].error << ")";
+		}
+		std::cout << " triangles (error)" << std::endl;
+
+		if (model.getIndexSize() == sizeof(uint16_t)) {
+			std::cout << "\t" << model.getPartitionCount() << " draws with 16 bit indices, duplicating "
+			          << statistics.duplicatedVertexCount << " vertices" << std::endl;
+		}
+		std::cout << "\t" << model.getMeshletCount() << " meshlets, "
+		          << static_cast<double>(model.getIndexCount()) / 3.0 / std::max(model.getMeshletCount(), 1u)
+		          << " triangles each" << std::endl;
+	}
+
+	// Compares parse throughput of ObjParser against tinyobjloader and deduplication through
+	// std::unordered_map against VertexTable, and checks that each pair agrees
+	int benchmark(const std::string &objFile)
+	{
+		const int runs = 3;
+		double megabytes = static_cast<double>(Obtain::MappedFile(objFile).getSize()) / (1024.0 * 1024.0);
+
+		tinyobj::attrib_t attributes;
+		std::vector<tinyobj::shape_t> shapes;
+		std::vector<tinyobj::material_t> materials;
+		std::string warn, err;
+		double tinyobjTime = bestOf(runs, [&]() {
+			if (!tinyobj::LoadObj(&attributes, &shapes, &materials, &warn, &err, objFile.c_str())) {
+				throw std::runtime_error(warn + err);
+			}
+		});
+
+		ObjData obj;
+		double singleThreadTime = bestOf(runs, [&]() {
+			obj = ObjParser::parse(objFile, 1u);
+		});
+		double parallelTime = bestOf(runs, [&]() {
+			obj = ObjParser::parse(objFile);
+		});
+
+		bool identical = matches(attributes, shapes, obj);
+
+		std::cout << objFile << " (" << megabytes << " MB)" << std::endl
+		          << "\ttinyobjloader:        " << megabytes / tinyobjTime << " MB/s" << std::endl
+		          << "\tObjParser, 1 thread:  " << megabytes / singleThreadTime << " MB/s" << std::endl
+		          << "\tObjParser, parallel:  " << megabytes / parallelTime << " MB/s" << std::endl
+		          << "\tparser output " << (identical ? "identical" : "DIFFERS") << std::endl;
+
+		bool deduplicationMatches = benchmarkDeduplication(obj);
+		std::cout << "\tdeduplicated indices " << (deduplicationMatches ? "identical" : "DIFFER") << std::endl;
+
+		return identical && deduplicationMatches ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+}
+
+// Converts OBJ models into the cooked (.obm) format loaded by Model.
+// Usage: obtain-cook [--lod-errors <error>,...] <model.obj> [<model.obm>] ...
+//        obtain-cook --benchmark <model.obj> ...
+// Without an explicit output the cooked file is written next to the OBJ. --lod-errors replaces the
+// relative simplification errors of the levels of detail after the first.
+int main(int argc, char **argv)
+{
+	if (argc < 2) {
+		std::cerr << "usage: " << argv[0] << " [--lod-errors <error>,...] <model.obj> [<model.obm>] ..." << std::endl
+		          << "       " << argv[0] << " --benchmark <model.obj> ..." << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	if (strcmp(argv[1], "--benchmark") == 0) {
+		int result = EXIT_SUCCESS;
+		for (int i = 2; i < argc; i++) {
+			try {
+				if (benchmark(argv[i]) != EXIT_SUCCESS) {
+					result = EXIT_FAILURE;
+				}
+			}
+			catch (const std::runtime_error &e) {
+				std::cerr << e.what() << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+		return result;
+	}
+
+	auto isCookedFile = [](const std::string &filename) {
+		return filename.size() > 4 && filename.compare(filename.size() - 4, 4, ".obm") == 0;
+	};
+
+	std::vector<float> lodErrors = Model::DefaultLodErrors;
+	int first = 1;
+	if (strcmp(argv[1], "--lod-errors") == 0 && argc > 3) {
+		lodErrors.clear();
+		for (char *error = strtok(argv[2], ","); error != nullptr; error = strtok(nullptr, ",")) {
+			lodErrors.push_back(std::strtof(error, nullptr));
+		}
+		first = 3;
+	}
+
+	for (int i = first; i < argc; i++) {
+		std::string objFile = argv[i];
+		std::string cookedFile = objFile.substr(0, objFile.find_last_of('.')) + ".obm";
+
+		if (i + 1 < argc && isCookedFile(argv[i + 1])) {
+			cookedFile = argv[++i];
+		}
+
+		std::unique_ptr<Model> model;
+		try {
+			model = Model::cook(objFile, cookedFile, lodErrors);
+		}
+		catch (const std::runtime_error &e) {
+			std::cerr << e.what() << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		std::cout << objFile << " -> " << cookedFile << std::endl;
+		report(*model);
+	}
+
+	return EXIT_SUCCESS;
+}
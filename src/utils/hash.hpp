@@ -0,0 +1,62 @@
+#ifndef OBTAIN_UTILS_HASH_HPP
+#define OBTAIN_UTILS_HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace Obtain {
+	// Byte hash over 16 byte blocks, each folded into the state by a 64 bit multiply-xorshift mixer.
+	// Every input bit affects every output bit, so near-identical keys (grid vertices) spread well.
+	class Hash {
+	public:
+		static inline uint64_t bytes(const void *data, size_t size, uint64_t seed = 0u)
+		{
+			auto p = static_cast<const uint8_t *>(data);
+			uint64_t state = seed ^ Prime0;
+			size_t remaining = size;
+
+			while (remaining > 16u) {
+				state = mix(read(p) ^ Prime1, read(p + 8) ^ state);
+				p += 16;
+				remaining -= 16u;
+			}
+
+			uint64_t a = 0u, b = 0u;
+			if (remaining > 8u) {
+				a = read(p);
+				memcpy(&b, p + 8, remaining - 8u);
+			} else {
+				memcpy(&a, p, remaining);
+			}
+
+			return mix(Prime1 ^ static_cast<uint64_t>(size), mix(a ^ Prime2, b ^ state ^ Prime3));
+		}
+
+	private:
+		static const uint64_t Prime0 = 0xa0761d6478bd642full;
+		static const uint64_t Prime1 = 0xe7037ed1a0b428dbull;
+		static const uint64_t Prime2 = 0x8ebc6af09c88c6e3ull;
+		static const uint64_t Prime3 = 0x589965cc75374cc3ull;
+
+		// The MurmurHash3 finalizer over a and b rotated, so neither needs 128 bit arithmetic
+		static inline uint64_t mix(uint64_t a, uint64_t b)
+		{
+			uint64_t x = (a ^ ((b << 29u) | (b >> 35u))) * Prime1;
+			x ^= x >> 33u;
+			x *= 0xff51afd7ed558ccdull;
+			x ^= x >> 33u;
+			x *= 0xc4ceb9fe1a85ec53ull;
+			return x ^ (x >> 33u);
+		}
+
+		static inline uint64_t read(const uint8_t *p)
+		{
+			uint64_t value;
+			memcpy(&value, p, sizeof(value));
+			return value;
+		}
+	};
+}
+
+#endif // OBTAIN_UTILS_HASH_HPP
@@ -0,0 +1,129 @@
+//
+// Created by agent on 10/17/26.
+//
+
+#include "mapped-file.hpp"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Obtain {
+#ifdef _WIN32
+	MappedFile::MappedFile(const std::string &filename)
+		: data(nullptr), size(0)
+	{
+		HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		                          FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+			throw std::runtime_error("failed to open file " + filename);
+		}
+
+		LARGE_INTEGER fileSize = {};
+		if (!GetFileSizeEx(file, &fileSize)) {
+			CloseHandle(file);
+			throw std::runtime_error("failed to stat file " + filename);
+		}
+
+		size = static_cast<size_t>(fileSize.QuadPart);
+
+		// CreateFileMapping rejects empty files, an empty file simply has no data
+		if (size > 0) {
+			HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			void *view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+			if (mapping) {
+				CloseHandle(mapping);
+			}
+			if (!view) {
+				CloseHandle(file);
+				throw std::runtime_error("failed to map file " + filename);
+			}
+			data = static_cast<const char *>(view);
+		}
+
+		// The view keeps its own reference to the file
+		CloseHandle(file);
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (data) {
+			UnmapViewOfFile(data);
+		}
+	}
+
+	bool MappedFile::exists(const std::string &filename)
+	{
+		DWORD attributes = GetFileAttributesA(filename.c_str());
+		return attributes != INVALID_FILE_ATTRIBUTES && !(attributes & FILE_ATTRIBUTE_DIRECTORY);
+	}
+#else
+	MappedFile::MappedFile(const std::string &filename)
+		: data(nullptr), size(0)
+	{
+		int fd = open(filename.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw std::runtime_error("failed to open file " + filename);
+		}
+
+		struct stat info = {};
+		if (fstat(fd, &info) != 0) {
+			close(fd);
+			throw std::runtime_error("failed to stat file " + filename);
+		}
+
+		size = static_cast<size_t>(info.st_size);
+
+		// mmap rejects zero-length mappings, an empty file simply has no data
+		if (size > 0) {
+			void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (mapping == MAP_FAILED) {
+				close(fd);
+				throw std::runtime_error("failed to map file " + filename);
+			}
+			madvise(mapping, size, MADV_WILLNEED);
+			data = static_cast<const char *>(mapping);
+		}
+
+		// The mapping keeps its own reference to the file
+		close(fd);
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (data) {
+			munmap(const_cast<char *>(data), size);
+		}
+	}
+
+	bool MappedFile::exists(const std::string &filename)
+	{
+		struct stat info = {};
+		return stat(filename.c_str(), &info) == 0 && S_ISREG(info.st_mode);
+	}
+#endif
+
+	std::unique_ptr<MappedFile> MappedFile::unique(const std::string &filename)
+	{
+		return std::make_unique<MappedFile>(filename);
+	}
+
+	const char *MappedFile::getData() const
+	{
+		return data;
+	}
+
+	size_t MappedFile::getSize() const
+	{
+		return size;
+	}
+}
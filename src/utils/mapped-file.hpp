@@ -0,0 +1,37 @@
+//
+// Created by agent on 10/17/26.
+//
+
+#ifndef OBTAIN_UTILS_MAPPED_FILE_HPP
+#define OBTAIN_UTILS_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace Obtain {
+	// Read-only memory mapping of a whole file. The mapping lives as long as the object.
+	class MappedFile {
+	public:
+		explicit MappedFile(const std::string &filename);
+
+		~MappedFile();
+
+		MappedFile(const MappedFile &) = delete;
+		MappedFile &operator=(const MappedFile &) = delete;
+
+		static std::unique_ptr<MappedFile> unique(const std::string &filename);
+
+		static bool exists(const std::string &filename);
+
+		const char *getData() const;
+
+		size_t getSize() const;
+
+	private:
+		const char *data;
+		size_t size;
+	};
+}
+
+#endif // OBTAIN_UTILS_MAPPED_FILE_HPP
@@ -0,0 +1,102 @@
+#include "worker-pool.hpp"
+
+#include <stdexcept>
+
+namespace Obtain {
+	WorkerPool::WorkerPool(uint32_t threadCount)
+		: task(nullptr), count(0u), pending(0u), generation(0u), stopping(false)
+	{
+		for (uint32_t index = 1; index < threadCount; index++) {
+			threads.emplace_back(&WorkerPool::work, this, index);
+		}
+	}
+
+	WorkerPool::~WorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		started.notify_all();
+		for (auto &thread : threads) {
+			thread.join();
+		}
+	}
+
+	uint32_t WorkerPool::getThreadCount()
+	{
+		return static_cast<uint32_t>(threads.size()) + 1u;
+	}
+
+	void WorkerPool::run(uint32_t count, const std::function<void(uint32_t)> &task)
+	{
+		if (count > getThreadCount()) {
+			throw std::logic_error("running more tasks than the worker pool has threads");
+		}
+		if (count == 0u) {
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			this->task = &task;
+			this->count = count;
+			pending = count - 1u;
+			error = nullptr;
+			generation++;
+		}
+		if (count > 1u) {
+			started.notify_all();
+		}
+
+		execute(0u);
+
+		std::unique_lock<std::mutex> lock(mutex);
+		finished.wait(lock, [this]() { return pending == 0u; });
+		this->task = nullptr;
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+
+	void WorkerPool::work(uint32_t index)
+	{
+		uint64_t seen = 0u;
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				started.wait(lock, [this, seen]() { return stopping || generation != seen; });
+				if (stopping) {
+					return;
+				}
+				seen = generation;
+				if (index >= count) {
+					continue;
+				}
+			}
+
+			execute(index);
+
+			bool last;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				last = --pending == 0u;
+			}
+			if (last) {
+				finished.notify_one();
+			}
+		}
+	}
+
+	void WorkerPool::execute(uint32_t index)
+	{
+		try {
+			(*task)(index);
+		} catch (...) {
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!error) {
+				error = std::current_exception();
+			}
+		}
+	}
+}
@@ -0,0 +1,52 @@
+#ifndef OBTAIN_UTILS_WORKER_POOL_HPP
+#define OBTAIN_UTILS_WORKER_POOL_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Obtain {
+	/*
+	 * Threads that are started once and then wait for work, for jobs too short and too frequent to
+	 * start threads for each time, like recording command buffers every frame. Task i of a run always
+	 * runs on thread i, the calling thread being thread 0, so a task can use per-thread resources
+	 * such as a command pool without locking.
+	 */
+	class WorkerPool {
+	public:
+		// Starts threadCount - 1 threads, the calling thread is the last one
+		explicit WorkerPool(uint32_t threadCount);
+
+		~WorkerPool();
+
+		WorkerPool(const WorkerPool &) = delete;
+		WorkerPool &operator=(const WorkerPool &) = delete;
+
+		uint32_t getThreadCount();
+
+		// Runs task(i) on thread i for every i below count, which must not exceed the thread count, and
+		// returns once all have; rethrows the first exception a task threw
+		void run(uint32_t count, const std::function<void(uint32_t)> &task);
+
+	private:
+		std::vector<std::thread> threads;
+		std::mutex mutex;
+		std::condition_variable started;
+		std::condition_variable finished;
+		const std::function<void(uint32_t)> *task;
+		uint32_t count;
+		uint32_t pending; // tasks of the current run still running on other threads
+		uint64_t generation; // number of runs so far
+		bool stopping;
+		std::exception_ptr error;
+
+		void work(uint32_t index);
+		void execute(uint32_t index);
+	};
+}
+
+#endif // OBTAIN_UTILS_WORKER_POOL_HPP
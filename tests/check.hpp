@@ -0,0 +1,28 @@
+#ifndef OBTAIN_TESTS_CHECK_HPP
+#define OBTAIN_TESTS_CHECK_HPP
+
+#include <iostream>
+
+namespace Obtain::Tests {
+	inline int failures = 0;
+
+	// Exit code of a test, non-zero if any check failed
+	inline int result()
+	{
+		if (failures > 0) {
+			std::cerr << failures << " checks failed" << std::endl;
+		}
+		return failures > 0 ? 1 : 0;
+	}
+}
+
+// Reports a failed condition and keeps going, so one run shows every failure
+#define CHECK(condition)                                                                         \
+	do {                                                                                         \
+		if (!(condition)) {                                                                      \
+			std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << std::endl; \
+			Obtain::Tests::failures++;                                                           \
+		}                                                                                        \
+	} while (false)
+
+#endif // OBTAIN_TESTS_CHECK_HPP
@@ -0,0 +1,109 @@
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "../src/graphics/vulkan/model.hpp"
+
+using Obtain::Graphics::Vulkan::CookedModelHeader;
+using Obtain::Graphics::Vulkan::Model;
+
+namespace {
+	// Models are looked up in assets/models of the working directory
+	const std::string ModelDirectory = "assets/models/";
+	const uint32_t GridSize = 32u;
+
+	// A bumpy grid, large enough for several levels of detail and meshlets
+	void writeGrid(const std::string &filename)
+	{
+		std::ofstream obj(filename);
+		for (uint32_t y = 0; y <= GridSize; y++) {
+			for (uint32_t x = 0; x <= GridSize; x++) {
+				obj << "v " << x << " " << y << " " << ((x * 7u + y * 13u) % 5u) * 0.1f << "\n";
+				obj << "vt " << static_cast<float>(x) / GridSize << " " << static_cast<float>(y) / GridSize << "\n";
+			}
+		}
+		for (uint32_t y = 0; y < GridSize; y++) {
+			for (uint32_t x = 0; x < GridSize; x++) {
+				uint32_t a = y * (GridSize + 1u) + x + 1u;
+				uint32_t b = a + 1u;
+				uint32_t c = a + GridSize + 2u;
+				uint32_t d = a + GridSize + 1u;
+				obj << "f " << a << "/" << a << " " << b << "/" << b << " " << c << "/" << c << "\n";
+				obj << "f " << a << "/" << a << " " << c << "/" << c << " " << d << "/" << d << "\n";
+			}
+		}
+	}
+
+	template<typename T>
+	bool sameData(const T *a, const T *b, size_t count)
+	{
+		return count == 0u || memcmp(a, b, count * sizeof(T)) == 0;
+	}
+
+	bool sameModel(Model &a, Model &b)
+	{
+		return a.getVertexCount() == b.getVertexCount() && a.getIndexCount() == b.getIndexCount() &&
+		       a.getIndexSize() == b.getIndexSize() && a.getShapeCount() == b.getShapeCount() &&
+		       a.getLodCount() == b.getLodCount() && a.getPartitionCount() == b.getPartitionCount() &&
+		       a.getMeshletCount() == b.getMeshletCount() &&
+		       sameData(a.getVertexData(), b.getVertexData(), a.getVertexCount()) &&
+		       sameData(static_cast<const char *>(a.getIndexData()), static_cast<const char *>(b.getIndexData()),
+		                static_cast<size_t>(a.getIndexCount()) * a.getIndexSize()) &&
+		       sameData(a.getShapeData(), b.getShapeData(), a.getShapeCount()) &&
+		       sameData(a.getLodData(), b.getLodData(), a.getLodCount()) &&
+		       sameData(a.getPartitionData(), b.getPartitionData(), a.getPartitionCount()) &&
+		       sameData(a.getMeshletData(), b.getMeshletData(), a.getMeshletCount()) &&
+		       memcmp(&a.getBounds(), &b.getBounds(), sizeof(a.getBounds())) == 0;
+	}
+}
+
+// What the cook tool writes is what the renderer loads
+static void testRoundTrip()
+{
+	auto cooked = Model::cook(ModelDirectory + "grid.obj", ModelDirectory + "grid.obm");
+	CHECK(cooked->getVertexCount() > 0u);
+	CHECK(cooked->getLodCount() > 1u);
+	CHECK(cooked->getMeshletCount() > 0u);
+
+	// Loading from an OBJ file is the only way statistics get filled in
+	auto loaded = Model::unique("grid.obj");
+	CHECK(loaded->getStatistics().fileBytes == 0u);
+	CHECK(sameModel(*cooked, *loaded));
+}
+
+// A cooked file whose counts point past its end is ignored in favour of the OBJ file
+static void testCorruptCount()
+{
+	std::string filename = ModelDirectory + "grid.obm";
+	std::vector<char> data;
+	{
+		std::ifstream file(filename, std::ios::binary);
+		data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+	CHECK(data.size() >= sizeof(CookedModelHeader));
+	uint32_t meshletCount = 0xFFFFFFFFu;
+	memcpy(data.data() + offsetof(CookedModelHeader, meshletCount), &meshletCount, sizeof(meshletCount));
+	{
+		std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+		file.write(data.data(), static_cast<std::streamsize>(data.size()));
+	}
+
+	auto loaded = Model::unique("grid.obj");
+	CHECK(loaded->getStatistics().fileBytes > 0u);
+	CHECK(loaded->getMeshletCount() > 0u);
+}
+
+int main()
+{
+	std::filesystem::create_directories(ModelDirectory);
+	writeGrid(ModelDirectory + "grid.obj");
+	testRoundTrip();
+	testCorruptCount();
+	return Obtain::Tests::result();
+}
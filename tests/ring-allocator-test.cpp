@@ -0,0 +1,75 @@
+#include "check.hpp"
+#include "../src/graphics/vulkan/ring-allocator.hpp"
+
+using Obtain::Graphics::Vulkan::RingAllocator;
+using Obtain::Graphics::Vulkan::RingSection;
+
+static void testInOrder()
+{
+	RingAllocator ring(1024u);
+	CHECK(!ring.hasOpen());
+	CHECK(ring.allocate(100u, 16u) == 0u);
+	CHECK(ring.allocate(100u, 16u) == 112u);
+	CHECK(ring.hasOpen());
+	CHECK(ring.getUsedBytes() == 212u);
+
+	RingSection section = ring.close();
+	CHECK(!ring.hasOpen());
+	CHECK(section.end == 212u);
+	CHECK(section.bytes == 212u);
+	ring.release(section);
+	CHECK(ring.getUsedBytes() == 0u);
+
+	// An empty ring starts over at the beginning
+	CHECK(ring.allocate(1024u, 16u) == 0u);
+	CHECK(ring.allocate(1u, 1u) == RingAllocator::NoSpace);
+}
+
+static void testWrap()
+{
+	RingAllocator ring(1024u);
+	CHECK(ring.allocate(400u, 16u) == 0u);
+	RingSection first = ring.close();
+	CHECK(ring.allocate(400u, 16u) == 400u);
+	RingSection second = ring.close();
+
+	// 224 bytes are left at the end and nothing at the start until the first section is released
+	CHECK(ring.allocate(300u, 16u) == RingAllocator::NoSpace);
+	ring.release(first);
+	CHECK(ring.allocate(300u, 16u) == 0u);
+	CHECK(ring.getUsedBytes() == 400u + 224u + 300u);
+
+	// The skipped end belongs to the section that wrapped
+	RingSection wrapped = ring.close();
+	CHECK(wrapped.end == 300u);
+	CHECK(wrapped.bytes == 224u + 300u);
+
+	// Between the head and the second section's start
+	CHECK(ring.allocate(80u, 16u) == 304u);
+	CHECK(ring.allocate(80u, 16u) == RingAllocator::NoSpace);
+	ring.release(second);
+	CHECK(ring.allocate(80u, 16u) == 384u);
+
+	ring.release(wrapped);
+	ring.release(ring.close());
+	CHECK(ring.getUsedBytes() == 0u);
+}
+
+static void testFull()
+{
+	RingAllocator ring(256u);
+	CHECK(ring.allocate(128u, 16u) == 0u);
+	CHECK(ring.allocate(128u, 16u) == 128u);
+	RingSection section = ring.close();
+	CHECK(ring.allocate(16u, 16u) == RingAllocator::NoSpace);
+	ring.release(section);
+	CHECK(ring.allocate(256u, 16u) == 0u);
+}
+
+int main()
+{
+	testInOrder();
+	testWrap();
+	testFull();
+	return Obtain::Tests::result();
+}
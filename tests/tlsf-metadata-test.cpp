@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "check.hpp"
+#include "../src/graphics/vulkan/tlsf-metadata.hpp"
+
+using Obtain::Graphics::Vulkan::TlsfMetadata;
+
+static void testWholeBlock()
+{
+	TlsfMetadata metadata(4096u);
+	uint32_t node = metadata.allocate(4096u, 1u, true, 1u);
+	CHECK(node != TlsfMetadata::NullNode);
+	CHECK(metadata.getOffset(node) == 0u);
+	CHECK(metadata.getLargestFreeRange() == 0u);
+	CHECK(metadata.allocate(1u, 1u, true, 1u) == TlsfMetadata::NullNode);
+
+	metadata.free(node);
+	CHECK(metadata.isEmpty());
+	CHECK(metadata.getLargestFreeRange() == 4096u);
+}
+
+// Random allocations never overlap, keep their alignment and merge back into one range when freed
+static void testRandom()
+{
+	const vk::DeviceSize blockSize = 64u * 1024u * 1024u;
+	TlsfMetadata metadata(blockSize);
+	std::mt19937 random(42u);
+	std::uniform_int_distribution<vk::DeviceSize> sizes(1u, 256u * 1024u);
+	std::uniform_int_distribution<uint32_t> alignmentBits(0u, 12u);
+
+	struct Range {
+		uint32_t node;
+		vk::DeviceSize offset;
+		vk::DeviceSize size;
+	};
+	std::vector<Range> ranges;
+	vk::DeviceSize usedBytes = 0u;
+	for (uint32_t round = 0; round < 8u; round++) {
+		for (uint32_t i = 0; i < 200u; i++) {
+			vk::DeviceSize size = sizes(random);
+			vk::DeviceSize alignment = vk::DeviceSize(1u) << alignmentBits(random);
+			uint32_t node = metadata.allocate(size, alignment, true, 1u);
+			if (node == TlsfMetadata::NullNode) {
+				continue;
+			}
+			CHECK(metadata.getOffset(node) % alignment == 0u);
+			CHECK(metadata.getSize(node) == size);
+			ranges.push_back({node, metadata.getOffset(node), size});
+			usedBytes += size;
+		}
+		CHECK(metadata.getUsedBytes() == usedBytes);
+		CHECK(metadata.getAllocationCount() == ranges.size());
+
+		std::sort(ranges.begin(), ranges.end(), [](const Range &a, const Range &b) {
+			return a.offset < b.offset;
+		});
+		for (size_t i = 0; i < ranges.size(); i++) {
+			CHECK(ranges[i].offset + ranges[i].size <= blockSize);
+			if (i > 0u) {
+				CHECK(ranges[i - 1u].offset + ranges[i - 1u].size <= ranges[i].offset);
+			}
+		}
+
+		// Free half of them, in random order
+		std::shuffle(ranges.begin(), ranges.end(), random);
+		for (size_t i = ranges.size() / 2u; i < ranges.size(); i++) {
+			metadata.free(ranges[i].node);
+			usedBytes -= ranges[i].size;
+		}
+		ranges.resize(ranges.size() / 2u);
+	}
+
+	for (const Range &range : ranges) {
+		metadata.free(range.node);
+	}
+	CHECK(metadata.isEmpty());
+	CHECK(metadata.getUsedBytes() == 0u);
+	CHECK(metadata.getLargestFreeRange() == blockSize);
+}
+
+// Linear and optimal resources next to each other don't share a page of granularity bytes
+static void testGranularity()
+{
+	TlsfMetadata metadata(1024u * 1024u);
+	uint32_t linear = metadata.allocate(100u, 4u, true, 1024u);
+	uint32_t optimal = metadata.allocate(100u, 4u, false, 1024u);
+	uint32_t nextLinear = metadata.allocate(100u, 4u, true, 1024u);
+	CHECK(metadata.getOffset(linear) == 0u);
+	CHECK(metadata.getOffset(optimal) == 1024u);
+	// Either in the padding in front of the optimal range or behind it, as long as the pages differ
+	vk::DeviceSize offset = metadata.getOffset(nextLinear);
+	CHECK(offset / 1024u != 1u && (offset + 99u) / 1024u != 1u);
+}
+
+int main()
+{
+	testWholeBlock();
+	testRandom();
+	testGranularity();
+	return Obtain::Tests::result();
+}
@@ -0,0 +1,54 @@
+#include <vector>
+
+#include "check.hpp"
+#include "../src/graphics/vulkan/vertex-table.hpp"
+
+using Obtain::Graphics::Vulkan::VertexTable;
+
+namespace {
+	struct TestVertex {
+		float position[3];
+		float texCoord[2];
+	};
+
+	TestVertex gridVertex(uint32_t x, uint32_t y)
+	{
+		return {{static_cast<float>(x), static_cast<float>(y), 0.0f},
+		        {static_cast<float>(x) / 64.0f, static_cast<float>(y) / 64.0f}};
+	}
+}
+
+// Every corner of a grid of quads is offered once per quad it belongs to, like an OBJ mesh does
+static void testGrid(uint32_t gridSize, size_t expectedCount)
+{
+	VertexTable<TestVertex> table(expectedCount);
+	std::vector<TestVertex> vertices;
+	std::vector<uint32_t> indices;
+	for (uint32_t y = 0; y < gridSize; y++) {
+		for (uint32_t x = 0; x < gridSize; x++) {
+			for (auto corner : {gridVertex(x, y), gridVertex(x + 1u, y), gridVertex(x + 1u, y + 1u),
+			                    gridVertex(x, y + 1u)}) {
+				indices.push_back(table.insert(corner, vertices));
+			}
+		}
+	}
+
+	CHECK(vertices.size() == (gridSize + 1u) * (gridSize + 1u));
+	for (size_t i = 0; i < indices.size(); i++) {
+		uint32_t x = static_cast<uint32_t>(i / 4u) % gridSize + (i % 4u == 1u || i % 4u == 2u ? 1u : 0u);
+		uint32_t y = static_cast<uint32_t>(i / 4u) / gridSize + (i % 4u >= 2u ? 1u : 0u);
+		CHECK(vertices[indices[i]].position[0] == static_cast<float>(x));
+		CHECK(vertices[indices[i]].position[1] == static_cast<float>(y));
+	}
+	CHECK(table.getCapacity() >= vertices.size() * 4u / 3u);
+	CHECK(table.getProbeCount() >= indices.size());
+}
+
+int main()
+{
+	// Sized for every corner, as the model loader does
+	testGrid(64u, 64u * 64u * 4u);
+	// Sized for far fewer, so the table has to grow
+	testGrid(64u, 16u);
+	return Obtain::Tests::result();
+}